@@ -0,0 +1,405 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// --> after the standard headers, the register macros collide with them.
+#include "cpu/i8086t.h"
+#include "dev/flat.h"
+#include "dev/portbus.h"
+
+using namespace v86;
+
+namespace {
+	constexpr uint16_t CODE_SEG = 0x1000;
+	constexpr uint16_t DATA_SEG = 0x2000;
+	constexpr uint16_t STACK_SEG = 0x3000;
+	constexpr uint16_t EXTRA_SEG = 0x4000;
+	constexpr uint16_t BENCH_PORT = 0x60;
+	constexpr uint16_t REP_COUNT = 256; // --> elements per REP instruction.
+
+	/* port that streams a counter and swallows writes. */
+	class CBenchPort : public IPort {
+	private:
+		uint8_t m_Next;
+
+	public:
+		CBenchPort() : m_Next(0) { }
+
+	public:
+		virtual bool write(uint16_t, uint8_t) override { return true; }
+		virtual bool read(uint16_t, uint8_t* byte) override {
+			*byte = m_Next++;
+			return true;
+		}
+
+		virtual uint32_t readBlock(uint16_t, void* buf, uint32_t count, uint8_t width) override {
+			memset(buf, m_Next++, count * width);
+			return count;
+		}
+
+		virtual uint32_t writeBlock(uint16_t, const void*, uint32_t count, uint8_t) override {
+			return count;
+		}
+	};
+
+	/* synthetic guest program, the body is unrolled and looped. */
+	struct workload_t {
+		const char* name;
+		const char* kind; // --> "class" or "mixed".
+		std::vector<uint8_t> prologue; // --> once per iteration, before the body.
+		std::vector<uint8_t> body;
+		uint32_t unroll;
+		bool counted; // --> loop on DEC CX, JNZ. otherwise on flags only.
+	};
+
+	/* execution tier of a run. */
+	enum EMODE {
+		MODE_INTERP = 0,
+		MODE_CACHE,
+		MODE_JIT,
+	};
+
+	const char* const MODES[] = { "interp", "cache", "jit" };
+
+	struct result_t {
+		const workload_t* workload;
+		EMODE mode;
+		std::vector<double> samples; // --> guest instructions per second.
+		double mean, stddev, min, max;
+	};
+
+	struct options_t {
+		bool json;
+		bool list;
+		bool modes[3]; // --> by EMODE.
+		uint32_t reps;
+		double seconds;
+		const char* filter;
+	};
+
+	std::vector<workload_t> workloads() {
+		return {
+			/* ADD AX,BX; XOR SI,DX; AND BX,AX; OR AX,DX; SUB DX,BX; ADC AX,SI; CMP BX,DX; SBB SI,AX */
+			{ "alu_reg", "class", { }, {
+				0x01, 0xd8, 0x31, 0xd6, 0x21, 0xc3, 0x09, 0xd0,
+				0x29, 0xda, 0x11, 0xf0, 0x39, 0xd3, 0x19, 0xc6 }, 4, true },
+
+			/* ADD [BX],AX; ADD AX,[BX]; XOR [BX+2],AX; SUB [SI],AX; CMP [BX],AX; OR DX,[SI+4] */
+			{ "alu_mem", "class", { }, {
+				0x01, 0x07, 0x03, 0x07, 0x31, 0x47, 0x02, 0x29,
+				0x04, 0x39, 0x07, 0x0b, 0x54, 0x04 }, 4, true },
+
+			/* ADD AX,[BX+SI]; ADD AX,[BX+DI+10]; ADD AX,[BP+SI+1234]; ADD AX,[0100]; ADD DX,[BP+DI+8]; ES: ADD AX,[SI] */
+			{ "modrm", "class", { }, {
+				0x03, 0x00, 0x03, 0x41, 0x10, 0x03, 0x82, 0x34,
+				0x12, 0x03, 0x06, 0x00, 0x01, 0x03, 0x53, 0x08,
+				0x26, 0x03, 0x04 }, 4, true },
+
+			/* PUSH AX, BX, DX, SI; POP SI, DX, BX, AX */
+			{ "push_pop", "class", { }, {
+				0x50, 0x53, 0x52, 0x56, 0x5e, 0x5a, 0x5b, 0x58 }, 8, true },
+
+			/* CMP AX,AX; JZ +0 (taken) x 7 */
+			{ "jcc_taken", "class", { }, {
+				0x39, 0xc0, 0x74, 0x00, 0x74, 0x00, 0x74, 0x00,
+				0x74, 0x00, 0x74, 0x00, 0x74, 0x00, 0x74, 0x00 }, 4, true },
+
+			/* CMP AX,AX; JNZ +0 (not taken) x 7 */
+			{ "jcc_not_taken", "class", { }, {
+				0x39, 0xc0, 0x75, 0x00, 0x75, 0x00, 0x75, 0x00,
+				0x75, 0x00, 0x75, 0x00, 0x75, 0x00, 0x75, 0x00 }, 4, true },
+
+			/* MOV CX,[0]; MOV DI,[2]; REP INSW */
+			{ "rep_insw", "class", {
+				0x8b, 0x0e, 0x00, 0x00, 0x8b, 0x3e, 0x02, 0x00 }, {
+				0xf3, 0x6d }, 1, false },
+
+			/* MOV CX,[0]; MOV SI,[2]; REP OUTSW */
+			{ "rep_outsw", "class", {
+				0x8b, 0x0e, 0x00, 0x00, 0x8b, 0x36, 0x02, 0x00 }, {
+				0xf3, 0x6f }, 1, false },
+
+			/* checksum: ADD AX,[SI]; ADC DX,0; INC SI; INC SI; AND SI,0FFE */
+			{ "mixed_checksum", "mixed", { }, {
+				0x03, 0x04, 0x83, 0xd2, 0x00, 0x46, 0x46, 0x81,
+				0xe6, 0xfe, 0x0f }, 4, true },
+
+			/* PUSH AX; XCHG AX,BX; TEST BX,AX; JNZ +0; ADD AX,1; POP BX; XOR AX,BX;
+			   INC AX; DEC AX; CMP AX,1234; JB +0; MOV DX,[BX+SI]; MOV [DI],DL */
+			{ "mixed_logic", "mixed", { }, {
+				0x50, 0x87, 0xd8, 0x85, 0xc3, 0x75, 0x00, 0x05,
+				0x01, 0x00, 0x5b, 0x31, 0xd8, 0x40, 0x48, 0x3d,
+				0x34, 0x12, 0x72, 0x00, 0x8b, 0x10, 0x88, 0x15 }, 2, true },
+		};
+	}
+
+	/* assemble the loop: prologue, unrolled body, then branch back to the start. */
+	std::vector<uint8_t> assemble(const workload_t& workload) {
+		std::vector<uint8_t> code(workload.prologue);
+
+		for (uint32_t i = 0; i < workload.unroll; ++i) {
+			code.insert(code.end(), workload.body.begin(), workload.body.end());
+		}
+
+		if (workload.counted) {
+			code.push_back(0x49); // --> DEC CX.
+		}
+
+		// --> JNZ start; JZ start. one of them is always taken.
+		code.push_back(0x75);
+		code.push_back(uint8_t(-int32_t(code.size() + 1)));
+		code.push_back(0x74);
+		code.push_back(uint8_t(-int32_t(code.size() + 1)));
+		return code;
+	}
+
+	/* guest machine running the workload. */
+	class CBench {
+	private:
+		Ci8086T<CMemoryBus, CPortBus> m_Cpu;
+
+	public:
+		CBench(const workload_t& workload, EMODE mode) {
+			CFlatMemory* memory = new CFlatMemory();
+			CPortBus* ports = new CPortBus();
+			CBenchPort* port = new CBenchPort();
+
+			std::vector<uint8_t> code = assemble(workload);
+			memcpy(memory->getHost() + (CODE_SEG << 4), code.data(), code.size());
+
+			// --> REP count and the string offset.
+			uint8_t* data = memory->getHost() + (DATA_SEG << 4);
+			data[0] = uint8_t(REP_COUNT);
+			data[1] = uint8_t(REP_COUNT >> 8);
+			data[2] = 0x00;
+			data[3] = 0x10;
+
+			ports->map(BENCH_PORT, 2, port);
+			port->drop();
+
+			m_Cpu.setMemory(memory);
+			m_Cpu.setPort(ports);
+			m_Cpu.setBlockCache(mode == MODE_CACHE);
+			m_Cpu.setJit(mode == MODE_JIT);
+			memory->drop();
+			ports->drop();
+
+			USE_STATE(&m_Cpu, state);
+			state->segs[SEG_CS].dword = CODE_SEG;
+			state->segs[SEG_DS].dword = DATA_SEG;
+			state->segs[SEG_SS].dword = STACK_SEG;
+			state->segs[SEG_ES].dword = EXTRA_SEG;
+			state->eip = 0;
+			state->ax = 1;
+			state->bx = 0x100;
+			state->si = 0x200;
+			state->di = 0x300;
+			state->bp = 0x400;
+			state->dx = BENCH_PORT;
+			state->sp = 0xfff0;
+		}
+
+	public:
+		/* run the budget, returns guest instructions per second. */
+		double measure(uint64_t instructions) {
+			USE_STATE(&m_Cpu, state);
+			uint64_t retired = state->instructions;
+
+			auto begin = std::chrono::steady_clock::now();
+			m_Cpu.run(instructions, UINT64_MAX);
+			auto end = std::chrono::steady_clock::now();
+
+			double seconds = std::chrono::duration<double>(end - begin).count();
+			return double(state->instructions - retired) / (seconds > 0 ? seconds : 1e-9);
+		}
+	};
+
+	result_t bench(const workload_t& workload, EMODE mode, const options_t& options) {
+		CBench machine(workload, mode);
+		result_t result;
+
+		result.workload = &workload;
+		result.mode = mode;
+
+		// --> warm up, then size the budget to the requested time.
+		double rate = machine.measure(200000);
+		uint64_t budget = uint64_t(rate * options.seconds);
+		if (budget < 100000) {
+			budget = 100000;
+		}
+
+		for (uint32_t i = 0; i < options.reps; ++i) {
+			result.samples.push_back(machine.measure(budget));
+		}
+
+		double sum = 0, squares = 0;
+		result.min = result.max = result.samples[0];
+
+		for (double sample : result.samples) {
+			sum += sample;
+			result.min = sample < result.min ? sample : result.min;
+			result.max = sample > result.max ? sample : result.max;
+		}
+
+		result.mean = sum / result.samples.size();
+		for (double sample : result.samples) {
+			squares += (sample - result.mean) * (sample - result.mean);
+		}
+
+		result.stddev = result.samples.size() > 1
+			? std::sqrt(squares / (result.samples.size() - 1)) : 0;
+
+		return result;
+	}
+
+	void printText(const std::vector<result_t>& results) {
+		printf("%-16s %-6s %-6s %10s %9s %7s %10s %10s\n",
+			"workload", "kind", "mode", "MIPS", "stddev", "cv%", "min", "max");
+
+		for (const result_t& result : results) {
+			printf("%-16s %-6s %-6s %10.2f %9.2f %7.2f %10.2f %10.2f\n",
+				result.workload->name, result.workload->kind, MODES[result.mode],
+				result.mean / 1e6, result.stddev / 1e6,
+				result.mean > 0 ? result.stddev * 100 / result.mean : 0,
+				result.min / 1e6, result.max / 1e6);
+		}
+	}
+
+	void printJson(const std::vector<result_t>& results, const options_t& options) {
+#ifdef __V86_THREADED__
+		const char* threaded = "true";
+#else
+		const char* threaded = "false";
+#endif
+
+		printf("{\n  \"threaded\": %s,\n  \"reps\": %u,\n  \"seconds\": %g,\n  \"results\": [",
+			threaded, options.reps, options.seconds);
+
+		for (size_t i = 0; i < results.size(); ++i) {
+			const result_t& result = results[i];
+
+			printf("%s\n    {\"name\": \"%s\", \"kind\": \"%s\", \"mode\": \"%s\", "
+				"\"mips_mean\": %.4f, \"mips_stddev\": %.4f, \"mips_min\": %.4f, \"mips_max\": %.4f, \"samples\": [",
+				i ? "," : "", result.workload->name, result.workload->kind, MODES[result.mode],
+				result.mean / 1e6, result.stddev / 1e6, result.min / 1e6, result.max / 1e6);
+
+			for (size_t k = 0; k < result.samples.size(); ++k) {
+				printf("%s%.4f", k ? ", " : "", result.samples[k] / 1e6);
+			}
+
+			printf("]}");
+		}
+
+		printf("\n  ]\n}\n");
+	}
+
+	void usage(const char* name) {
+		fprintf(stderr,
+			"usage: %s [options]\n"
+			"  --json             print the results as JSON.\n"
+			"  --list             list the workloads.\n"
+			"  --reps N           measured runs per workload. (default 5)\n"
+			"  --time SECONDS     length of a run. (default 0.2)\n"
+			"  --filter TEXT      only the workloads whose name contains the text.\n"
+			"  --mode MODE        interp, cache, jit, both (interp and cache) or all. (default both)\n", name);
+	}
+
+	bool parse(int argc, char** argv, options_t& options) {
+		options.json = false;
+		options.list = false;
+		options.modes[MODE_INTERP] = options.modes[MODE_CACHE] = true;
+		options.modes[MODE_JIT] = false;
+		options.reps = 5;
+		options.seconds = 0.2;
+		options.filter = nullptr;
+
+		for (int i = 1; i < argc; ++i) {
+			const char* arg = argv[i];
+			const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+			if (!strcmp(arg, "--json")) {
+				options.json = true;
+			}
+
+			else if (!strcmp(arg, "--list")) {
+				options.list = true;
+			}
+
+			else if (!strcmp(arg, "--reps") && value) {
+				options.reps = uint32_t(atoi(value));
+				i++;
+			}
+
+			else if (!strcmp(arg, "--time") && value) {
+				options.seconds = atof(value);
+				i++;
+			}
+
+			else if (!strcmp(arg, "--filter") && value) {
+				options.filter = value;
+				i++;
+			}
+
+			else if (!strcmp(arg, "--mode") && value) {
+				bool both = !strcmp(value, "both"), all = !strcmp(value, "all");
+				options.modes[MODE_INTERP] = !strcmp(value, "interp") || both || all;
+				options.modes[MODE_CACHE] = !strcmp(value, "cache") || both || all;
+				options.modes[MODE_JIT] = !strcmp(value, "jit") || all;
+				i++;
+			}
+
+			else {
+				return false;
+			}
+		}
+
+		return options.reps > 0 && options.seconds > 0 && (options.modes[MODE_INTERP] || options.modes[MODE_CACHE] || options.modes[MODE_JIT]);
+	}
+}
+
+int main(int argc, char** argv) {
+	options_t options;
+
+	if (!parse(argc, argv, options)) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	std::vector<workload_t> list = workloads();
+	std::vector<result_t> results;
+
+	for (const workload_t& workload : list) {
+		if (options.filter && !strstr(workload.name, options.filter)) {
+			continue;
+		}
+
+		if (options.list) {
+			printf("%-16s %s\n", workload.name, workload.kind);
+			continue;
+		}
+
+		for (uint32_t mode = MODE_INTERP; mode <= MODE_JIT; ++mode) {
+			if (options.modes[mode]) {
+				results.push_back(bench(workload, EMODE(mode), options));
+			}
+		}
+	}
+
+	if (options.list) {
+		return 0;
+	}
+
+	if (options.json) {
+		printJson(results, options);
+	}
+
+	else {
+		printText(results);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,700 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// --> after the standard headers, the register macros collide with them.
+#include "cpu/i8086t.h"
+#include "dev/flat.h"
+#include "dev/portbus.h"
+#include "vm/lockstep.h"
+
+using namespace v86;
+
+/**
+ * differential conformance: random programs run through every execution tier,
+ * registers, flags, memory and device traffic must match the plain interpreter.
+ * lockstep runs lanes of each program with other inputs, every lane must match the interpreter on the same inputs.
+ * `--digest` writes one line per program, a build with `__V86_THREADED__` must write the same file.
+ */
+namespace {
+	constexpr uint16_t CODE_SEG = 0x1000;
+	constexpr uint16_t DATA_SEG = 0x2000;
+	constexpr uint16_t EXTRA_SEG = 0x3000;
+	constexpr uint16_t STACK_SEG = 0x4000;
+	constexpr uint32_t MMIO_ADDR = 0x2f000; // --> DS:F000 ~ DS:FFFF.
+	constexpr uint16_t COUNTER = 0xe000; // --> DS offset of the loop counter.
+	constexpr uint32_t SPAN_BEGIN = CODE_SEG << 4; // --> the segments, hashed.
+	constexpr uint32_t SPAN_END = (STACK_SEG + 0x1000) << 4;
+	constexpr uint32_t MAX_BODY = 100; // --> bytes of the loop body.
+	constexpr uint32_t PATCH = 8; // --> bytes of the loop that self-modifying programs rewrite.
+	constexpr uint32_t LANES = 8; // --> lockstep lanes per program.
+
+	/* execution tier of a run. */
+	enum EMODE {
+		MODE_INTERP = 0,
+		MODE_STEP,		// --> `exec()`, one instruction at a time.
+		MODE_CACHE,
+		MODE_JIT,
+		MODE_TRACE,
+		MODE_CACHE_WATCH,	// --> watches on the data and code pages, resumed at each stop.
+		MODE_JIT_WATCH,
+		MODE_BOUND,		// --> `Ci8086T` over the flat memory and the port bus.
+		MODE_BOUND_CACHE,
+		MODE_BOUND_JIT_WATCH,
+		MODE_MAX,
+	};
+
+	const char* const MODES[MODE_MAX] = {
+		"interp", "step", "cache", "jit", "trace", "cache+watch", "jit+watch",
+		"bound", "bound+cache", "bound+jit+watch"
+	};
+
+	/* processor bound to the backends of the runs. */
+	typedef Ci8086T<CMemoryBus, CPortBus> CBoundCpu;
+
+	/* 64-bit FNV-1a. */
+	uint64_t fnv(const void* buf, size_t size, uint64_t hash = 1469598103934665603ull) {
+		const uint8_t* bytes = (const uint8_t*)buf;
+
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	/* memory mapped page: stores the bytes scrambled, logs every access. */
+	class CLogMemory : public IMemory {
+	private:
+		uint8_t m_Bytes[CMemoryBus::PAGE_SIZE];
+		uint64_t m_Log;
+
+	public:
+		CLogMemory() : m_Log(0) { memset(m_Bytes, 0x5a, sizeof(m_Bytes)); }
+
+	public:
+		inline uint64_t getLog() const { return fnv(m_Bytes, sizeof(m_Bytes), m_Log); }
+
+	public:
+		virtual uint32_t read(uint32_t addr, void* buf, uint32_t size) override {
+			for (uint32_t i = 0; i < size; ++i) {
+				((uint8_t*)buf)[i] = m_Bytes[(addr + i) & (CMemoryBus::PAGE_SIZE - 1)] ^ 0xa5;
+			}
+
+			uint32_t rec[2] = { addr, size };
+			m_Log = fnv(rec, sizeof(rec), m_Log);
+			return size;
+		}
+
+		virtual uint32_t write(uint32_t addr, const void* buf, uint32_t size) override {
+			for (uint32_t i = 0; i < size; ++i) {
+				m_Bytes[(addr + i) & (CMemoryBus::PAGE_SIZE - 1)] = ((const uint8_t*)buf)[i];
+			}
+
+			uint32_t rec[2] = { addr, size | 0x80000000u };
+			m_Log = fnv(buf, size, fnv(rec, sizeof(rec), m_Log));
+			return size;
+		}
+	};
+
+	/* ports: reads stream a counter of the port as INC/DEC opcodes, writes are logged. */
+	class CLogPort : public IPort {
+	private:
+		uint8_t m_Next;
+		uint64_t m_Log;
+
+	public:
+		CLogPort() : m_Next(0x11), m_Log(0) { }
+
+	public:
+		inline uint64_t getLog() const { return m_Log; }
+
+	public:
+		virtual bool write(uint16_t port, uint8_t byte) override {
+			uint32_t rec[2] = { port, byte };
+			m_Log = fnv(rec, sizeof(rec), m_Log);
+			return true;
+		}
+
+		virtual bool read(uint16_t port, uint8_t* byte) override {
+			*byte = uint8_t(0x40 | ((m_Next++ + port) & 0x0f)); // --> INC, DEC: patched code stays valid.
+			return true;
+		}
+	};
+
+	/* random program: a loop of random instructions, counted down in memory. */
+	class CProgram {
+	private:
+		std::mt19937 m_Rand;
+		std::vector<std::vector<uint8_t>> m_Items;
+		std::vector<uint32_t> m_Skips; // --> Jcc items: items to skip forward.
+
+	public:
+		std::vector<uint8_t> code;
+		uint16_t regs[8];
+		uint16_t status; // --> FLAGS.
+		uint16_t iterations;
+		uint16_t extra; // --> ES, the code segment for self-modifying string writes.
+
+	public:
+		CProgram(uint32_t seed) : m_Rand(seed) {
+			for (uint16_t& reg : regs) {
+				reg = uint16_t(m_Rand());
+			}
+
+			regs[REG_ESP] = uint16_t(0x8000 + (m_Rand() & 0x3ffe));
+			status = uint16_t(m_Rand() & 0x08d5); // --> OF, SF, ZF, AF, PF, CF. (DF and IF clear)
+			iterations = uint16_t(8 + m_Rand() % 56);
+			extra = m_Rand() % 4 ? EXTRA_SEG : CODE_SEG;
+
+			// --> self-modifying: the loop starts with INC/DEC bytes that INSB patches with INC/DEC bytes.
+			if (extra == CODE_SEG) {
+				m_Items.push_back({ });
+				m_Skips.push_back(0);
+
+				for (uint32_t i = 0; i < PATCH; ++i) {
+					m_Items.back().push_back(uint8_t(0x40 + next(16)));
+				}
+			}
+
+			// --> items are up to 15 bytes, the loop closes with a rel8 branch.
+			uint32_t count = 8 + m_Rand() % 24;
+			for (uint32_t i = 0, size = uint32_t(m_Items.size()) * PATCH; i < count && size < MAX_BODY; ++i) {
+				size += item();
+			}
+
+			assemble();
+		}
+
+	public:
+		/* the same code with other registers, flags and iterations. (the stack stays) */
+		CProgram inputs(uint32_t seed) const {
+			CProgram out(*this);
+			out.m_Rand.seed(seed);
+
+			for (uint32_t i = 0; i < 8; ++i) {
+				out.regs[i] = i == REG_ESP ? regs[i] : uint16_t(out.m_Rand());
+			}
+
+			out.status = uint16_t(out.m_Rand() & 0x08d5);
+			out.iterations = uint16_t(8 + out.m_Rand() % 56);
+			return out;
+		}
+
+	private:
+		inline uint32_t next(uint32_t range) { return m_Rand() % range; }
+
+		/* ModRM, its displacement. `mem` forbids the register form. */
+		void modrm(std::vector<uint8_t>& out, uint8_t reg, bool mem = false) {
+			uint8_t mode = uint8_t(next(mem ? 3 : 4));
+			uint8_t rm = uint8_t(next(8));
+
+			out.push_back(uint8_t((mode << 6) | ((reg & 7) << 3) | rm));
+
+			if (mode == 1) {
+				out.push_back(uint8_t(m_Rand()));
+			}
+
+			else if (mode == 2 || (mode == 0 && rm == 6)) {
+				out.push_back(uint8_t(m_Rand()));
+				out.push_back(uint8_t(m_Rand()));
+			}
+		}
+
+		void imm(std::vector<uint8_t>& out, uint32_t size) {
+			for (uint32_t i = 0; i < size; ++i) {
+				out.push_back(uint8_t(m_Rand()));
+			}
+		}
+
+		/* append a random instruction, returns its size. */
+		uint32_t item() {
+			std::vector<uint8_t> out;
+			uint32_t skip = 0;
+
+			// --> segment override, the stack and the code segment too.
+			if (next(8) == 0) {
+				static const uint8_t SOV[4] = { 0x26, 0x2e, 0x36, 0x3e };
+				out.push_back(SOV[next(4)]);
+			}
+
+			// --> string writes into the loop are frequent when ES is the code segment.
+			switch (extra == CODE_SEG && next(3) == 0 ? 9 : next(12)) {
+			case 0: case 1: case 2: { /* ALU Eb Gb ~ Gv Ev */
+				out.push_back(uint8_t((next(8) << 3) | next(4)));
+				modrm(out, uint8_t(next(8)));
+				break;
+			}
+
+			case 3: { /* ALU AL Ib, eAX Iv */
+				uint8_t op = uint8_t((next(8) << 3) | (4 + next(2)));
+				out.push_back(op);
+				imm(out, (op & 1) ? 2 : 1);
+				break;
+			}
+
+			case 4: { /* GRP1 80 ~ 83 */
+				uint8_t op = uint8_t(0x80 + next(4));
+				out.push_back(op);
+				modrm(out, uint8_t(next(8)));
+				imm(out, op == 0x81 ? 2 : 1);
+				break;
+			}
+
+			case 5: { /* TEST, XCHG, MOV Eb Gb ~ Gv Ev */
+				out.push_back(uint8_t(0x84 + next(8)));
+				modrm(out, uint8_t(next(8)));
+				break;
+			}
+
+			case 6: { /* MOV Ew Sw, LEA, POP Ev, BOUND, IMUL */
+				switch (next(5)) {
+				case 0: out.push_back(0x8c); modrm(out, uint8_t(next(4))); break;
+				case 1: out.push_back(0x8d); modrm(out, uint8_t(next(8)), true); break;
+				case 2: out.push_back(0x8f); modrm(out, 0); break;
+				case 3: out.push_back(0x62); modrm(out, uint8_t(next(8)), true); break;
+				default: {
+					uint8_t op = next(2) ? 0x69 : 0x6b;
+					out.push_back(op);
+					modrm(out, uint8_t(next(8)));
+					imm(out, op == 0x69 ? 2 : 1);
+					break;
+				}
+				}
+				break;
+			}
+
+			case 7: { /* INC, DEC, PUSH, POP, PUSH segment */
+				static const uint8_t ONE[] = {
+					0x06, 0x0e, 0x16, 0x1e, 0x27, 0x2f, 0x37, 0x3f, 0x60, 0x61
+				};
+
+				if (next(3) == 0) {
+					out.push_back(ONE[next(sizeof(ONE))]);
+				}
+
+				else {
+					out.push_back(uint8_t(0x40 + next(32)));
+				}
+				break;
+			}
+
+			case 8: { /* PUSH Iv, Ib */
+				uint8_t op = next(2) ? 0x68 : 0x6a;
+				out.push_back(op);
+				imm(out, op == 0x68 ? 2 : 1);
+				break;
+			}
+
+			case 9: { /* (REP) INS, OUTS: XOR CX,CX; ADD CX,Ib; MOV DX,BX */
+				uint8_t at = uint8_t(next(PATCH));
+				bool patch = extra == CODE_SEG && next(2);
+
+				out.clear();
+				out.insert(out.end(), { 0x31, 0xc9, 0x83, 0xc1, uint8_t(patch ? 1 + next(PATCH - at) : next(24)), 0x89, 0xda });
+
+				// --> XOR DI,DI; ADD DI,Ib: into the patched bytes, or anywhere over the loop.
+				if (patch || next(2)) {
+					out.insert(out.end(), { 0x31, 0xff, 0x83, 0xc7, uint8_t(patch ? at : next(MAX_BODY)) });
+				}
+
+				if (patch || next(2)) {
+					out.push_back(0xf3);
+				}
+
+				out.push_back(uint8_t(patch ? 0x6c : 0x6c + next(4)));
+				break;
+			}
+
+			default: { /* Jcc forward */
+				out.clear();
+				out.push_back(uint8_t(0x70 + next(16)));
+				out.push_back(0);
+				skip = 1 + next(3);
+				break;
+			}
+			}
+
+			m_Items.push_back(out);
+			m_Skips.push_back(skip);
+			return uint32_t(out.size());
+		}
+
+		/* resolve the forward branches, then close the loop on the counter. */
+		void assemble() {
+			std::vector<uint32_t> offsets;
+
+			for (const auto& out : m_Items) {
+				offsets.push_back(uint32_t(code.size()));
+				code.insert(code.end(), out.begin(), out.end());
+			}
+
+			offsets.push_back(uint32_t(code.size()));
+
+			for (size_t i = 0; i < m_Items.size(); ++i) {
+				if (!m_Skips[i]) {
+					continue;
+				}
+
+				size_t target = i + 1 + m_Skips[i];
+				target = target < offsets.size() ? target : offsets.size() - 1;
+
+				uint32_t disp = offsets[target] - offsets[i + 1];
+				code[offsets[i] + 1] = uint8_t(disp < 128 ? disp : 0);
+			}
+
+			// --> SUB word [COUNTER],1; JNZ to the start. (the body is short enough for rel8)
+			code.insert(code.end(), { 0x83, 0x2e, uint8_t(COUNTER), uint8_t(COUNTER >> 8), 0x01 });
+			code.insert(code.end(), { 0x75, uint8_t(-int32_t(code.size() + 2)) });
+			code.push_back(0xf4); // --> HLT.
+		}
+	};
+
+	/* state compared between the tiers. */
+	struct result_t {
+		uint64_t instructions;
+		uint64_t cycles;
+		uint16_t regs[8];
+		uint16_t segs[4];
+		uint16_t offset; // --> IP.
+		uint16_t status; // --> FLAGS.
+		uint64_t memory;
+		uint64_t mmio;
+		uint64_t ports;
+		uint32_t stops; // --> watch modes: STOP_BREAKPOINT returns, not compared.
+	};
+
+	bool same(const result_t& a, const result_t& b) {
+		return a.instructions == b.instructions && a.cycles == b.cycles &&
+			!memcmp(a.regs, b.regs, sizeof(a.regs)) && !memcmp(a.segs, b.segs, sizeof(a.segs)) &&
+			a.offset == b.offset && a.status == b.status &&
+			a.memory == b.memory && a.mmio == b.mmio && a.ports == b.ports;
+	}
+
+	uint64_t digest(const result_t& r) {
+		uint64_t hash = fnv(&r.instructions, sizeof(r.instructions));
+		hash = fnv(&r.cycles, sizeof(r.cycles), hash);
+		hash = fnv(r.regs, sizeof(r.regs), hash);
+		hash = fnv(r.segs, sizeof(r.segs), hash);
+		hash = fnv(&r.offset, sizeof(r.offset), hash);
+		hash = fnv(&r.status, sizeof(r.status), hash);
+		hash = fnv(&r.memory, sizeof(r.memory), hash);
+		hash = fnv(&r.mmio, sizeof(r.mmio), hash);
+		return fnv(&r.ports, sizeof(r.ports), hash);
+	}
+
+	/* devices of a run, the processor holds them too. */
+	struct machine_t {
+		CFlatMemory* memory;
+		CLogMemory* mmio;
+		CPortBus* ports;
+		CLogPort* port;
+	};
+
+	/* attach fresh devices to the processor, load the program and its inputs. */
+	template<class TCpu>
+	machine_t attach(TCpu* cpu, const CProgram& program) {
+		machine_t m = { new CFlatMemory(), new CLogMemory(), new CPortBus(), new CLogPort() };
+
+		m.memory->setMmio(MMIO_ADDR, CMemoryBus::PAGE_SIZE, m.mmio);
+		m.ports->map(0, CPortBus::PORTS, m.port);
+
+		uint8_t* host = m.memory->getHost();
+		memcpy(host + (CODE_SEG << 4), program.code.data(), program.code.size());
+		host[(DATA_SEG << 4) + COUNTER] = uint8_t(program.iterations);
+		host[(DATA_SEG << 4) + COUNTER + 1] = uint8_t(program.iterations >> 8);
+
+		for (uint32_t addr = DATA_SEG << 4; addr < (DATA_SEG << 4) + 0xe000; ++addr) {
+			host[addr] = uint8_t(addr * 7 + (addr >> 8));
+		}
+
+		cpu->setMemory(m.memory);
+		cpu->setPort(m.ports);
+
+		USE_STATE(cpu, state);
+		for (uint32_t i = 0; i < 8; ++i) {
+			state->regs[i].word[REG_WORD] = program.regs[i];
+		}
+
+		state->segs[SEG_CS].dword = CODE_SEG;
+		state->segs[SEG_DS].dword = DATA_SEG;
+		state->segs[SEG_ES].dword = program.extra;
+		state->segs[SEG_SS].dword = STACK_SEG;
+		state->eip = 0;
+		state->flags = program.status;
+		return m;
+	}
+
+	/* read the compared state of the finished run. */
+	void collect(IProc* cpu, const machine_t& m, result_t* out) {
+		USE_STATE(cpu, state);
+
+		eflag_sync(state);
+		out->instructions = state->instructions;
+		out->cycles = state->cycles;
+		out->offset = state->ip;
+		out->status = state->flags;
+
+		for (uint32_t i = 0; i < 8; ++i) {
+			out->regs[i] = state->regs[i].word[REG_WORD];
+		}
+
+		for (uint32_t i = 0; i < 4; ++i) {
+			out->segs[i] = state->segs[i].word[REG_WORD];
+		}
+
+		out->memory = fnv(m.memory->getHost() + SPAN_BEGIN, SPAN_END - SPAN_BEGIN);
+		out->mmio = m.mmio->getLog();
+		out->ports = m.port->getLog();
+	}
+
+	/* release the references of the run, the processor keeps its own. */
+	void release(machine_t& m) {
+		m.memory->drop();
+		m.mmio->drop();
+		m.ports->drop();
+		m.port->drop();
+	}
+
+	/* run the program for `budget` instructions in the mode on `TCpu`, `run()` in batches from `seed`. */
+	template<class TCpu>
+	bool execute(const CProgram& program, EMODE mode, uint64_t budget, uint32_t seed, result_t* out) {
+		TCpu cpu;
+		machine_t m = attach(&cpu, program);
+		CTrace* trace = nullptr;
+		std::mt19937 batches(seed);
+
+		USE_STATE(&cpu, state);
+
+		switch (mode) {
+		case MODE_CACHE: case MODE_CACHE_WATCH:
+			cpu.setBlockCache(true);
+			break;
+
+		case MODE_JIT: case MODE_JIT_WATCH:
+			if (!cpu.setJit(true)) {
+				cpu.setMemory(nullptr);
+				cpu.setPort(nullptr);
+				release(m);
+				return false; // --> not an x86-64 host.
+			}
+			break;
+
+		case MODE_TRACE:
+			trace = new CTrace(1024);
+			cpu.setTrace(trace);
+			break;
+
+		default:
+			break;
+		}
+
+		if (mode == MODE_CACHE_WATCH || mode == MODE_JIT_WATCH) {
+			cpu.watch((DATA_SEG << 4) + (batches() & 0xfff0), 16, WATCH_RW);
+			cpu.watch((STACK_SEG << 4) + 0x8000, 0x4000, WATCH_WRITE);
+			cpu.watch((CODE_SEG << 4) + uint32_t(batches() % program.code.size()), 1, WATCH_EXEC);
+		}
+
+		out->stops = 0;
+
+		while (state->instructions < budget && !cpu.isHalted()) {
+			if (mode == MODE_STEP) {
+				cpu.exec();
+				continue;
+			}
+
+			uint64_t left = budget - state->instructions;
+			uint64_t batch = 1 + batches() % 300;
+			ESTOP reason = cpu.run(batch < left ? batch : left, UINT64_MAX);
+
+			if (reason == STOP_BREAKPOINT) {
+				out->stops++;
+			}
+
+			// --> drain the trace, nothing reads it.
+			if (trace) {
+				trace->release(trace->getPending());
+			}
+		}
+
+		collect(&cpu, m, out);
+
+		cpu.setTrace(nullptr);
+		cpu.setMemory(nullptr);
+		cpu.setPort(nullptr);
+
+		if (trace) {
+			trace->drop();
+		}
+
+		release(m);
+		return true;
+	}
+
+	/* run the program in the mode, the bound modes run the tier on `CBoundCpu`. */
+	bool execute(const CProgram& program, EMODE mode, uint64_t budget, uint32_t seed, result_t* out) {
+		switch (mode) {
+		case MODE_BOUND:
+			return execute<CBoundCpu>(program, MODE_INTERP, budget, seed, out);
+
+		case MODE_BOUND_CACHE:
+			return execute<CBoundCpu>(program, MODE_CACHE, budget, seed, out);
+
+		case MODE_BOUND_JIT_WATCH:
+			return execute<CBoundCpu>(program, MODE_JIT_WATCH, budget, seed, out);
+
+		default:
+			return execute<Ci8086>(program, mode, budget, seed, out);
+		}
+	}
+
+	void report(uint32_t seed, const char* name, const result_t& ref, const result_t& got) {
+		printf("seed %u: %s differs from interp\n", seed, name);
+		printf("  instructions %llu / %llu, cycles %llu / %llu, ip %04x / %04x, flags %04x / %04x\n",
+			(unsigned long long)got.instructions, (unsigned long long)ref.instructions,
+			(unsigned long long)got.cycles, (unsigned long long)ref.cycles,
+			got.offset, ref.offset, got.status, ref.status);
+
+		for (uint32_t i = 0; i < 8; ++i) {
+			if (got.regs[i] != ref.regs[i]) {
+				printf("  reg %u %04x / %04x\n", i, got.regs[i], ref.regs[i]);
+			}
+		}
+
+		printf("  memory %s, mmio %s, ports %s\n",
+			got.memory == ref.memory ? "same" : "differs",
+			got.mmio == ref.mmio ? "same" : "differs",
+			got.ports == ref.ports ? "same" : "differs");
+	}
+
+	/**
+	 * run lanes of the program with their own inputs in lockstep, `CLockstep::run()` in batches from `seed`,
+	 * and compare each lane with the interpreter on its inputs. returns the mismatches.
+	 */
+	uint32_t lockstep(const CProgram& program, uint64_t budget, uint32_t seed, lockstat_t* stat) {
+		CLockstep lockstep;
+		std::vector<CProgram> inputs;
+		machine_t machines[LANES];
+		std::mt19937 batches(seed);
+		uint32_t failed = 0;
+
+		for (uint32_t i = 0; i < LANES; ++i) {
+			Ci8086* cpu = new Ci8086();
+
+			// --> lane 0 runs the inputs of the tiers.
+			inputs.push_back(i ? program.inputs(seed * LANES + i) : program);
+			machines[i] = attach(cpu, inputs.back());
+			lockstep.add(cpu);
+		}
+
+		// --> the lanes left running have used the same instructions.
+		for (uint64_t done = 0; done < budget; ) {
+			uint64_t batch = 1 + batches() % 300;
+			batch = batch < budget - done ? batch : budget - done;
+
+			if (lockstep.run(batch) == LANES) {
+				break;
+			}
+
+			done += batch;
+		}
+
+		for (uint32_t i = 0; i < LANES; ++i) {
+			result_t ref, got;
+			char name[32];
+
+			execute<Ci8086>(inputs[i], MODE_INTERP, budget, seed, &ref);
+			collect(lockstep.getProc(i), machines[i], &got);
+
+			if (!same(ref, got)) {
+				snprintf(name, sizeof(name), "lockstep lane %u", i);
+				report(seed, name, ref, got);
+				failed++;
+			}
+
+			release(machines[i]);
+		}
+
+		stat->steps += lockstep.getStat()->steps;
+		stat->vector += lockstep.getStat()->vector;
+		stat->scalar += lockstep.getStat()->scalar;
+		stat->peels += lockstep.getStat()->peels;
+		return failed;
+	}
+}
+
+int main(int argc, char** argv) {
+	uint32_t programs = 300;
+	uint32_t first = 1;
+	uint64_t budget = 20000;
+	const char* path = nullptr;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--programs")) {
+			programs = uint32_t(atoi(argv[i + 1]));
+		}
+
+		else if (!strcmp(argv[i], "--seed")) {
+			first = uint32_t(atoi(argv[i + 1]));
+		}
+
+		else if (!strcmp(argv[i], "--budget")) {
+			budget = uint64_t(atoll(argv[i + 1]));
+		}
+
+		else if (!strcmp(argv[i], "--digest")) {
+			path = argv[i + 1];
+		}
+
+		else {
+			fprintf(stderr, "usage: %s [--programs N] [--seed N] [--budget N] [--digest FILE]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	FILE* file = path ? fopen(path, "w") : nullptr;
+	uint32_t failed = 0, stops = 0;
+	lockstat_t stat = { };
+
+	for (uint32_t seed = first; seed < first + programs; ++seed) {
+		CProgram program(seed);
+		result_t ref, got;
+
+		execute(program, MODE_INTERP, budget, seed, &ref);
+
+		for (uint32_t mode = MODE_INTERP + 1; mode < MODE_MAX; ++mode) {
+			if (!execute(program, EMODE(mode), budget, seed, &got)) {
+				continue;
+			}
+
+			stops += got.stops;
+
+			if (!same(ref, got)) {
+				report(seed, MODES[mode], ref, got);
+				failed++;
+			}
+		}
+
+		failed += lockstep(program, budget, seed, &stat);
+
+		if (file) {
+			fprintf(file, "%u %016llx\n", seed, (unsigned long long)digest(ref));
+		}
+	}
+
+	if (file) {
+		fclose(file);
+	}
+
+	printf("%u programs, %u modes, %u mismatches, %u watch stops\n",
+		programs, uint32_t(MODE_MAX), failed, stops);
+	printf("lockstep: %llu vector steps, %llu vector and %llu scalar instructions, %llu peels\n",
+		(unsigned long long)stat.steps, (unsigned long long)stat.vector,
+		(unsigned long long)stat.scalar, (unsigned long long)stat.peels);
+
+	// --> lanes of the same code meet: a lockstep that never runs vector steps is broken too.
+	return failed || (programs && !stat.vector) ? 1 : 0;
+}
\ No newline at end of file
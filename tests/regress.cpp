@@ -0,0 +1,1109 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// --> after the standard headers, the register macros collide with them.
+#include "vm/scheduler.h" // --> first: it includes standard headers too.
+#include "cpu/i8086t.h"
+#include "dev/cow.h"
+#include "dev/disk.h"
+#include "dev/flat.h"
+#include "dev/portbus.h"
+#include "vm/lockstep.h"
+#include "vm/replay.h"
+#include "vm/template.h"
+#include "vm/tracefile.h"
+
+using namespace v86;
+
+/**
+ * regression tests of reviewed bugs and features, one function per case.
+ * every tier runs each case, the process fails if any check does.
+ */
+namespace {
+	constexpr uint16_t CODE_SEG = 0x1000;
+	constexpr uint16_t STACK_SEG = 0x4000;
+
+	/* INC CX; CMP AX, AX; JZ -5: loops forever. */
+	const uint8_t LOOP[] = { 0x41, 0x39, 0xc0, 0x74, 0xfb };
+
+	/* execution tier of a case. */
+	enum EMODE {
+		MODE_INTERP = 0,
+		MODE_CACHE,
+		MODE_JIT,
+		MODE_TRACE,
+		MODE_MAX,
+	};
+
+	const char* const MODES[MODE_MAX] = {
+		"interp", "cache", "jit", "trace"
+	};
+
+	uint32_t failures = 0;
+
+	void check(bool ok, const char* test, EMODE mode, const char* what) {
+		if (!ok) {
+			fprintf(stderr, "%s (%s): %s\n", test, MODES[mode], what);
+			failures++;
+		}
+	}
+
+	/* port whose reads return the same byte. */
+	class CBytePort : public IPort {
+	private:
+		uint8_t m_Value;
+
+	public:
+		CBytePort(uint8_t value) : m_Value(value) { }
+
+	public:
+		virtual bool read(uint16_t, uint8_t* value) override {
+			*value = m_Value;
+			return true;
+		}
+
+		virtual bool write(uint16_t, uint8_t) override {
+			return true;
+		}
+	};
+
+	/* select the cache or jit tier of `cpu`, false if the host can not run it. */
+	bool setTier(Ci8086* cpu, EMODE mode) {
+		switch (mode) {
+		case MODE_CACHE:
+			cpu->setBlockCache(true);
+			return true;
+
+		case MODE_JIT:
+			return cpu->setJit(true);
+
+		default:
+			return true;
+		}
+	}
+
+	/* processor with flat memory, the code at CS:0 and every port reading `value`. */
+	class CMachine {
+	public:
+		Ci8086 cpu;
+		CTrace* trace;
+		uint8_t* host;
+
+	public:
+		CMachine(const uint8_t* code, uint32_t size, uint8_t value = 0xff) : trace(nullptr) {
+			CFlatMemory* memory = new CFlatMemory();
+			CPortBus* ports = new CPortBus();
+			CBytePort* port = new CBytePort(value);
+
+			ports->map(0, CPortBus::PORTS, port);
+			port->drop();
+
+			cpu.setMemory(memory);
+			cpu.setPort(ports);
+			memory->drop();
+			ports->drop();
+
+			host = memory->getHost();
+			memcpy(host + (CODE_SEG << 4), code, size);
+
+			USE_STATE(&cpu, state);
+			state->segs[SEG_CS].dword = CODE_SEG;
+			state->segs[SEG_SS].dword = STACK_SEG;
+			state->sp = 0x100;
+		}
+
+		~CMachine() {
+			cpu.setTrace(nullptr);
+			cpu.setMemory(nullptr);
+			cpu.setPort(nullptr);
+
+			if (trace) {
+				trace->drop();
+			}
+		}
+
+	public:
+		/* select the tier, false if the host can not run it. */
+		bool setMode(EMODE mode) {
+			if (mode != MODE_TRACE) {
+				return setTier(&cpu, mode);
+			}
+
+			trace = new CTrace(1 << 16);
+			cpu.setTrace(trace);
+			return true;
+		}
+	};
+
+	/* an interrupt request raised while IF is clear waits, and must not stall `run()`. */
+	void irqMasked(EMODE mode) {
+		static const char* TEST = "irq masked";
+		CMachine vm(LOOP, sizeof(LOOP));
+		USE_STATE(&vm.cpu, state);
+
+		if (!vm.setMode(mode)) {
+			return;
+		}
+
+		vm.cpu.setIrq(true);
+
+		// --> hot enough for the cache and the translator.
+		for (uint32_t i = 0; i < 3; ++i) {
+			ESTOP reason = vm.cpu.run(1000, UINT64_MAX);
+			check(reason == STOP_BUDGET, TEST, mode, "the batch does not end at the budget");
+
+			if (vm.trace) {
+				vm.trace->release(vm.trace->getPending());
+			}
+		}
+
+		check(state->instructions == 3000, TEST, mode, "instructions are lost");
+
+		// --> STI: the next batch stops for the request at once.
+		eflag<EFLAG_IT>(state, 1);
+		check(vm.cpu.run(1000, UINT64_MAX) == STOP_IRQ, TEST, mode, "IF set, the request does not stop");
+		check(state->instructions == 3000, TEST, mode, "IF set, instructions run past the request");
+	}
+
+	/* STI, installed by the host: the core has no IF instructions. */
+	void onSti(Ci8086* cpu, uint8_t) {
+		USE_STATE(cpu, state);
+		eflag<EFLAG_IT>(state, 1);
+	}
+
+	/* STI inside the batch stops it for the pending request. */
+	void irqEnabled(EMODE mode) {
+		static const char* TEST = "irq enabled";
+		static const uint8_t CODE[] = { 0x41, 0x39, 0xc0, 0x75, 0x01, 0xfb, 0x41, 0xeb, 0xfd };
+		CMachine vm(CODE, sizeof(CODE));
+		USE_STATE(&vm.cpu, state);
+
+		if (!vm.setMode(mode)) {
+			return;
+		}
+
+		vm.cpu.setOpcode(0xfb, onSti);
+
+		// --> the first two instructions run masked, JNZ falls through to STI.
+		vm.cpu.setIrq(true);
+		ESTOP reason = vm.cpu.run(1000, UINT64_MAX);
+
+		check(reason == STOP_IRQ, TEST, mode, "the request does not stop after STI");
+		check(state->instructions == 4, TEST, mode, "the batch does not stop after STI");
+		check(state->ip == 6, TEST, mode, "the batch stops at the wrong instruction");
+	}
+
+	/* a scheduler worker runs a VM with a masked request, and stops. */
+	void irqScheduler() {
+		static const char* TEST = "irq scheduler";
+		CVmScheduler scheduler(1, 1000);
+
+		Ci8086* cpu = new Ci8086();
+		CFlatMemory* memory = new CFlatMemory();
+
+		memcpy(memory->getHost() + (CODE_SEG << 4), LOOP, sizeof(LOOP));
+		cpu->setMemory(memory);
+		memory->drop();
+
+		USE_STATE(cpu, state);
+		state->segs[SEG_CS].dword = CODE_SEG;
+		cpu->setIrq(true);
+
+		uint32_t id = scheduler.add(cpu);
+		scheduler.start();
+
+		for (uint32_t i = 0; i < 200 && scheduler.getStat(id)->instructions.load() < 100000; ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+
+		scheduler.stop();
+		check(scheduler.getStat(id)->instructions.load() >= 100000, TEST, MODE_INTERP, "the VM does not run");
+	}
+
+	/* REP INSB over a translated instruction: the loop runs the new byte. */
+	void insTranslated(EMODE mode) {
+		static const char* TEST = "rep ins over code";
+		static const uint8_t INS[] = { 0xf3, 0x6c, 0xf4 }; // --> REP INSB; HLT.
+		CMachine vm(LOOP, sizeof(LOOP), 0x42); // --> INC DX.
+		USE_STATE(&vm.cpu, state);
+
+		if (!vm.setMode(mode)) {
+			return;
+		}
+
+		memcpy(vm.host + ((CODE_SEG + 0x100) << 4), INS, sizeof(INS));
+
+		// --> 100 iterations: hot in the cache and the translator.
+		vm.cpu.run(300, UINT64_MAX);
+
+		state->segs[SEG_CS].dword = CODE_SEG + 0x100;
+		state->segs[SEG_ES].dword = CODE_SEG;
+		state->ip = 0;
+		state->di = 0;
+		state->cx = 1;
+		state->dx = 0;
+		vm.cpu.run(1, UINT64_MAX);
+
+		check(vm.host[CODE_SEG << 4] == 0x42, TEST, mode, "the byte is not written");
+
+		state->segs[SEG_CS].dword = CODE_SEG;
+		state->ip = 0;
+		state->cx = 0;
+		vm.cpu.run(300, UINT64_MAX);
+
+		check(state->dx == 100 && state->cx == 0, TEST, mode, "the old instruction runs");
+	}
+
+	/* a bound processor takes its backends through `IProc` only if they are the bound instances. */
+	void boundAttach() {
+		static const char* TEST = "bound attach";
+		Ci8086T<CMemoryBus, CPortBus> cpu;
+		IProc* proc = &cpu;
+		CFlatMemory* memory = new CFlatMemory();
+		CPortBus* ports = new CPortBus();
+		CBytePort* port = new CBytePort(0x42);
+
+		check(cpu.setMemory(memory) && cpu.setPort(ports), TEST, MODE_INTERP, "the typed setters fail");
+		check(proc->setPort(ports), TEST, MODE_INTERP, "the bound port is not taken");
+		check(!proc->setPort(port) && proc->getPort() == ports, TEST, MODE_INTERP, "another port is taken");
+		check(!proc->setMemory(nullptr) && proc->getMemory() == memory, TEST, MODE_INTERP, "the memory is detached");
+
+		// --> the interface type takes any port.
+		Ci8086T<CMemoryBus, IPort> erased;
+		check(static_cast<IProc*>(&erased)->setPort(port) && erased.inb(0) == 0x42, TEST, MODE_INTERP, "the port is not taken");
+
+		cpu.setMemory(nullptr);
+		cpu.setPort(nullptr);
+		memory->drop();
+		ports->drop();
+		port->drop();
+	}
+
+	/* a template forks into a bound processor through its typed setter, and fails through `IProc`. */
+	void boundFork() {
+		static const char* TEST = "bound fork";
+		CMachine vm(LOOP, sizeof(LOOP));
+		USE_STATE(&vm.cpu, state);
+
+		vm.cpu.run(30, UINT64_MAX);
+
+		CVmTemplate* image = CVmTemplate::capture(&vm.cpu);
+		Ci8086T<CMemoryBus, CPortBus> cpu;
+		USE_STATE(&cpu, fork);
+
+		check(image->fork(&cpu) && cpu.getBus(), TEST, MODE_INTERP, "the bound processor does not take the fork");
+		check(fork->cx == state->cx && fork->ip == state->ip, TEST, MODE_INTERP, "the state is not forked");
+
+		cpu.run(30, UINT64_MAX);
+		check(fork->cx == state->cx + 10, TEST, MODE_INTERP, "the fork does not run");
+
+		// --> through `IProc`, the bound memory stays and the state is untouched.
+		Ci8086T<CMemoryBus, CPortBus> other;
+		CFlatMemory* memory = new CFlatMemory();
+		USE_STATE(&other, kept);
+
+		other.setMemory(memory);
+		check(!image->fork(static_cast<IProc*>(&other)), TEST, MODE_INTERP, "the fork is taken through IProc");
+		check(other.getMemory() == memory && kept->cx == 0, TEST, MODE_INTERP, "the failed fork changes the processor");
+
+		cpu.setMemory(nullptr);
+		other.setMemory(nullptr);
+		memory->drop();
+		image->drop();
+	}
+
+	/* lanes with a breakpoint in the loop stop at it, lockstep does not run them past it. */
+	void lockstepBreak() {
+		static const char* TEST = "lockstep breakpoint";
+		constexpr uint32_t LANES = 4;
+		CLockstep lockstep;
+
+		for (uint32_t i = 0; i < LANES; ++i) {
+			Ci8086* cpu = new Ci8086();
+			CFlatMemory* memory = new CFlatMemory();
+
+			memcpy(memory->getHost() + (CODE_SEG << 4), LOOP, sizeof(LOOP));
+			cpu->setMemory(memory);
+			memory->drop();
+
+			USE_STATE(cpu, state);
+			state->segs[SEG_CS].dword = CODE_SEG;
+
+			// --> at JZ, on the odd lanes.
+			if (i & 1) {
+				cpu->watch((CODE_SEG << 4) + 3, 1, WATCH_EXEC);
+			}
+
+			lockstep.add(cpu);
+		}
+
+		check(lockstep.run(1000) == LANES / 2, TEST, MODE_INTERP, "the lanes with breakpoints do not stop");
+
+		for (uint32_t i = 0; i < LANES; ++i) {
+			USE_STATE(lockstep.getProc(i), state);
+
+			if (i & 1) {
+				check(lockstep.getStop(i) == STOP_BREAKPOINT && state->ip == 3 && state->instructions == 2,
+					TEST, MODE_INTERP, "the lane runs past the breakpoint");
+			}
+
+			else {
+				check(lockstep.getStop(i) == STOP_BUDGET && state->instructions == 1000,
+					TEST, MODE_INTERP, "the lane without breakpoints stops");
+			}
+		}
+
+		check(lockstep.getStat()->vector > 0, TEST, MODE_INTERP, "the lanes do not run in lockstep");
+	}
+
+	/* scratch image in the working directory, two pages of a pattern. */
+	const char* const IMAGE_PATH = "regress_image.bin";
+	constexpr uint32_t IMAGE_SIZE = 2 * CMemoryBus::PAGE_SIZE;
+
+	bool makeImage() {
+		FILE* file = fopen(IMAGE_PATH, "wb");
+		uint8_t bytes[IMAGE_SIZE];
+
+		for (uint32_t i = 0; i < IMAGE_SIZE; ++i) {
+			bytes[i] = uint8_t(i * 7);
+		}
+
+		bool ok = file && fwrite(bytes, 1, IMAGE_SIZE, file) == IMAGE_SIZE;
+
+		if (file) {
+			fclose(file);
+		}
+
+		return ok;
+	}
+
+	/* read the byte of the scratch image from the file. */
+	int readImage(uint32_t offset) {
+		FILE* file = fopen(IMAGE_PATH, "rb");
+		int value = -1;
+
+		if (file) {
+			if (!fseek(file, long(offset), SEEK_SET)) {
+				value = fgetc(file);
+			}
+
+			fclose(file);
+		}
+
+		return value;
+	}
+
+	/* ROM images drop writes through the bus, private ones keep them from the file, shared ones write them back. */
+	void imageModes() {
+		static const char* TEST = "image modes";
+		constexpr uint32_t BASE = 0x20000;
+		constexpr uint32_t EXTENDED = IMAGE_SIZE + CMemoryBus::PAGE_SIZE;
+		const uint8_t value = 0x5a;
+		uint8_t byte = 0;
+
+		if (!makeImage()) {
+			check(false, TEST, MODE_INTERP, "the scratch image can not be written");
+			return;
+		}
+
+		CImage* rom = CImage::open(IMAGE_PATH, IMAGE_ROM, EXTENDED);
+		CImage* priv = CImage::open(IMAGE_PATH, IMAGE_PRIVATE, EXTENDED);
+		CMemoryBus* bus = new CMemoryBus();
+
+		check(rom && rom->getSize() == IMAGE_SIZE, TEST, MODE_INTERP, "the ROM image is not the file");
+		check(priv && priv->getSize() == EXTENDED, TEST, MODE_INTERP, "the private image is not extended");
+
+		if (rom && priv) {
+			bus->map(BASE, rom);
+			bus->map(BASE + IMAGE_SIZE, priv);
+
+			bus->write(BASE + 1, &value, 1);
+			bus->read(BASE + 1, &byte, 1);
+			check(byte == 7, TEST, MODE_INTERP, "a write to the ROM is taken");
+
+			bus->write(BASE + IMAGE_SIZE + 1, &value, 1);
+			bus->read(BASE + IMAGE_SIZE + 1, &byte, 1);
+			check(byte == value, TEST, MODE_INTERP, "a write to the private image is dropped");
+
+			bus->read(BASE + IMAGE_SIZE + EXTENDED - 1, &byte, 1);
+			check(byte == 0 && !priv->getHost()[IMAGE_SIZE], TEST, MODE_INTERP, "the extension is not zero");
+		}
+
+		if (rom) {
+			rom->drop();
+		}
+
+		if (priv) {
+			priv->drop();
+		}
+
+		bus->drop();
+		check(readImage(1) == 7, TEST, MODE_INTERP, "the file is changed");
+
+		// --> a shared image is written back on `sync()`.
+		CImage* shared = CImage::open(IMAGE_PATH, IMAGE_SHARED);
+		check(shared != nullptr, TEST, MODE_INTERP, "the shared image is not mapped");
+
+		if (shared) {
+			bus = new CMemoryBus();
+			bus->map(BASE, shared);
+			bus->write(BASE + 1, &value, 1);
+
+			check(shared->sync() && readImage(1) == value, TEST, MODE_INTERP, "the shared image is not written back");
+
+			shared->drop();
+			bus->drop();
+		}
+
+		remove(IMAGE_PATH);
+	}
+
+	/* disk accesses are clamped to the sectors of the image, ROM disks take no writes. */
+	void diskRange() {
+		static const char* TEST = "disk range";
+		constexpr uint32_t SECTORS = IMAGE_SIZE / CDiskImage::SECTOR_SIZE;
+		uint8_t buf[4 * CDiskImage::SECTOR_SIZE];
+
+		if (!makeImage()) {
+			check(false, TEST, MODE_INTERP, "the scratch image can not be written");
+			return;
+		}
+
+		CImage* image = CImage::open(IMAGE_PATH, IMAGE_PRIVATE);
+		CImage* rom = CImage::open(IMAGE_PATH, IMAGE_ROM);
+
+		if (!image || !rom) {
+			check(false, TEST, MODE_INTERP, "the image is not mapped");
+		}
+
+		else {
+			CDiskImage* disk = new CDiskImage(image);
+			CDiskImage* fixed = new CDiskImage(rom);
+
+			check(disk->getSectors() == SECTORS, TEST, MODE_INTERP, "the sectors are not the image");
+			check(disk->read(SECTORS - 1, buf, 4) == 1 && buf[0] == uint8_t((IMAGE_SIZE - CDiskImage::SECTOR_SIZE) * 7),
+				TEST, MODE_INTERP, "the read past the end is not clamped");
+			check(disk->read(SECTORS, buf, 1) == 0, TEST, MODE_INTERP, "a read at the end is taken");
+			check(disk->write(SECTORS - 2, buf, 4) == 2, TEST, MODE_INTERP, "the write past the end is not clamped");
+			check(!disk->direct(SECTORS - 1, 2) && disk->direct(SECTORS - 1, 1), TEST, MODE_INTERP, "direct() is not clamped");
+			check(fixed->write(0, buf, 1) == 0, TEST, MODE_INTERP, "the ROM disk takes writes");
+
+			disk->drop();
+			fixed->drop();
+		}
+
+		if (image) {
+			image->drop();
+		}
+
+		if (rom) {
+			rom->drop();
+		}
+
+		remove(IMAGE_PATH);
+	}
+
+	/* PUSH CS+1; POP CS: at CS+1:4, ADD CX,50; then ADD AX; SUB BX,AX; PUSH AX; POP DX; DEC CX; JNZ; HLT. */
+	const uint8_t TRACED[] = {
+		0x68, uint8_t(CODE_SEG + 1), uint8_t((CODE_SEG + 1) >> 8), 0x0f,
+		0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90,
+		0x83, 0xc1, 0x32, 0x05, 0x34, 0x12, 0x29, 0xc3, 0x50, 0x5a, 0x49, 0x75, 0xf6, 0xf4
+	};
+
+	/* records written by the trace writer read back as the instructions that ran, registers and FLAGS included. */
+	void traceFile(bool compress) {
+		const char* TEST = compress ? "trace file, compressed" : "trace file";
+		static const char* PATH = "regress_trace.bin";
+		std::vector<trace_t> expected;
+
+		// --> the reference: one instruction at a time, FLAGS evaluated.
+		CMachine ref(TRACED, sizeof(TRACED));
+		USE_STATE(&ref.cpu, state);
+		USE_FETCH_STATE(&ref.cpu, fst);
+
+		while (!ref.cpu.isHalted() && expected.size() < 1000) {
+			trace_t rec = { };
+
+			rec.seg = uint16_t(state->cs);
+			rec.off = state->ip;
+			ref.cpu.exec();
+
+			eflag_sync(state);
+			rec.length = fst->length;
+			memcpy(rec.bytes, ref.host + (rec.seg << 4) + rec.off, rec.length);
+
+			for (uint32_t i = 0; i < 8; ++i) {
+				rec.regs[TRACE_AX + i] = state->regs[i].word[REG_WORD];
+			}
+
+			for (uint32_t i = 0; i < 4; ++i) {
+				rec.regs[TRACE_ES + i] = state->segs[i].word[REG_WORD];
+			}
+
+			rec.regs[TRACE_FLAGS] = state->flags;
+			expected.push_back(rec);
+		}
+
+		// --> a small ring: the processor waits for the writer.
+		CMachine vm(TRACED, sizeof(TRACED));
+		CTraceWriter writer;
+
+		vm.trace = new CTrace(64, TRACE_REGS);
+		vm.cpu.setTrace(vm.trace);
+		check(writer.add(vm.trace, PATH, compress), TEST, MODE_TRACE, "the file is not created");
+
+		while (!vm.cpu.isHalted()) {
+			vm.cpu.run(1000, UINT64_MAX);
+		}
+
+		writer.stop();
+		check(writer.getRecords() == expected.size(), TEST, MODE_TRACE, "records are lost");
+
+		CTraceReader reader;
+		trace_t rec;
+		uint32_t count = 0, wrong = 0;
+
+		check(reader.open(PATH) && reader.getFlags() == TRACE_REGS, TEST, MODE_TRACE, "the file is not read");
+
+		while (reader.next(&rec)) {
+			const trace_t* want = count < expected.size() ? &expected[count] : nullptr;
+			count++;
+
+			if (!want || rec.seg != want->seg || rec.off != want->off || rec.length != want->length
+				|| memcmp(rec.bytes, want->bytes, rec.length) || memcmp(rec.regs, want->regs, sizeof(rec.regs)))
+			{
+				wrong++;
+			}
+		}
+
+		check(count == expected.size(), TEST, MODE_TRACE, "the records do not read back");
+		check(!wrong, TEST, MODE_TRACE, "a record differs from the instruction");
+
+		reader.close();
+		remove(PATH);
+	}
+
+	/* port whose reads count up, so a replay that skips the log reads something else. */
+	class CCountPort : public IPort {
+	private:
+		uint8_t m_Next;
+
+	public:
+		CCountPort() : m_Next(1) { }
+
+	public:
+		virtual bool read(uint16_t, uint8_t* value) override {
+			*value = m_Next++;
+			return true;
+		}
+
+		virtual bool write(uint16_t, uint8_t) override {
+			return true;
+		}
+	};
+
+	/* INSB; ADD CX,3; REP INSW; ADD AX,[100]; ADD AX,SI; DEC BP; JNZ; HLT. */
+	const uint8_t REPLAYED[] = {
+		0x6c, 0x83, 0xc1, 0x03, 0xf3, 0x6d, 0x03, 0x06, 0x00, 0x01, 0x01, 0xf0, 0x4d, 0x75, 0xf1, 0xf4
+	};
+
+	/**
+	 * the host of the replayed guest, the same calls in both modes:
+	 * DMA into [100] before the 5th batch, an interrupt request before the 9th, its vector into SI.
+	 */
+	void replayHost(CMachine& vm, CReplay* replay, bool recording) {
+		USE_STATE(&vm.cpu, state);
+		const uint16_t data = recording ? 0x1111 : 0xdead; // --> ignored while replaying.
+
+		for (uint32_t batch = 0; batch < 1000 && !vm.cpu.isHalted(); ++batch) {
+			if (batch == 5) {
+				replay->dma((CODE_SEG + 0x100) * 16 + 0x100, &data, sizeof(data));
+			}
+
+			if (batch == 9 && recording) {
+				vm.cpu.setIrq(true);
+			}
+
+			if (replay->run(37, UINT64_MAX) == STOP_IRQ) {
+				state->si = replay->acknowledge(recording ? 0x42 : 0x00);
+				vm.cpu.setIrq(false);
+			}
+		}
+	}
+
+	/* a replay without devices ends in the recorded state: port reads, DMA and the interrupt come from the log. */
+	void replayLog() {
+		static const char* TEST = "replay";
+		static const char* PATH = "regress_replay.bin";
+		CMachine rec(REPLAYED, sizeof(REPLAYED));
+		CMachine play(REPLAYED, sizeof(REPLAYED));
+		CPortBus* ports = new CPortBus();
+		CCountPort* port = new CCountPort();
+
+		ports->map(0, CPortBus::PORTS, port);
+		rec.cpu.setPort(ports);
+		play.cpu.setPort(nullptr);
+		port->drop();
+		ports->drop();
+
+		for (CMachine* vm : { &rec, &play }) {
+			USE_STATE(&vm->cpu, state);
+			state->segs[SEG_DS].dword = CODE_SEG + 0x100;
+			state->segs[SEG_ES].dword = CODE_SEG + 0x200;
+			state->bp = 100;
+			eflag<EFLAG_IT>(state, 1);
+		}
+
+		CReplay* replay = CReplay::record(&rec.cpu, PATH);
+		check(replay != nullptr, TEST, MODE_INTERP, "the log is not created");
+
+		if (!replay) {
+			return;
+		}
+
+		replayHost(rec, replay, true);
+		replay->close();
+		replay->drop();
+
+		replay = CReplay::replay(&play.cpu, PATH);
+		check(replay != nullptr, TEST, MODE_INTERP, "the log is not opened");
+
+		if (!replay) {
+			return;
+		}
+
+		replayHost(play, replay, false);
+		check(!replay->isDiverged() && replay->isFinished(), TEST, MODE_INTERP, "the replay diverges");
+
+		replay->close();
+		replay->drop();
+
+		USE_STATE(&rec.cpu, a);
+		USE_STATE(&play.cpu, b);
+		eflag_sync(a);
+		eflag_sync(b);
+
+		check(rec.cpu.isHalted() && a->si == 0x42, TEST, MODE_INTERP, "the recorded guest does not run");
+		check(!memcmp(a, b, sizeof(state_t)), TEST, MODE_INTERP, "the state differs");
+		check(!memcmp(rec.host, play.host, CFlatMemory::SIZE), TEST, MODE_INTERP, "the memory differs");
+
+		remove(PATH);
+	}
+
+	/* MOV [5000],BX; MOV ES:[0],BX (ROM); MOV [5002],BX; HLT. */
+	const uint8_t COW[] = {
+		0x89, 0x1e, 0x00, 0x50, 0x26, 0x89, 0x1e, 0x00, 0x00, 0x89, 0x1e, 0x02, 0x50, 0xf4
+	};
+
+	/* forks share the template: the first write copies its page only, ROM drops writes, the others see nothing. */
+	void cowFork(EMODE mode) {
+		static const char* TEST = "cow fork";
+		static uint8_t rom[CMemoryBus::PAGE_SIZE];
+		CMachine vm(COW, sizeof(COW));
+		USE_STATE(&vm.cpu, state);
+
+		if (mode == MODE_TRACE) {
+			return;
+		}
+
+		memset(rom, 0xab, sizeof(rom));
+		vm.cpu.getBus()->map(0xf0000, sizeof(rom), rom, PAGE_READ);
+		vm.host[0x5000] = 0x11;
+
+		state->segs[SEG_DS].dword = 0;
+		state->segs[SEG_ES].dword = 0xf000;
+		state->bx = 0x7777;
+
+		CVmTemplate* image = CVmTemplate::capture(&vm.cpu);
+		Ci8086 a, b;
+
+		image->fork(&a);
+		image->fork(&b);
+
+		CCowMemory* memory = dynamic_cast<CCowMemory*>(a.getMemory());
+		check(memory && !memory->getCopies(), TEST, mode, "the fork is not copy-on-write");
+
+		if (!memory || !setTier(&a, mode)) {
+			image->drop();
+			return;
+		}
+
+		while (!a.isHalted() && a.getState()->instructions < 100) {
+			a.run(100, UINT64_MAX);
+		}
+
+		uint8_t bytes[4] = { }, shared = 0, fixed = 0;
+		a.read(0x5000, bytes, sizeof(bytes));
+		a.read(0xf0000, &fixed, 1);
+		b.read(0x5000, &shared, 1);
+
+		check(a.isHalted() && bytes[0] == 0x77 && bytes[3] == 0x77, TEST, mode, "the writes are lost");
+		check(memory->getCopies() == 1, TEST, mode, "the writes do not copy exactly one page");
+		check(fixed == 0xab, TEST, mode, "the ROM takes the write");
+		check(shared == 0x11 && !b.getState()->instructions, TEST, mode, "the sibling fork sees the write");
+
+		// --> a later fork starts from the template, not from the first one.
+		Ci8086 c;
+		image->fork(&c);
+		c.read(0x5000, &shared, 1);
+		check(shared == 0x11 && !dynamic_cast<CCowMemory*>(c.getMemory())->getCopies(), TEST, mode, "the template is changed");
+
+		image->drop();
+	}
+
+	/* alarms of a wheel case, and the advance that fired each. */
+	struct alarms_t {
+		CTimerWheel* wheel;
+		IProc* cpu; // --> woken by the alarms, if any.
+		alarm_t alarms[8];
+		uint32_t fired[8];
+		uint64_t last; // --> `now` of the previous advance.
+		uint64_t order; // --> deadline of the last alarm fired.
+		bool late;
+	};
+
+	/* records the alarm, which must be due at this advance and not before. */
+	void onAlarm(alarm_t* alarm, uint64_t now) {
+		alarms_t* alarms = (alarms_t*) alarm->user;
+		alarms->fired[alarm - alarms->alarms]++;
+
+		if (alarm->deadline > now || alarm->deadline <= alarms->last || alarm->deadline < alarms->order) {
+			alarms->late = true;
+		}
+
+		alarms->order = alarm->deadline;
+	}
+
+	/* deadlines at every level and past the last one (2^24 cycles) fire once, in order, at the first advance past them. */
+	void timerLevels() {
+		static const char* TEST = "timer levels";
+		static const uint64_t DEADLINES[8] = {
+			5, 200, 5000, 300000, (1 << 24) - 1, (1 << 24) + 3, (5ull << 24) + 77, 1ull << 40
+		};
+
+		// --> small steps wrap the levels one at a time, large ones skip several.
+		for (uint32_t pass = 0; pass < 2; ++pass) {
+			CTimerWheel wheel;
+			alarms_t alarms = { &wheel };
+
+			for (uint32_t i = 0; i < 8; ++i) {
+				CTimerWheel::init(&alarms.alarms[i], onAlarm, &alarms);
+				wheel.schedule(&alarms.alarms[i], DEADLINES[7 - i]);
+			}
+
+			uint64_t now = 0;
+			while (now < (1ull << 41)) {
+				uint64_t next = UINT64_MAX;
+				for (uint32_t i = 0; i < 8; ++i) {
+					next = alarms.fired[i] || DEADLINES[7 - i] > next ? next : DEADLINES[7 - i];
+				}
+
+				check(wheel.getNext() == next, TEST, MODE_INTERP, "the next deadline is wrong");
+
+				alarms.last = now;
+				now = pass ? now * 3 + 7 : now + (now >> 20 ? (1 << 20) + 13 : 61);
+				now = !pass && now > (6ull << 24) ? 1ull << 41 : now;
+				wheel.advance(now);
+			}
+
+			for (uint32_t i = 0; i < 8; ++i) {
+				check(alarms.fired[i] == 1, TEST, MODE_INTERP, "an alarm does not fire once");
+			}
+
+			check(!alarms.late, TEST, MODE_INTERP, "an alarm fires early, late or out of order");
+			check(wheel.getNext() == UINT64_MAX, TEST, MODE_INTERP, "a fired alarm stays armed");
+		}
+	}
+
+	/* alarm 0 re-arms itself and cancels the due alarm 1, alarm 2 arms alarm 3 at the current time. */
+	void onChain(alarm_t* alarm, uint64_t now) {
+		alarms_t* alarms = (alarms_t*) alarm->user;
+		uint32_t index = uint32_t(alarm - alarms->alarms);
+
+		alarms->fired[index]++;
+
+		if (index == 0) {
+			alarms->wheel->cancel(&alarms->alarms[1]);
+
+			if (alarms->fired[0] < 3) {
+				alarms->wheel->schedule(alarm, now + 1000);
+			}
+		}
+
+		else if (index == 2) {
+			alarms->wheel->schedule(&alarms->alarms[3], now);
+		}
+	}
+
+	/* callbacks schedule and cancel alarms of the advance that fires them. */
+	void timerCallbacks() {
+		static const char* TEST = "timer callbacks";
+		CTimerWheel wheel;
+		alarms_t alarms = { &wheel };
+
+		for (uint32_t i = 0; i < 4; ++i) {
+			CTimerWheel::init(&alarms.alarms[i], onChain, &alarms);
+		}
+
+		wheel.schedule(&alarms.alarms[0], 50);
+		wheel.schedule(&alarms.alarms[1], 60);
+		wheel.schedule(&alarms.alarms[2], 70);
+
+		check(wheel.advance(100) == 2, TEST, MODE_INTERP, "the cancelled alarm fires");
+		check(wheel.getNext() == 100, TEST, MODE_INTERP, "the alarm armed at the current time is lost");
+		check(wheel.advance(100) == 1 && alarms.fired[3] == 1, TEST, MODE_INTERP, "the alarm armed at the current time does not fire");
+		check(wheel.getNext() == 1100, TEST, MODE_INTERP, "the re-armed alarm is lost");
+		check(wheel.advance(5000) == 1 && wheel.getNext() == 6000, TEST, MODE_INTERP, "the re-armed alarm does not fire");
+		check(wheel.advance(1 << 25) == 1 && wheel.getNext() == UINT64_MAX, TEST, MODE_INTERP, "the alarm is re-armed past its count");
+		check(alarms.fired[0] == 3 && !alarms.fired[1] && alarms.fired[2] == 1, TEST, MODE_INTERP, "the alarms fire the wrong times");
+	}
+
+	/* the alarm raises the request that wakes the processor. */
+	void onWake(alarm_t* alarm, uint64_t now) {
+		alarms_t* alarms = (alarms_t*) alarm->user;
+		alarms->fired[alarm - alarms->alarms]++;
+		alarms->last = now;
+
+		if (alarm == &alarms->alarms[1]) {
+			alarms->cpu->setIrq(true);
+		}
+	}
+
+	/* `run()` of a halted processor skips to the alarms within the budget, not past it. */
+	void timerHalted(EMODE mode) {
+		static const char* TEST = "timer halted";
+		static const uint8_t HLT[] = { 0xf4 };
+		CMachine vm(HLT, sizeof(HLT));
+		USE_STATE(&vm.cpu, state);
+		CTimerWheel* wheel = vm.cpu.getTimers();
+
+		if (!vm.setMode(mode)) {
+			return;
+		}
+
+		alarms_t alarms = { wheel, &vm.cpu };
+		uint64_t deadline = (1 << 24) + 5;
+
+		for (uint32_t i = 0; i < 2; ++i) {
+			CTimerWheel::init(&alarms.alarms[i], onWake, &alarms);
+		}
+
+		wheel->schedule(&alarms.alarms[0], deadline);
+		wheel->schedule(&alarms.alarms[1], deadline * 2);
+		eflag<EFLAG_IT>(state, 1);
+
+		check(vm.cpu.run(UINT64_MAX, deadline + 1000) == STOP_HALT, TEST, mode, "the batch does not stay halted");
+		check(alarms.fired[0] == 1 && alarms.last == deadline, TEST, mode, "the alarm does not fire at its deadline");
+		check(!alarms.fired[1] && state->cycles < deadline * 2, TEST, mode, "the batch skips past the budget");
+		check(state->instructions == 1, TEST, mode, "the halted processor runs instructions");
+
+		check(vm.cpu.run(UINT64_MAX, UINT64_MAX) == STOP_IRQ, TEST, mode, "the alarm does not wake the processor");
+		check(alarms.fired[1] == 1 && state->cycles == deadline * 2, TEST, mode, "the processor wakes at the wrong cycle");
+		check(!vm.cpu.isHalted(), TEST, mode, "the woken processor stays halted");
+	}
+
+	/* port that logs its byte accesses, and answers word and block reads itself if `whole`. */
+	class CLogPort : public IPort {
+	private:
+		uint8_t m_Value;
+		bool m_Whole;
+		bool* m_Deleted; // --> set by the destructor.
+
+	public:
+		std::vector<uint32_t> log; // --> port << 8 | byte of each byte access.
+		uint32_t words;
+		uint32_t blocks;
+
+	public:
+		CLogPort(uint8_t value, bool whole = false, bool* deleted = nullptr)
+			: m_Value(value), m_Whole(whole), m_Deleted(deleted), words(0), blocks(0) { }
+
+		virtual ~CLogPort() {
+			if (m_Deleted) {
+				*m_Deleted = true;
+			}
+		}
+
+	public:
+		virtual bool read(uint16_t port, uint8_t* value) override {
+			log.push_back(uint32_t(port) << 8 | m_Value);
+			*value = m_Value;
+			return true;
+		}
+
+		virtual bool write(uint16_t port, uint8_t value) override {
+			log.push_back(uint32_t(port) << 8 | value);
+			return true;
+		}
+
+		virtual bool read16(uint16_t port, uint16_t* word) override {
+			if (!m_Whole) {
+				return IPort::read16(port, word);
+			}
+
+			words++;
+			*word = m_Value * 0x101;
+			return true;
+		}
+
+		virtual uint32_t readBlock(uint16_t port, void* buf, uint32_t count, uint8_t width) override {
+			if (!m_Whole) {
+				return IPort::readBlock(port, buf, count, width);
+			}
+
+			blocks++;
+			memset(buf, m_Value, count * width);
+			return count;
+		}
+	};
+
+	/* words over two devices are split between them, over one device go to its word access. */
+	void portSplit() {
+		static const char* TEST = "port split";
+		CPortBus* ports = new CPortBus();
+		CLogPort* lo = new CLogPort(0x11);
+		CLogPort* hi = new CLogPort(0x22);
+		CLogPort* whole = new CLogPort(0x33, true);
+		uint16_t word = 0;
+
+		ports->map(0x60, 1, lo);
+		ports->map(0x61, 1, hi);
+		ports->map(0x70, 2, whole);
+
+		check(ports->read16(0x60, &word) && word == 0x2211, TEST, MODE_INTERP, "the word is not read from both devices");
+		check(ports->write16(0x60, 0xbbaa), TEST, MODE_INTERP, "the split write fails");
+		check(lo->log == std::vector<uint32_t>({ 0x6011, 0x60aa }), TEST, MODE_INTERP, "the low device sees the wrong bytes");
+		check(hi->log == std::vector<uint32_t>({ 0x6122, 0x61bb }), TEST, MODE_INTERP, "the high device sees the wrong bytes");
+
+		check(ports->read16(0x70, &word) && word == 0x3333 && whole->words == 1, TEST, MODE_INTERP, "the word is split on one device");
+		check(whole->log.empty(), TEST, MODE_INTERP, "the word reads bytes of one device");
+
+		// --> 0x72 is unmapped: the low byte from the device, the high one floating.
+		ports->read16(0x71, &word);
+		check(word == 0xff33 && whole->words == 1 && whole->log.size() == 1, TEST, MODE_INTERP, "the word past the device is not split");
+
+		ports->drop();
+		lo->drop();
+		hi->drop();
+		whole->drop();
+	}
+
+	/* the default word and block accesses of `IPort` are byte accesses to `port` and `port + 1`. */
+	void portFallback() {
+		static const char* TEST = "port fallback";
+		CLogPort* port = new CLogPort(0x44);
+		uint16_t word = 0;
+		uint8_t buf[6] = { };
+
+		check(port->read16(0x10, &word) && word == 0x4444, TEST, MODE_INTERP, "the word read is wrong");
+		check(port->log == std::vector<uint32_t>({ 0x1044, 0x1144 }), TEST, MODE_INTERP, "the word read is not two byte reads");
+
+		port->log.clear();
+		check(port->readBlock(0x10, buf, 3, 2) == 3 && buf[0] == 0x44 && buf[5] == 0x44, TEST, MODE_INTERP, "the block read is wrong");
+		check(port->log.size() == 6 && port->log[4] == 0x1044 && port->log[5] == 0x1144, TEST, MODE_INTERP, "the block read is not word reads");
+
+		port->log.clear();
+		check(port->writeBlock(0x20, "\x01\x02\x03", 3, 1) == 3, TEST, MODE_INTERP, "the block write is short");
+		check(port->write16(0x30, 0x0605), TEST, MODE_INTERP, "the word write fails");
+		check(port->log == std::vector<uint32_t>({ 0x2001, 0x2002, 0x2003, 0x3005, 0x3106 }), TEST, MODE_INTERP, "the writes are not byte writes");
+
+		port->drop();
+	}
+
+	/* the bus holds a reference per mapped port, and drops it when the port is remapped or the bus is gone. */
+	void portRefs() {
+		static const char* TEST = "port refs";
+		CPortBus* ports = new CPortBus();
+		CLogPort* other = new CLogPort(0);
+		bool deleted = false;
+		CLogPort* port = new CLogPort(0, false, &deleted);
+
+		check(!ports->map(0xfff0, 0x11, port) && !ports->map(0, 1, ports), TEST, MODE_INTERP, "a bad mapping is taken");
+
+		ports->map(0x90, 4, port);
+		ports->map(0x93, 1, port); // --> mapped already, no second reference.
+		port->drop();
+
+		ports->unmap(0x90, 2);
+		ports->map(0x92, 1, other);
+		check(!deleted && ports->getDevice(0x93) == port, TEST, MODE_INTERP, "the device is released while mapped");
+
+		ports->unmap(0x93, 1);
+		check(deleted && !ports->getDevice(0x93), TEST, MODE_INTERP, "the device is not released by the last port");
+
+		// --> the bus releases its devices.
+		deleted = false;
+		port = new CLogPort(0, false, &deleted);
+		ports->map(0, CPortBus::PORTS, port);
+		port->drop();
+		ports->drop();
+		check(deleted, TEST, MODE_INTERP, "the bus does not release its devices");
+
+		other->drop();
+	}
+
+	/* REP INSW reaches the block read of the device, once. */
+	void portBlock(EMODE mode) {
+		static const char* TEST = "port block";
+		static const uint8_t INSW[] = { 0xf3, 0x6d, 0xf4 }; // --> REP INSW; HLT.
+		CMachine vm(INSW, sizeof(INSW));
+		USE_STATE(&vm.cpu, state);
+		CLogPort* port = new CLogPort(0x5a, true);
+
+		if (!vm.setMode(mode)) {
+			port->drop();
+			return;
+		}
+
+		static_cast<CPortBus*>(vm.cpu.getPort())->map(0x80, 2, port);
+		port->drop();
+
+		state->segs[SEG_ES].dword = CODE_SEG + 0x100;
+		state->di = 0;
+		state->cx = 8;
+		state->dx = 0x80;
+		vm.cpu.run(100, UINT64_MAX);
+
+		uint8_t* out = vm.host + ((CODE_SEG + 0x100) << 4);
+		check(vm.cpu.isHalted() && state->cx == 0 && state->di == 16, TEST, mode, "the string does not complete");
+		check(out[0] == 0x5a && out[15] == 0x5a && out[16] != 0x5a, TEST, mode, "the words are not stored");
+		check(port->blocks == 1 && port->log.empty() && !port->words, TEST, mode, "the device block read is not used");
+	}
+}
+
+int main() {
+	for (uint32_t mode = 0; mode < MODE_MAX; ++mode) {
+		irqMasked(EMODE(mode));
+		irqEnabled(EMODE(mode));
+		insTranslated(EMODE(mode));
+		cowFork(EMODE(mode));
+		timerHalted(EMODE(mode));
+		portBlock(EMODE(mode));
+	}
+
+	irqScheduler();
+	portSplit();
+	portFallback();
+	portRefs();
+	timerLevels();
+	timerCallbacks();
+	boundAttach();
+	boundFork();
+	lockstepBreak();
+	imageModes();
+	diskRange();
+	traceFile(false);
+	traceFile(true);
+	replayLog();
+
+	if (failures) {
+		fprintf(stderr, "%u checks failed\n", failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
\ No newline at end of file
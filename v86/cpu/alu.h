@@ -0,0 +1,133 @@
+#ifndef __V86_CPU_ALU_H__
+#define __V86_CPU_ALU_H__
+#include <type_traits>
+#include "state.h"
+
+namespace v86 {
+	/* ALU operations: 0 ~ 7 follow the opcode rows (00 ~ 3F) and GRP1's reg field. */
+	enum EALU {
+		ALU_ADD = 0,
+		ALU_OR,
+		ALU_ADC,
+		ALU_SBB,
+		ALU_AND,
+		ALU_SUB,
+		ALU_XOR,
+		ALU_CMP,
+
+		ALU_TEST, // --> AND, no store result.
+		ALU_INC,
+		ALU_DEC,
+	};
+
+	/* operand width traits. */
+	template<typename T>
+	struct alu_t {
+		static_assert(sizeof(T) < sizeof(uint32_t), "32-bit operands need a wider lazy record.");
+
+		/* holds the carry (or borrow) out of T. */
+		typedef uint32_t wide_t;
+
+		static constexpr uint8_t SIZE = sizeof(T);
+		static constexpr wide_t MASK = wide_t(T(~T(0)));
+		static constexpr wide_t SIGN = wide_t(1) << (SIZE * 8 - 1);
+	};
+
+	/* whether the operation writes its result back. */
+	constexpr bool alu_stores(EALU op) {
+		return op != ALU_CMP && op != ALU_TEST;
+	}
+
+	/* compute `dst (op) src` and record the flags lazily. */
+	template<typename T, EALU op>
+	inline T alu(state_t* state, T dst, T src) {
+		typedef typename alu_t<T>::wide_t wide_t;
+		constexpr uint8_t size = alu_t<T>::SIZE;
+
+		wide_t res;
+		switch (op) {
+		case ALU_ADD:
+			res = wide_t(dst) + src;
+			eflag_lazy(state, LAZY_ADD, size, dst, src, res);
+			break;
+
+		case ALU_ADC:
+			res = wide_t(dst) + src + eflag<EFLAG_CF>(state);
+			eflag_lazy(state, LAZY_ADD, size, dst, src, res);
+			break;
+
+		case ALU_SUB:
+		case ALU_CMP:
+			res = wide_t(dst) - src;
+			eflag_lazy(state, LAZY_SUB, size, dst, src, res);
+			break;
+
+		case ALU_SBB:
+			res = wide_t(dst) - src - eflag<EFLAG_CF>(state);
+			eflag_lazy(state, LAZY_SUB, size, dst, src, res);
+			break;
+
+		case ALU_OR:
+			res = wide_t(dst | src);
+			eflag_lazy(state, LAZY_LOGIC, size, dst, src, res);
+			break;
+
+		case ALU_AND:
+		case ALU_TEST:
+			res = wide_t(dst & src);
+			eflag_lazy(state, LAZY_LOGIC, size, dst, src, res);
+			break;
+
+		case ALU_XOR:
+			res = wide_t(dst ^ src);
+			eflag_lazy(state, LAZY_LOGIC, size, dst, src, res);
+			break;
+
+		case ALU_INC:
+			res = wide_t(dst) + 1;
+			eflag_lazy(state, LAZY_INC, size, dst, 1, res);
+			break;
+
+		case ALU_DEC:
+			res = wide_t(dst) - 1;
+			eflag_lazy(state, LAZY_DEC, size, dst, 1, res);
+			break;
+
+		default:
+			res = dst;
+			break;
+		}
+
+		return T(res & alu_t<T>::MASK);
+	}
+
+	/**
+	 * evaluate the condition of Jcc (low nibble of 70 ~ 7F) after `dst (op) src`,
+	 * straight from the operands instead of the flags. op is ALU_CMP or ALU_TEST.
+	 */
+	template<typename T, EALU op>
+	inline bool alu_cond(uint8_t cc, T dst, T src) {
+		static_assert(op == ALU_CMP || op == ALU_TEST, "CMP and TEST only.");
+		typedef typename std::make_signed<T>::type signed_t;
+		constexpr bool sub = op == ALU_CMP;
+		constexpr T sign = T(alu_t<T>::SIGN);
+
+		T res = sub ? T(dst - src) : T(dst & src);
+		bool cond;
+
+		switch ((cc >> 1) & 0x07) {
+		case 0: cond = sub && ((dst ^ src) & (dst ^ res) & sign); break; // --> O.
+		case 1: cond = sub && dst < src; break; // --> B.
+		case 2: cond = res == 0; break; // --> Z.
+		case 3: cond = sub ? dst <= src : res == 0; break; // --> BE.
+		case 4: cond = (res & sign) != 0; break; // --> S.
+		case 5: cond = eflag_parity(res) != 0; break; // --> P.
+		case 6: cond = sub ? signed_t(dst) < signed_t(src) : (res & sign) != 0; break; // --> L.
+		default: cond = sub ? signed_t(dst) <= signed_t(src) : res == 0 || (res & sign); break; // --> LE.
+		}
+
+		return (cc & 1) ? !cond : cond;
+	}
+}
+
+#endif // __V86_CPU_ALU_H__
@@ -0,0 +1,184 @@
+#include "block.h"
+#include <string.h>
+
+namespace v86 {
+
+	CBlockCache::CBlockCache() : m_Epoch(0) {
+		memset(m_Buckets, 0, sizeof(m_Buckets));
+		memset(m_Lines, 0, sizeof(m_Lines));
+	}
+
+	CBlockCache::~CBlockCache() {
+		flush();
+		collect();
+	}
+
+	bool CBlockCache::isBranch(uint8_t opcode) {
+		switch (opcode) {
+		case 0x0f: // --> POP CS.
+		case 0x70: case 0x71: case 0x72: case 0x73: // --> Jcc.
+		case 0x74: case 0x75: case 0x76: case 0x77:
+		case 0x78: case 0x79: case 0x7a: case 0x7b:
+		case 0x7c: case 0x7d: case 0x7e: case 0x7f:
+		case 0x9a: // --> CALL Ap.
+		case 0xc2: case 0xc3: case 0xca: case 0xcb: // --> RET, RETF.
+		case 0xcc: case 0xcd: case 0xce: case 0xcf: // --> INT3, INT, INTO, IRET.
+		case 0xe0: case 0xe1: case 0xe2: case 0xe3: // --> LOOPcc, JCXZ.
+		case 0xe8: case 0xe9: case 0xea: case 0xeb: // --> CALL, JMP.
+		case 0xf4: // --> HLT.
+		case 0xff: // --> GRP5: CALL, JMP Ev.
+			return true;
+
+		default:
+			break;
+		}
+
+		return false;
+	}
+
+	bool CBlockCache::isConditional(uint8_t opcode) {
+		return (opcode & 0xf0) == 0x70 || (opcode >= 0xe0 && opcode <= 0xe3);
+	}
+
+	block_t* CBlockCache::create(uint32_t addr) {
+		block_t* block = new block_t();
+
+		block->addr = addr;
+		block->size = 0;
+		block->valid = false;
+		block->next = nullptr;
+		block->links[0] = block->links[1] = nullptr;
+		block->epoch = m_Epoch;
+		block->uops.reserve(8);
+		return block;
+	}
+
+	void CBlockCache::commit(block_t* block) {
+		if (block->uops.empty()) {
+			delete block;
+			return;
+		}
+
+		uint32_t n = bucket(block->addr);
+		uint32_t first = page(block->addr);
+		uint32_t last = page(block->addr + block->size - 1);
+
+		block->valid = true;
+		block->next = m_Buckets[n];
+		m_Buckets[n] = block;
+
+		m_Pages[first].push_back(block);
+		if (last != first) {
+			m_Pages[last].push_back(block);
+		}
+
+		mark(block);
+	}
+
+	void CBlockCache::mark(const block_t* block) {
+		uint32_t line = block->addr >> LINE_BITS;
+		uint32_t last = (block->addr + block->size - 1) >> LINE_BITS;
+
+		while (true) {
+			m_Lines[(line >> (PAGE_BITS - LINE_BITS)) & (PAGES - 1)] |= 1ull << (line & 63);
+
+			if (line++ == last) {
+				break;
+			}
+		}
+	}
+
+	void CBlockCache::remark(uint32_t page) {
+		m_Lines[page] = 0;
+
+		// --> a block over two pages sets the lines of the other one again, they are set anyway.
+		for (const block_t* block : m_Pages[page]) {
+			mark(block);
+		}
+	}
+
+	void CBlockCache::drop(block_t* block) {
+		block_t** link = &m_Buckets[bucket(block->addr)];
+		while (*link != block) {
+			link = &(*link)->next;
+		}
+
+		*link = block->next;
+		block->valid = false;
+
+		uint32_t first = page(block->addr);
+		uint32_t last = page(block->addr + block->size - 1);
+
+		for (uint32_t i = first; ; i = last) {
+			std::vector<block_t*>& list = m_Pages[i];
+
+			for (size_t k = 0; k < list.size(); ++k) {
+				if (list[k] == block) {
+					list[k] = list.back();
+					list.pop_back();
+					break;
+				}
+			}
+
+			remark(i);
+
+			if (i == last) {
+				break;
+			}
+		}
+
+		m_Garbage.push_back(block);
+	}
+
+	void CBlockCache::discard(block_t* block) {
+		m_Garbage.push_back(block);
+	}
+
+	void CBlockCache::invalidate(uint32_t addr, uint32_t size) {
+		uint32_t end = addr + size;
+		uint32_t first = page(addr);
+		uint32_t last = page(end - 1);
+		bool dropped = false;
+
+		for (uint32_t i = first; ; i = (i + 1) & (PAGES - 1)) {
+			std::vector<block_t*>& blocks = m_Pages[i];
+
+			for (size_t k = 0; k < blocks.size(); ) {
+				block_t* block = blocks[k];
+
+				// --> the other blocks of the page keep running.
+				if (block->addr >= end || block->addr + block->size <= addr) {
+					++k;
+					continue;
+				}
+
+				drop(block); // --> moves the last one to `k`.
+				dropped = true;
+			}
+
+			if (i == last) {
+				break;
+			}
+		}
+
+		if (dropped) {
+			m_Epoch++;
+		}
+	}
+
+	void CBlockCache::flush() {
+		for (uint32_t i = 0; i < PAGES; ++i) {
+			if (!m_Pages[i].empty()) {
+				invalidate(i << PAGE_BITS, 1 << PAGE_BITS);
+			}
+		}
+	}
+
+	void CBlockCache::collect() {
+		for (block_t* block : m_Garbage) {
+			delete block;
+		}
+
+		m_Garbage.clear();
+	}
+}
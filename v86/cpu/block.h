@@ -0,0 +1,172 @@
+#ifndef __V86_CPU_BLOCK_H__
+#define __V86_CPU_BLOCK_H__
+#include "state.h"
+#include <vector>
+
+namespace v86 {
+	class Ci8086;
+
+	/* fused runs of decoded instructions, replayed as one step. */
+	enum EFUSE {
+		FUSE_NONE = 0,
+		FUSE_CMP_JCC,	// --> CMP or TEST, then Jcc: the condition from the operands.
+		FUSE_DEC_JCC,	// --> DEC reg, then JZ or JNZ.
+		FUSE_PUSH,		// --> PUSH reg run: a single stack range check.
+		FUSE_POP,		// --> POP reg run, without POP SP.
+	};
+
+	/* decoded instruction, replayed without fetching it again. */
+	struct uop_t {
+		void (*handler)(Ci8086* cpu, uint8_t opcode);
+
+		uint8_t opcode;
+		uint8_t length; // --> total length, including prefixes.
+		uint8_t prefix; // --> prefix length.
+		uint8_t sov; // --> overriding segment, SEG_MAX if not overridden.
+		uint8_t rep; // --> EREPF.
+
+		/* ModRM, `modrm` is zero if the opcode has no ModRM byte. */
+		uint8_t modrm;
+		uint8_t mode;
+		uint8_t reg;
+		uint8_t rm;
+		uint8_t mlen; // --> ModRM + displacement length.
+		uint8_t stack; // --> 1 if the default segment is SS.
+		uint16_t disp;
+
+		/* peephole, set when the block is committed. */
+		uint8_t fuse; // --> EFUSE.
+		uint8_t run; // --> instructions of the fused run from this one.
+
+		uint8_t bytes[16]; // --> raw bytes.
+	};
+
+	/* straight-line run of decoded instructions, it goes on past conditional branches not taken. */
+	struct block_t {
+		uint32_t addr; // --> linear address of the first instruction.
+		uint32_t size; // --> length in bytes.
+		bool valid;
+		block_t* next; // --> next block in the same bucket.
+
+		/* blocks run after this one: [0] by a taken branch, [1] falling through. */
+		block_t* links[2];
+		uint32_t epoch; // --> the links are stale if the cache has dropped blocks since.
+
+		std::vector<uop_t> uops;
+	};
+
+	/* decoded block cache, keyed by linear address. */
+	class CBlockCache {
+	public:
+		static constexpr uint32_t PAGE_BITS = 12;
+		static constexpr uint32_t PAGES = 1 << (24 - PAGE_BITS);
+		static constexpr uint32_t BUCKETS = 4096;
+		static constexpr uint32_t MAX_UOPS = 64;
+		static constexpr uint32_t LINE_BITS = 6;
+
+		static_assert(PAGE_BITS - LINE_BITS == 6, "a 64-bit mask of lines per page.");
+
+	private:
+		block_t* m_Buckets[BUCKETS];
+		std::vector<block_t*> m_Pages[PAGES];
+		uint64_t m_Lines[PAGES]; // --> a bit per 64 bytes of the page that cached code is in.
+		std::vector<block_t*> m_Garbage;
+		uint32_t m_Epoch; // --> bumped when blocks are dropped.
+
+	public:
+		CBlockCache();
+		~CBlockCache();
+
+	private:
+		inline static uint32_t bucket(uint32_t addr) {
+			return (addr ^ (addr >> 12)) & (BUCKETS - 1);
+		}
+
+		inline static uint32_t page(uint32_t addr) {
+			return (addr >> PAGE_BITS) & (PAGES - 1);
+		}
+
+	public:
+		/* find the block that starts at the address. */
+		inline block_t* find(uint32_t addr) const {
+			block_t* block = m_Buckets[bucket(addr)];
+
+			while (block && block->addr != addr) {
+				block = block->next;
+			}
+
+			return block;
+		}
+
+		/* find the block run after `from`, through its links first. */
+		inline block_t* follow(block_t* from, uint32_t addr) {
+			uint32_t slot = addr == from->addr + from->size;
+
+			if (from->epoch == m_Epoch) {
+				block_t* link = from->links[slot];
+
+				if (link && link->addr == addr) {
+					return link;
+				}
+			}
+
+			else {
+				from->links[0] = from->links[1] = nullptr;
+				from->epoch = m_Epoch;
+			}
+
+			return from->links[slot] = find(addr);
+		}
+
+		/* test whether the range holds any cached code, by 64 byte lines. */
+		inline bool isCode(uint32_t addr, uint32_t size) const {
+			uint32_t line = addr >> LINE_BITS;
+			uint32_t last = (addr + size - 1) >> LINE_BITS;
+
+			while (!(m_Lines[(line >> (PAGE_BITS - LINE_BITS)) & (PAGES - 1)] & (1ull << (line & 63)))) {
+				if (line++ == last) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		/* test whether the opcode ends a block. */
+		static bool isBranch(uint8_t opcode);
+
+		/* test whether the opcode branches on a condition, the block goes on if it is not taken. */
+		static bool isConditional(uint8_t opcode);
+
+	private:
+		/* set the lines of the block. */
+		void mark(const block_t* block);
+
+		/* rebuild the lines of the page from the blocks left on it. */
+		void remark(uint32_t page);
+
+		/* unlink the block from its bucket and the page lists, and free it at `collect()`. */
+		void drop(block_t* block);
+
+	public:
+		/* create a new block, not visible until it is committed. */
+		block_t* create(uint32_t addr);
+
+		/* make the block visible to `find()`. */
+		void commit(block_t* block);
+
+		/* drop the block that has never been committed. */
+		void discard(block_t* block);
+
+		/* invalidate the blocks that the range overlaps. */
+		void invalidate(uint32_t addr, uint32_t size);
+
+		/* invalidate all blocks. */
+		void flush();
+
+		/* free invalidated blocks. (they may be still in use until this) */
+		void collect();
+	};
+}
+
+#endif // __V86_CPU_BLOCK_H__
@@ -1,17 +1,141 @@
 #ifndef __V86_CPU_I8086_H__
 #define __V86_CPU_I8086_H__
+#include "profile.h"
+#include "trace.h"
+#include "jit.h"
 #include "proc.h"
+#include "block.h"
+#include "alu.h"
+#include "modrm.h"
 
 namespace v86 {
 
-	/* 8086 processor. */
+	/* 8086 processor, type-erased: its accesses go through `IProc`. (`Ci8086T` binds them at compile time) */
 	class Ci8086 : public IProc {
+		friend class CJit;
+		friend class CLockstep;
+
+	public:
+		/* opcode handler, called after the opcode and its prefixes are fetched. */
+		typedef void (*opcode_t)(Ci8086* cpu, uint8_t opcode);
+
+		/* GRP1 sub-opcode handler, computes `fetch_t::res` from `fetch_t::op`. */
+		typedef void (*group_t)(Ci8086* cpu);
+
+	private:
+		opcode_t m_Opcodes[256];
+		const opcode_t* m_Defaults; // --> default table of the core type.
+
+		/* decoded block cache. */
+		CBlockCache* m_Blocks;
+		block_t* m_Block; // --> block being replayed or recorded.
+		block_t* m_Last; // --> block replayed before, its links find the next one.
+		uint32_t m_Index; // --> index of the next uop in the block.
+		uint32_t m_Next; // --> linear address of the next uop.
+		bool m_Record;
+
+		const uop_t* m_Uop; // --> uop being replayed.
+		const uint8_t* m_UopCode; // --> its remaining bytes.
+
+		/* prefetch window: host bytes of the page that CS:IP is in. */
+		const uint8_t* m_Code; // --> host pointer of `m_CodeBase`.
+		uint32_t m_CodeBase; // --> linear address of the window.
+		uint32_t m_CodeSize; // --> zero if the window is empty.
+		CMemoryBus* m_CodeBus; // --> the window is valid for this bus,
+		uint32_t m_CodeGen; //     at this generation.
+
+		/* translator of hot blocks, nullptr if disabled. */
+		CJit* m_Jit;
+
+		/* execution trace, nullptr if disabled. */
+		CTrace* m_Trace;
+
+		/* breakpoint being reported: `onBreak()` stands in for the handler of BREAK_OPCODE. */
+		opcode_t m_Borrowed;
+		uint32_t m_BreakAddr; // --> resuming at this address,
+		uint64_t m_BreakCycles; //     at this cycle count, runs the instruction.
+
+#ifdef __V86_PROFILE__
+		/* execution counters. */
+		CProfile m_Profile;
+#endif
+
+#ifdef __V86_THREADED__
+		/* labels of the threaded core, rebuilt when an opcode is replaced. */
+		void* m_Threaded[256];
+		void* m_ThreadedCall; // --> label that calls the handler of the table.
+		bool m_ThreadedDirty;
+#endif
+
 	protected:
-		static uint8_t PARITY_MAP[32];
-		inline static uint8_t parity(uint8_t n) {
-			return PARITY_MAP[n / 8] >> (7 - n);
+		/* default opcode table of the core type. */
+		template<class TCore>
+		static const opcode_t OPCODES[256];
+
+		/* base clock cycles of the opcodes, register forms. (EA and taken branches are not counted) */
+		static const uint8_t CYCLES[256];
+
+		/* elements of REP INS/OUTS per step, the rest continues at the next step. */
+		static constexpr uint32_t REP_CHUNK = 512;
+
+		/* opcode fetched in place of the instruction at a breakpoint. (not a prefix) */
+		static constexpr uint8_t BREAK_OPCODE = 0xf1;
+
+		/* GRP1 (80 ~ 83) tables, indexed by ModRM's reg field. */
+		static const group_t GROUP1_8[8];
+		static const group_t GROUP1_16[8];
+
+	public:
+		Ci8086();
+		virtual ~Ci8086();
+
+	protected:
+		/* processor of a derived core type, with its default opcode table. (see `Ci8086T`) */
+		Ci8086(const opcode_t* defaults);
+
+	public:
+		/* replace the handler of the opcode. (e.g. to implement or to trap it) */
+		void setOpcode(uint8_t opcode, opcode_t handler);
+
+		/* get the handler of the opcode. */
+		inline opcode_t getOpcode(uint8_t opcode) const {
+			return m_Opcodes[opcode];
+		}
+
+		/* test whether the opcode runs its default handler. */
+		inline bool isDefault(uint8_t opcode) const {
+			return m_Opcodes[opcode] == m_Defaults[opcode];
 		}
 
+		/* enable or disable the decoded block cache. */
+		void setBlockCache(bool enabled);
+
+		/**
+		 * enable or disable the translation of hot blocks into host code. (x86-64 hosts only)
+		 * returns false if the host can not run it. not from opcode handlers.
+		 */
+		bool setJit(bool enabled);
+
+		/**
+		 * record each instruction that `run()` executes into the trace, nullptr to stop.
+		 * a traced processor interprets: the block cache and the translated code are skipped.
+		 */
+		void setTrace(CTrace* trace);
+
+		/* get the execution trace. */
+		inline CTrace* getTrace() const { return m_Trace; }
+
+		/* invalidate decoded code in the range. (e.g. DMA into memory) */
+		void invalidate(uint32_t addr, uint32_t size);
+
+		/* watch the range, breakpoints drop the decoded code of their pages. */
+		virtual bool watch(uint32_t addr, uint32_t size, uint8_t kind) override;
+
+#ifdef __V86_PROFILE__
+		/* get the execution counters. */
+		inline CProfile* getProfile() { return &m_Profile; }
+#endif
+
 	protected:
 		/* translate 16-bit [IMM:ADDR] value to linear address. */
 		inline uint32_t addr16imm(uint32_t seg, uint16_t addr) const {
@@ -28,10 +152,36 @@ namespace v86 {
 		/* fetch a code byte. */
 		virtual uint8_t fetch() override;
 
+		/* fetch a code byte through the prefetch window. */
+		inline uint8_t fetch8() {
+			USE_STATE(this, state);
+			USE_FETCH_STATE(this, fst);
+
+			// --> replaying: bytes are already in the trace buffer.
+			if (m_Uop) {
+				state->ip++;
+				return *m_UopCode++;
+			}
+
+			uint32_t offset = addr16(SEG_CS, state->ip) - m_CodeBase;
+			uint8_t code = offset < m_CodeSize
+				? m_Code[offset] : fetchSlow();
+
+			state->ip++;
+
+			// --> store fetched code byte.
+			if (fst->length < sizeof(fst->fetch)) {
+				fst->fetch[fst->length] = code;
+			}
+
+			fst->length++;
+			return code;
+		}
+
 		/* fetch a code word. */
 		inline uint16_t fetch16() {
-			uint16_t first = fetch();
-			return first | (uint16_t(fetch()) << 8);
+			uint16_t first = fetch8();
+			return first | (uint16_t(fetch8()) << 8);
 		}
 
 		/* push bytes to the stack. */
@@ -44,62 +194,235 @@ namespace v86 {
 		/* execute single step. */
 		virtual void exec() override;
 
+		/* execute instructions in a batch. */
+		virtual ESTOP run(uint64_t maxInstructions, uint64_t maxCycles) override;
+
+		/* execute up to `count` instructions, or until an event is pending or `cycles` reaches `until`. */
+		template<class TCore = Ci8086>
+		uint32_t execLoop(uint32_t count, uint64_t until = UINT64_MAX);
+
+		/* write bytes into the memory. */
+		virtual uint32_t write(uint32_t addr, const void* buf, uint32_t size) override;
+
+		/* store a byte into the memory, invalidating decoded code. */
+		template<class TCore = Ci8086>
+		inline void store8(uint32_t addr, uint8_t value) {
+			if (uint8_t* host = direct(addr, 1, PAGE_WRITE)) {
+				*host = value;
+
+				if (isDecoding()) {
+					invalidate(addr, 1);
+				}
+
+				return;
+			}
+
+			core<TCore>()->store(addr, &value, sizeof(value));
+		}
+
+		/* store a word into the memory, invalidating decoded code. */
+		template<class TCore = Ci8086>
+		inline void store16(uint32_t addr, uint16_t value) {
+			if (uint8_t* host = direct(addr, 2, PAGE_WRITE)) {
+				host[0] = uint8_t(value);
+				host[1] = uint8_t(value >> 8);
+
+				if (isDecoding()) {
+					invalidate(addr, 2);
+				}
+
+				return;
+			}
+
+			uint8_t bytes[2] = { uint8_t(value), uint8_t(value >> 8) };
+			core<TCore>()->store(addr, bytes, sizeof(bytes));
+		}
+
+		/* push a word to the stack. */
+		template<class TCore = Ci8086>
+		inline void push16(uint16_t value) {
+			USE_STATE(this, state);
+			state->sp -= 2;
+			store16<TCore>(addr16(SEG_SS, state->sp), value);
+		}
+
+		/* pop a word from the stack. */
+		template<class TCore = Ci8086>
+		inline uint16_t pop16() {
+			USE_STATE(this, state);
+			uint16_t value = load16<TCore>(addr16(SEG_SS, state->sp));
+			state->sp += 2;
+			return value;
+		}
+
+	protected:
+		/* the processor as its core type, the instruction templates call its accessors. */
+		template<class TCore>
+		inline TCore* core() { return static_cast<TCore*>(this); }
+
+		/* `run()` of the core type. */
+		template<class TCore>
+		ESTOP execBatch(uint64_t maxInstructions, uint64_t maxCycles);
+
+		/* test whether writes should invalidate decoded code. */
+		inline bool isDecoding() const { return m_Blocks || m_Jit; }
+
+		/* refill the prefetch window and fetch the byte at CS:IP. */
+		uint8_t fetchSlow();
+
+		/* test whether the instruction at the breakpoint stops, and put `onBreak()` in its place. */
+		bool breakAt(uint32_t addr);
+
+		/* stands in for the instruction at the breakpoint: rewinds its fetch, as if it had not started. */
+		static void onBreak(Ci8086* cpu, uint8_t opcode);
+
+		/* drop the prefetch window if the memory map has changed. */
+		inline void checkCode() {
+			CMemoryBus* bus = getBus();
+
+			if (bus != m_CodeBus || (bus && bus->getGeneration() != m_CodeGen)) {
+				m_CodeBus = bus;
+				m_CodeGen = bus ? bus->getGeneration() : 0;
+				m_CodeSize = 0;
+			}
+		}
+
+	protected:
+		/* reset the per-instruction state and fetch the opcode with its prefixes. */
+		uint8_t fetchOpcode();
+
+		/* decode and execute single instruction. */
+		void execDecode();
+
+		/**
+		 * execute through the block cache, up to the end of the block or `count`, `until` and the events.
+		 * fused runs are replayed if they fit. returns the number of retired instructions.
+		 */
+		template<class TCore = Ci8086>
+		uint32_t execBlock(uint32_t count = 1, uint64_t until = UINT64_MAX);
+
+		/* set the prefixes, the trace buffer and IP up to replay the decoded instruction. */
+		void beginUop(const uop_t* uop);
+
+		/* replay the decoded instruction. */
+		void execUop(const uop_t* uop);
+
+		/* replay the fused run from the decoded instruction, returns retired instructions, 0 if not runnable. */
+		template<class TCore>
+		uint32_t execFused(const uop_t* uop, uint32_t count, uint64_t until);
+
+		/* execute CMP or TEST of the replayed instruction, returns the condition of Jcc. */
+		template<class TCore>
+		bool execCmpJcc(uint8_t opcode, uint8_t cc);
+
+		/* append the executed instruction to the block being recorded. */
+		bool recordUop(uint32_t addr);
+
+		/* mark fused runs, then make the recorded block visible. */
+		void commitBlock(block_t* block);
+
+		/* execute through the translated blocks, interpreting the rest. */
+		uint32_t execJit(uint32_t count, uint64_t until);
+
+		/* interpret, recording each instruction into the trace. */
+		uint32_t execTrace(uint32_t count, uint64_t until);
+
 	protected:
 		/* execute segment overrides. */
 		virtual bool execSov16(uint8_t opcode);
 
+		/* execute INS (6C, 6D), a chunk of the REP count. */
+		template<class TCore>
+		void execIns16(uint8_t opcode);
+
+		/* execute OUTS (6E, 6F), a chunk of the REP count. */
+		template<class TCore>
+		void execOuts16(uint8_t opcode);
+
 	protected:
 		/* fetch ModRM byte. */
-		virtual void fetchModRm16();
+		void fetchModRm16();
 
 		/* get the address from Mod RM byte. */
-		virtual uint32_t addrModRM16();
+		uint32_t addrModRM16();
 
 		/* read reg/mem 8. */
-		virtual uint8_t readRM8();
+		template<class TCore>
+		uint8_t readRM8();
 
 		/* read reg/mem 16.*/
-		virtual uint16_t readRM16();
+		template<class TCore>
+		uint16_t readRM16();
 
 		/* read reg/mem 32. */
-		virtual uint32_t readRM32();
+		template<class TCore>
+		uint32_t readRM32();
 
 		/* write reg/mem 8. */
-		virtual void writeRM8(uint8_t value);
+		template<class TCore>
+		void writeRM8(uint8_t value);
 
 		/* write reg/mem 16. */
-		virtual void writeRM16(uint16_t value);
+		template<class TCore>
+		void writeRM16(uint16_t value);
 
 		/* write reg/mem 32. */
-		virtual void writeRM32(uint32_t value);
+		template<class TCore>
+		void writeRM32(uint32_t value);
+
+	protected:
+		/* dispatch the opcode to its series, resolved at compile time. */
+		template<class TCore, uint8_t opcode>
+		static void onOpcode(Ci8086* cpu, uint8_t);
+
+		/* ALU forms of 00 ~ 3D: Eb Gb, Ev Gv, Gb Eb, Gv Ev, AL Ib, eAX Iv. */
+		template<class TCore, uint8_t opcode>
+		void onAlu();
+
+		/* GRP1 ADD, OR, ADC, SBB, AND, SUB, XOR, CMP. */
+		template<typename T, uint8_t reg>
+		static void onGroup1(Ci8086* cpu);
 
 	protected:
 		/* 0x00 ~ 0x0F opcode series (ADD, PUSH/POP ES, OR, PUSH/POP CS. */
-		virtual void onOpcode0X(uint8_t opcode);
+		template<class TCore, uint8_t opcode>
+		void onOpcode0X();
 
 		/* 0x10 ~ 0x1F opcode series (ADC, PUSH/POP SS, SBB, PUSH/POP DS. */
-		virtual void onOpcode1X(uint8_t opcode);
+		template<class TCore, uint8_t opcode>
+		void onOpcode1X();
 
 		/* 0x20 ~ 0x2F opcode series (AND, DAA, SUB, DAS). */
-		virtual void onOpcode2X(uint8_t opcode);
+		template<class TCore, uint8_t opcode>
+		void onOpcode2X();
 
 		/* 0x30 ~ 0x3F opcode series (XOR, AAA, CMP, AAS). */
-		virtual void onOpcode3X(uint8_t opcode);
+		template<class TCore, uint8_t opcode>
+		void onOpcode3X();
 
 		/* 0x40 ~ 0x4F opcode series (INC/DEC). */
-		virtual void onOpcode4X(uint8_t opcode);
+		template<class TCore, uint8_t opcode>
+		void onOpcode4X();
 
 		/* 0x50 ~ 0x5F opcode series (PUSH/POP GPR). */
-		virtual void onOpcode5X(uint8_t opcode);
+		template<class TCore, uint8_t opcode>
+		void onOpcode5X();
 
 		/* 0x60 ~ 0x6F opcode series (PUSHA, POPA, BOUND, PUSH Iv, IMUL, PUSB Ib, INSB, INSW, OUTSB, OUTSW) */
-		virtual void onOpcode6X(uint8_t opcode);
+		template<class TCore, uint8_t opcode>
+		void onOpcode6X();
 
 		/* 0x70 ~ 0x7F opcode series (JMP series). */
-		virtual void onOpcode7X(uint8_t opcode);
+		template<class TCore, uint8_t opcode>
+		void onOpcode7X();
 
 		/* 0x80 ~ 0x8F opcode series (80/82 GRP1, 83, 81/83, TEST, XCHG, MOV, LEA, POP Ev) */
-		virtual void onOpcode8X(uint8_t opcode);
+		template<class TCore, uint8_t opcode>
+		void onOpcode8X();
+
+		/* 0xF0 ~ 0xFF opcode series (HLT) */
+		template<class TCore, uint8_t opcode>
+		void onOpcodeFX();
 	};
 
 }
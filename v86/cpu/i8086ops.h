@@ -0,0 +1,1504 @@
+#ifndef __V86_CPU_I8086OPS_H__
+#define __V86_CPU_I8086OPS_H__
+#include "i8086.h"
+
+/**
+ * instruction templates of Ci8086, instantiated per core type (TCore):
+ * `Ci8086` reaches the memory and the ports through `IProc`, `Ci8086T` through its bound backends.
+ * included by the translation units that instantiate a core, its macros end with it. (but `PROFILE`)
+ */
+
+/* count into the execution counters, removed without __V86_PROFILE__. (the decoder of i8086.cpp counts too) */
+#ifdef __V86_PROFILE__
+#define PROFILE(call)	m_Profile.call
+#else
+#define PROFILE(call)
+#endif
+
+namespace v86 {
+
+	template<class TCore>
+	ESTOP Ci8086::execBatch(uint64_t maxInstructions, uint64_t maxCycles)
+	{
+		uint64_t until = cyclesUntil(maxCycles);
+		ESTOP reason;
+
+		while (true) {
+			// --> between batches only: alarms are checked by the batch limit.
+			uint64_t limit = runTimers(until);
+
+			if (hasEvents() && (reason = takeEvent()) != STOP_NONE) {
+				return reason;
+			}
+
+			if (!maxInstructions || getState()->cycles >= until) {
+				return STOP_BUDGET;
+			}
+
+			uint32_t count = maxInstructions < UINT32_MAX
+				? uint32_t(maxInstructions) : UINT32_MAX;
+
+			uint32_t done = execLoop<TCore>(count, limit);
+			getState()->instructions += done;
+			maxInstructions -= done;
+		}
+	}
+
+#ifndef __V86_THREADED__
+	template<class TCore>
+	uint32_t Ci8086::execLoop(uint32_t count, uint64_t until)
+	{
+		USE_STATE(this, state);
+		uint32_t done = 0;
+
+		if (m_Trace) {
+			return execTrace(count, until);
+		}
+
+		if (m_Jit) {
+			return execJit(count, until);
+		}
+
+		if (m_Blocks) {
+			while (done < count) {
+				if (hasStops() || state->cycles >= until) {
+					break;
+				}
+
+				done += execBlock<TCore>(count - done, until);
+			}
+
+			return done;
+		}
+
+		for (; done < count; ++done) {
+			if (hasStops() || state->cycles >= until) {
+				break;
+			}
+
+			execDecode();
+		}
+
+		return done;
+	}
+#else
+#if !defined(__GNUC__)
+#error "__V86_THREADED__ requires labels as values (GCC, Clang)."
+#endif
+
+	/* label of the opcode. */
+#define THREADED_ADDR(n)	&&op_##n
+#define THREADED_ADDR_ROW(h) \
+	THREADED_ADDR(h##0), THREADED_ADDR(h##1), THREADED_ADDR(h##2), THREADED_ADDR(h##3), \
+	THREADED_ADDR(h##4), THREADED_ADDR(h##5), THREADED_ADDR(h##6), THREADED_ADDR(h##7), \
+	THREADED_ADDR(h##8), THREADED_ADDR(h##9), THREADED_ADDR(h##a), THREADED_ADDR(h##b), \
+	THREADED_ADDR(h##c), THREADED_ADDR(h##d), THREADED_ADDR(h##e), THREADED_ADDR(h##f)
+
+	/* fetch the next opcode and jump to its label directly. */
+#define THREADED_NEXT() \
+	if (done >= count || hasStops() || state->cycles >= until) { \
+		goto leave; \
+	} \
+	done++; \
+	opcode = fetchOpcode(); \
+	state->cycles += CYCLES[opcode]; \
+	goto *m_Threaded[opcode]
+
+	/* inlined body of the opcode. */
+#define THREADED_OP(n) \
+	op_##n: \
+	onOpcode<TCore, 0x##n>(this, 0x##n); \
+	THREADED_NEXT();
+
+#define THREADED_OP_ROW(h) \
+	THREADED_OP(h##0) THREADED_OP(h##1) THREADED_OP(h##2) THREADED_OP(h##3) \
+	THREADED_OP(h##4) THREADED_OP(h##5) THREADED_OP(h##6) THREADED_OP(h##7) \
+	THREADED_OP(h##8) THREADED_OP(h##9) THREADED_OP(h##a) THREADED_OP(h##b) \
+	THREADED_OP(h##c) THREADED_OP(h##d) THREADED_OP(h##e) THREADED_OP(h##f)
+
+	template<class TCore>
+	uint32_t Ci8086::execLoop(uint32_t count, uint64_t until)
+	{
+		static void* const LABELS[256] = {
+			THREADED_ADDR_ROW(0), THREADED_ADDR_ROW(1), THREADED_ADDR_ROW(2), THREADED_ADDR_ROW(3),
+			THREADED_ADDR_ROW(4), THREADED_ADDR_ROW(5), THREADED_ADDR_ROW(6), THREADED_ADDR_ROW(7),
+			THREADED_ADDR_ROW(8), THREADED_ADDR_ROW(9), THREADED_ADDR_ROW(a), THREADED_ADDR_ROW(b),
+			THREADED_ADDR_ROW(c), THREADED_ADDR_ROW(d), THREADED_ADDR_ROW(e), THREADED_ADDR_ROW(f)
+		};
+
+		USE_STATE(this, state);
+		uint32_t done = 0;
+		uint8_t opcode;
+
+		if (m_Trace) {
+			return execTrace(count, until);
+		}
+
+		if (m_Jit) {
+			return execJit(count, until);
+		}
+
+		if (m_Blocks) {
+			while (done < count) {
+				if (hasStops() || state->cycles >= until) {
+					break;
+				}
+
+				done += execBlock<TCore>(count - done, until);
+			}
+
+			return done;
+		}
+
+		if (m_ThreadedDirty) {
+			// --> overridden opcodes are called through the table.
+			for (uint32_t i = 0; i < 256; ++i) {
+				m_Threaded[i] = m_Opcodes[i] == OPCODES<TCore>[i] ? LABELS[i] : &&op_call;
+			}
+
+			m_ThreadedCall = &&op_call;
+
+			m_ThreadedDirty = false;
+		}
+
+		THREADED_NEXT();
+
+	op_call:
+		m_Opcodes[opcode](this, opcode);
+		THREADED_NEXT();
+
+		THREADED_OP_ROW(0) THREADED_OP_ROW(1) THREADED_OP_ROW(2) THREADED_OP_ROW(3)
+		THREADED_OP_ROW(4) THREADED_OP_ROW(5) THREADED_OP_ROW(6) THREADED_OP_ROW(7)
+		THREADED_OP_ROW(8) THREADED_OP_ROW(9) THREADED_OP_ROW(a) THREADED_OP_ROW(b)
+		THREADED_OP_ROW(c) THREADED_OP_ROW(d) THREADED_OP_ROW(e) THREADED_OP_ROW(f)
+
+	leave:
+		return done;
+	}
+#endif
+
+	template<class TCore>
+	uint32_t Ci8086::execBlock(uint32_t count, uint64_t until)
+	{
+		USE_STATE(this, state);
+		uint32_t addr = addr16(SEG_CS, state->ip);
+
+		if (!m_Block || m_Next != addr) {
+			if (m_Block && m_Record) {
+				// --> left the block by a branch or a REP rewind.
+				commitBlock(m_Block);
+			}
+
+			// --> linked blocks skip the lookup, before the dropped ones are freed.
+			block_t* block = m_Last ? m_Blocks->follow(m_Last, addr) : m_Blocks->find(addr);
+
+			m_Blocks->collect();
+			m_Index = 0;
+			m_Record = false;
+			m_Last = nullptr;
+
+			if ((m_Block = block) == nullptr) {
+				m_Block = m_Blocks->create(addr);
+				m_Record = true;
+			}
+		}
+
+		if (m_Record) {
+			execDecode();
+
+			if (recordUop(addr)) {
+				m_Next = addr + state->fetch.length;
+				return 1;
+			}
+
+			if (m_Block) {
+				commitBlock(m_Block);
+				m_Block = nullptr;
+			}
+
+			return 1;
+		}
+
+		block_t* block = m_Block;
+		uint32_t done = 0;
+
+		while (true) {
+			const uop_t* uop = &block->uops[m_Index];
+			uint32_t n = 0;
+
+			if (uop->fuse != FUSE_NONE && count - done > 1) {
+				n = execFused<TCore>(uop, count - done, until);
+			}
+
+			if (!n) {
+				execUop(uop);
+				n = 1;
+			}
+
+			for (uint32_t i = 0; i < n; ++i) {
+				addr += uop[i].length;
+			}
+
+			done += n;
+			m_Index += n;
+			m_Next = addr;
+
+			// --> dropped: the uops have stored into it.
+			if (!m_Block) {
+				break;
+			}
+
+			// --> the end, or a branch taken out of the middle.
+			if (m_Index >= block->uops.size() || addr16(SEG_CS, state->ip) != addr) {
+				m_Block = nullptr;
+				m_Last = block;
+				break;
+			}
+
+			if (done >= count || hasStops() || state->cycles >= until) {
+				break;
+			}
+		}
+
+		return done;
+	}
+
+	template<class TCore>
+	uint32_t Ci8086::execFused(const uop_t* uop, uint32_t count, uint64_t until)
+	{
+		USE_STATE(this, state);
+
+		switch (uop->fuse) {
+		case FUSE_CMP_JCC:
+		case FUSE_DEC_JCC: {
+			const uop_t* jcc = uop + 1;
+			bool taken;
+
+			beginUop(uop);
+
+			if (uop->fuse == FUSE_CMP_JCC) {
+				taken = execCmpJcc<TCore>(uop->opcode, jcc->opcode & 0x0f);
+			}
+
+			else {
+				uint16_t& reg = state->regs[uop->opcode & 0x07].word[REG_WORD];
+				reg = alu<uint16_t, ALU_DEC>(state, reg, 1);
+				taken = (reg != 0) == (jcc->opcode == 0x75);
+			}
+
+			m_Uop = nullptr;
+
+			// --> a memory operand may have raised an event: Jcc is the next step then.
+			if (hasStops() || state->cycles >= until) {
+				return 1;
+			}
+
+			beginUop(jcc);
+			state->ip++;
+
+			if (taken) {
+				state->ip += uint16_t(int8_t(jcc->bytes[1]));
+			}
+
+			m_Uop = nullptr;
+			return 2;
+		}
+
+		case FUSE_PUSH:
+		case FUSE_POP: {
+			uint32_t n = 1;
+			uint64_t cycles = state->cycles + CYCLES[uop->opcode];
+
+			// --> as many as the instruction by instruction loop would retire.
+			while (n < uop->run && n < count && cycles < until) {
+				cycles += CYCLES[uop[n].opcode];
+				n++;
+			}
+
+			uint16_t top = state->sp;
+			uint32_t size = n * 2;
+			bool push = uop->fuse == FUSE_PUSH;
+
+			// --> SP wraps around, or the stack is not plain memory.
+			if (push ? top < size : top > 0x10000 - size) {
+				return 0;
+			}
+
+			uint32_t addr = addr16(SEG_SS, uint16_t(push ? top - size : top));
+			uint8_t* host = direct(addr, size, push ? PAGE_WRITE : PAGE_READ);
+
+			// --> a store into the decoded code refetches the following instructions.
+			if (!host || (push && m_Blocks->isCode(addr, size))) {
+				return 0;
+			}
+
+			for (uint32_t i = 0; i < n; ++i) {
+				uint8_t reg = uop[i].opcode & 0x07;
+
+				if (push) {
+					uint16_t value = state->regs[reg].word[REG_WORD];
+					uint32_t offset = size - (i + 1) * 2;
+
+					// --> 8086 pushes the decremented SP.
+					if (reg == REG_ESP) {
+						value = uint16_t(top - (i + 1) * 2);
+					}
+
+					host[offset] = uint8_t(value);
+					host[offset + 1] = uint8_t(value >> 8);
+				}
+
+				else {
+					state->regs[reg].word[REG_WORD] =
+						uint16_t(host[i * 2] | (host[i * 2 + 1] << 8));
+				}
+
+#ifdef __V86_PROFILE__
+				if (i + 1 < n) {
+					m_Profile.opcode(uop[i].opcode);
+				}
+#endif
+			}
+
+			if (push && m_Jit) {
+				invalidate(addr, size);
+			}
+
+			// --> the last one sets the trace buffer up, and adds its IP and cycles.
+			state->sp = uint16_t(push ? top - size : top + size);
+			state->ip += uint16_t(n - 1);
+			state->cycles = cycles - CYCLES[uop[n - 1].opcode];
+
+			beginUop(&uop[n - 1]);
+			m_Uop = nullptr;
+			return n;
+		}
+
+		default:
+			break;
+		}
+
+		return 0;
+	}
+
+	template<class TCore, uint8_t opcode>
+	void Ci8086::onOpcode(Ci8086* cpu, uint8_t) {
+		switch (opcode >> 4) {
+		case 0x00: cpu->onOpcode0X<TCore, opcode>(); break;
+		case 0x01: cpu->onOpcode1X<TCore, opcode>(); break;
+		case 0x02: cpu->onOpcode2X<TCore, opcode>(); break;
+		case 0x03: cpu->onOpcode3X<TCore, opcode>(); break;
+		case 0x04: cpu->onOpcode4X<TCore, opcode>(); break;
+		case 0x05: cpu->onOpcode5X<TCore, opcode>(); break;
+		case 0x06: cpu->onOpcode6X<TCore, opcode>(); break;
+		case 0x07: cpu->onOpcode7X<TCore, opcode>(); break;
+		case 0x08: cpu->onOpcode8X<TCore, opcode>(); break;
+		case 0x0f: cpu->onOpcodeFX<TCore, opcode>(); break;
+		default: break;
+		}
+	}
+
+	template<class TCore>
+	void Ci8086::execIns16(uint8_t opcode) {
+		USE_STATE(this, state);
+
+		bool rep = state->prefix.rep != REP_NONE;
+		if (rep && !state->cx) {
+			return;
+		}
+
+		uint8_t width = (opcode & 0x01) ? 2 : 1;
+		uint32_t count = rep ? state->cx : 1;
+		uint32_t addr = addr16(SEG_ES, state->di);
+		uint8_t* host = nullptr;
+
+		if (count > REP_CHUNK) {
+			count = REP_CHUNK;
+		}
+
+		// --> ascending, within the segment and the page: one block.
+		if (!eflag<EFLAG_DF>(state)) {
+			uint32_t room = (0x10000 - state->di) / width;
+			uint32_t page = (CMemoryBus::PAGE_SIZE - (addr & (CMemoryBus::PAGE_SIZE - 1))) / width;
+
+			if (room > page) {
+				room = page;
+			}
+
+			if (room && count > room) {
+				count = room;
+			}
+
+			if (room) {
+				host = direct(addr, count * width, PAGE_WRITE);
+			}
+		}
+
+		if (host) {
+			core<TCore>()->inBlock(state->dx, host, count, width);
+			state->di += count * width;
+
+			if (isDecoding()) {
+				invalidate(addr, count * width);
+			}
+		}
+
+		else {
+			uint16_t step = eflag<EFLAG_DF>(state) ? -width : width;
+
+			for (uint32_t i = 0; i < count; ++i) {
+				uint8_t data[2];
+				core<TCore>()->inBlock(state->dx, data, 1, width);
+
+				if (width > 1) {
+					store16<TCore>(addr16(SEG_ES, state->di), data[0] | (uint16_t(data[1]) << 8));
+				}
+
+				else {
+					store8<TCore>(addr16(SEG_ES, state->di), data[0]);
+				}
+
+				state->di += step;
+			}
+		}
+
+		state->cycles += (count - 1) * CYCLES[opcode];
+
+		if (rep && (state->cx -= count) != 0) {
+			// --> jump to this opcode again.
+			state->ip -= state->fetch.length;
+		}
+	}
+
+	template<class TCore>
+	void Ci8086::execOuts16(uint8_t opcode) {
+		USE_STATE(this, state);
+
+		bool rep = state->prefix.rep != REP_NONE;
+		if (rep && !state->cx) {
+			return;
+		}
+
+		uint8_t width = (opcode & 0x01) ? 2 : 1;
+		uint32_t count = rep ? state->cx : 1;
+		uint32_t addr = addr16imm(state->prefix.seg, state->si);
+		const uint8_t* host = nullptr;
+
+		if (count > REP_CHUNK) {
+			count = REP_CHUNK;
+		}
+
+		// --> ascending, within the segment and the page: one block.
+		if (!eflag<EFLAG_DF>(state)) {
+			uint32_t room = (0x10000 - state->si) / width;
+			uint32_t page = (CMemoryBus::PAGE_SIZE - (addr & (CMemoryBus::PAGE_SIZE - 1))) / width;
+
+			if (room > page) {
+				room = page;
+			}
+
+			if (room && count > room) {
+				count = room;
+			}
+
+			if (room) {
+				host = direct(addr, count * width, PAGE_READ);
+			}
+		}
+
+		if (host) {
+			core<TCore>()->outBlock(state->dx, host, count, width);
+			state->si += count * width;
+		}
+
+		else {
+			uint16_t step = eflag<EFLAG_DF>(state) ? -width : width;
+
+			for (uint32_t i = 0; i < count; ++i) {
+				uint32_t from = addr16imm(state->prefix.seg, state->si);
+				uint8_t data[2];
+
+				if (width > 1) {
+					uint16_t value = load16<TCore>(from);
+					data[0] = uint8_t(value);
+					data[1] = uint8_t(value >> 8);
+				}
+
+				else {
+					data[0] = load8<TCore>(from);
+				}
+
+				core<TCore>()->outBlock(state->dx, data, 1, width);
+				state->si += step;
+			}
+		}
+
+		state->cycles += (count - 1) * CYCLES[opcode];
+
+		if (rep && (state->cx -= count) != 0) {
+			// --> jump to this opcode again.
+			state->ip -= state->fetch.length;
+		}
+	}
+
+#define RM_REG_WORD(rm)		state->regs[rm].word[REG_WORD]
+#define RM_REG_DWORD(rm)	state->regs[rm].dword
+
+// RM= AL (0 | 0), CL (0 | 1), DL (0 | 2), BL (0 | 3),
+//   : AH (4 | 0), CH (4 | 1), DH (4 | 2), BH (4 | 3)
+#define RM_REG_BYTE(rm)		state->regs[(rm) & 0x03].byte[((rm) & 0x04) ? REG_BYTE_HI : REG_BYTE_LO]
+
+	template<class TCore>
+	uint8_t Ci8086::readRM8() {
+		USE_STATE(this, state);
+		USE_FETCH_STATE(this, fst);
+
+		if (fst->mode < 3) {
+			return load8<TCore>(addrModRM16());
+		}
+
+		return RM_REG_BYTE(fst->rm);
+	}
+
+	template<class TCore>
+	uint16_t Ci8086::readRM16() {
+		USE_STATE(this, state);
+		USE_FETCH_STATE(this, fst);
+
+		if (fst->mode < 3) {
+			return load16<TCore>(addrModRM16());
+		}
+
+		return RM_REG_WORD(fst->rm);
+	}
+
+	template<class TCore>
+	uint32_t Ci8086::readRM32()
+	{
+		USE_STATE(this, state);
+		USE_FETCH_STATE(this, fst);
+
+		if (fst->mode < 3) {
+			uint32_t value;
+			core<TCore>()->load(addrModRM16(), &value, sizeof(value));
+			return value;
+		}
+
+		return RM_REG_DWORD(fst->rm);
+	}
+
+	template<class TCore>
+	void Ci8086::writeRM8(uint8_t value) {
+		USE_STATE(this, state);
+		USE_FETCH_STATE(this, fst);
+
+		if (fst->mode < 3) {
+			store8<TCore>(addrModRM16(), value);
+			return;
+		}
+
+		uint8_t reg = fst->rm & 0x03;
+		uint8_t off = (fst->rm & 0x04)
+			? REG_BYTE_HI : REG_BYTE_LO;
+
+		state->regs[reg].byte[off] = value;
+	}
+
+	template<class TCore>
+	void Ci8086::writeRM16(uint16_t value) {
+		USE_STATE(this, state);
+		USE_FETCH_STATE(this, fst);
+
+		if (fst->mode < 3) {
+			store16<TCore>(addrModRM16(), value);
+			return;
+		}
+
+		RM_REG_WORD(fst->rm) = value;
+	}
+
+	template<class TCore>
+	void Ci8086::writeRM32(uint32_t value) {
+		USE_STATE(this, state);
+		USE_FETCH_STATE(this, fst);
+
+		if (fst->mode < 3) {
+			core<TCore>()->store(addrModRM16(), &value, sizeof(value));
+			return;
+		}
+
+		RM_REG_DWORD(fst->rm) = value;
+	}
+
+	/* PUSH, POP macros. */
+#define PUSH16_SEG(type, seg)	\
+	push16<TCore>(type(state->seg))
+
+#define POP16_SEG(type, seg) \
+	state->seg = type(pop16<TCore>());
+
+#define PUSH16_REG(type, reg)	\
+	push16<TCore>(type(state->reg))
+
+#define POP16_REG(type, reg) \
+	state->reg = type(pop16<TCore>());
+
+#define OPERAND_REG8_RM8() \
+	fst->op[0].dword = RM_REG_BYTE(fst->reg); \
+	fst->op[1].dword = readRM8<TCore>()
+
+#define OPERAND_REG16_RM16() \
+	fst->op[0].dword = RM_REG_WORD(fst->reg); \
+	fst->op[1].dword = readRM16<TCore>()
+
+/* record the operation, flags are evaluated when they are read. */
+#define FLAG_LAZY(kind, size) \
+	eflag_lazy(state, kind, size, fst->op[0].dword, fst->op[1].dword, fst->res.dword)
+
+	template<class TCore>
+	bool Ci8086::execCmpJcc(uint8_t opcode, uint8_t cc)
+	{
+		USE_STATE(this, state);
+		USE_FETCH_STATE(this, fst);
+
+		/* the lazy flags are recorded as the CMP or TEST handler would. */
+		switch (opcode) {
+		case 0x38: { /* CMP Eb Gb */
+			fetchModRm16();
+			uint8_t dst = readRM8<TCore>(), src = RM_REG_BYTE(fst->reg);
+			alu<uint8_t, ALU_CMP>(state, dst, src);
+			return alu_cond<uint8_t, ALU_CMP>(cc, dst, src);
+		}
+
+		case 0x39: { /* CMP Ev Gv */
+			fetchModRm16();
+			uint16_t dst = readRM16<TCore>(), src = RM_REG_WORD(fst->reg);
+			alu<uint16_t, ALU_CMP>(state, dst, src);
+			return alu_cond<uint16_t, ALU_CMP>(cc, dst, src);
+		}
+
+		case 0x3a: { /* CMP Gb Eb */
+			fetchModRm16();
+			uint8_t dst = RM_REG_BYTE(fst->reg), src = readRM8<TCore>();
+			alu<uint8_t, ALU_CMP>(state, dst, src);
+			return alu_cond<uint8_t, ALU_CMP>(cc, dst, src);
+		}
+
+		case 0x3b: { /* CMP Gv Ev */
+			fetchModRm16();
+			uint16_t dst = RM_REG_WORD(fst->reg), src = readRM16<TCore>();
+			alu<uint16_t, ALU_CMP>(state, dst, src);
+			return alu_cond<uint16_t, ALU_CMP>(cc, dst, src);
+		}
+
+		case 0x3c: { /* CMP AL Ib */
+			uint8_t dst = state->al, src = fetch8();
+			alu<uint8_t, ALU_CMP>(state, dst, src);
+			return alu_cond<uint8_t, ALU_CMP>(cc, dst, src);
+		}
+
+		case 0x3d: { /* CMP eAX Iv */
+			uint16_t dst = state->ax, src = fetch16();
+			alu<uint16_t, ALU_CMP>(state, dst, src);
+			return alu_cond<uint16_t, ALU_CMP>(cc, dst, src);
+		}
+
+		case 0x80: { /* GRP1 CMP Eb Ib */
+			fetchModRm16();
+			uint8_t dst = readRM8<TCore>(), src = fetch8();
+			PROFILE(group1(ALU_CMP));
+			alu<uint8_t, ALU_CMP>(state, dst, src);
+			return alu_cond<uint8_t, ALU_CMP>(cc, dst, src);
+		}
+
+		case 0x81: case 0x83: { /* GRP1 CMP Ev Iv, Ev Ib */
+			fetchModRm16();
+			uint16_t dst = readRM16<TCore>();
+			uint16_t src = opcode == 0x81 ? fetch16() : uint16_t(int8_t(fetch8()));
+			PROFILE(group1(ALU_CMP));
+			alu<uint16_t, ALU_CMP>(state, dst, src);
+			return alu_cond<uint16_t, ALU_CMP>(cc, dst, src);
+		}
+
+		case 0x84: { /* TEST Gb Eb */
+			fetchModRm16();
+			uint8_t dst = RM_REG_BYTE(fst->reg), src = readRM8<TCore>();
+			alu<uint8_t, ALU_TEST>(state, dst, src);
+			return alu_cond<uint8_t, ALU_TEST>(cc, dst, src);
+		}
+
+		case 0x85: { /* TEST Gv Ev */
+			fetchModRm16();
+			uint16_t dst = RM_REG_WORD(fst->reg), src = readRM16<TCore>();
+			alu<uint16_t, ALU_TEST>(state, dst, src);
+			return alu_cond<uint16_t, ALU_TEST>(cc, dst, src);
+		}
+
+		default:
+			break;
+		}
+
+		return false;
+	}
+
+	template<class TCore, uint8_t opcode>
+	void Ci8086::onAlu() {
+		USE_STATE(this, state);
+		USE_FETCH_STATE(this, fst);
+		constexpr EALU op = EALU((opcode >> 3) & 0x07);
+
+		switch (opcode & 0x07) {
+		case 0x00: { /* Eb Gb */
+			fetchModRm16();
+			uint8_t res = alu<uint8_t, op>(state, readRM8<TCore>(), RM_REG_BYTE(fst->reg));
+			if (alu_stores(op)) {
+				writeRM8<TCore>(res);
+			}
+			break;
+		}
+
+		case 0x01: { /* Ev Gv */
+			fetchModRm16();
+			uint16_t res = alu<uint16_t, op>(state, readRM16<TCore>(), RM_REG_WORD(fst->reg));
+			if (alu_stores(op)) {
+				writeRM16<TCore>(res);
+			}
+			break;
+		}
+
+		case 0x02: { /* Gb Eb */
+			fetchModRm16();
+			uint8_t res = alu<uint8_t, op>(state, RM_REG_BYTE(fst->reg), readRM8<TCore>());
+			if (alu_stores(op)) {
+				RM_REG_BYTE(fst->reg) = res;
+			}
+			break;
+		}
+
+		case 0x03: { /* Gv Ev */
+			fetchModRm16();
+			uint16_t res = alu<uint16_t, op>(state, RM_REG_WORD(fst->reg), readRM16<TCore>());
+			if (alu_stores(op)) {
+				RM_REG_WORD(fst->reg) = res;
+			}
+			break;
+		}
+
+		case 0x04: { /* REG_AL Ib */
+			uint8_t res = alu<uint8_t, op>(state, state->al, fetch8());
+			if (alu_stores(op)) {
+				state->al = res;
+			}
+			break;
+		}
+
+		case 0x05: { /* eAX Iv */
+			uint16_t res = alu<uint16_t, op>(state, state->ax, fetch16());
+			if (alu_stores(op)) {
+				state->ax = res;
+			}
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+
+	template<class TCore, uint8_t opcode>
+	void Ci8086::onOpcode0X() {
+		USE_STATE(this, state);
+
+		switch (opcode & 0x0f) {
+		case 0x00: case 0x01: case 0x02: /* 00 ~ 05 ADD */
+		case 0x03: case 0x04: case 0x05:
+			onAlu<TCore, opcode>();
+			break;
+
+		case 0x06: { /* 06 PUSH SEG_ES */
+			PUSH16_SEG(uint16_t, es);
+			break;
+		}
+
+		case 0x07: { /* 07 POP SEG_ES */
+			POP16_SEG(uint16_t, es);
+			break;
+		}
+
+		case 0x08: case 0x09: case 0x0A: /* 08 ~ 0D OR */
+		case 0x0B: case 0x0C: case 0x0D:
+			onAlu<TCore, opcode>();
+			break;
+
+		case 0x0E: { /* 0E PUSH SEG_CS */
+			PUSH16_SEG(uint16_t, cs);
+			break;
+		}
+		case 0x0F: { /* 0F POP SEG_CS */
+			POP16_SEG(uint16_t, cs);
+			break;
+		}
+		}
+	}
+
+	template<class TCore, uint8_t opcode>
+	void Ci8086::onOpcode1X() {
+		USE_STATE(this, state);
+		switch (opcode & 0x0f) {
+		case 0x00: case 0x01: case 0x02: /* 10 ~ 15 ADC */
+		case 0x03: case 0x04: case 0x05:
+			onAlu<TCore, opcode>();
+			break;
+
+		case 0x06: { /* 16 PUSH SEG_SS */
+			PUSH16_SEG(uint16_t, ss);
+			break;
+		}
+
+		case 0x07: { /* 17 POP SEG_SS */
+			POP16_SEG(uint16_t, ss);
+			break;
+		}
+
+		case 0x08: case 0x09: case 0x0A: /* 18 ~ 1D SBB */
+		case 0x0B: case 0x0C: case 0x0D:
+			onAlu<TCore, opcode>();
+			break;
+
+		case 0x0E: { /* 1E PUSH SEG_DS */
+			PUSH16_SEG(uint16_t, ds);
+			break;
+		}
+		case 0x0F: { /* 1F POP SEG_DS */
+			POP16_SEG(uint16_t, ds);
+			break;
+		}
+		}
+	}
+
+	template<class TCore, uint8_t opcode>
+	void Ci8086::onOpcode2X() {
+		USE_STATE(this, state);
+		USE_FETCH_STATE(this, fst);
+
+		switch (opcode & 0x0f) {
+		case 0x00: case 0x01: case 0x02: /* 20 ~ 25 AND */
+		case 0x03: case 0x04: case 0x05:
+			onAlu<TCore, opcode>();
+			break;
+
+		case 0x06: { /* 26 NOP */
+			break;
+		}
+
+		case 0x07: { /* 27 DAA */
+			if ((state->al & 0x0f) > 9 || eflag<EFLAG_AF>(state)) {
+				fst->op[0].dword = state->al + 6;
+				state->al = fst->op[0].dword & 255;
+
+				if ((fst->op[0].dword & REG_MASK_HI8) != 0) {
+					eflag<EFLAG_CF>(state, 1);
+				}
+				else {
+					eflag<EFLAG_CF>(state, 0);
+				}
+
+				eflag<EFLAG_AF>(state, 1);
+			}
+
+			if (state->al > 0x9f || eflag<EFLAG_CF>(state)) {
+				fst->res.dword = (state->al += 0x60);
+				eflag<EFLAG_CF>(state, 1);
+			}
+
+			fst->res.dword = (state->al &= 0xff);
+			FLAG_LAZY(LAZY_RES, sizeof(uint8_t));
+			break;
+		}
+
+		case 0x08: case 0x09: case 0x0A: /* 28 ~ 2D SUB */
+		case 0x0B: case 0x0C: case 0x0D:
+			onAlu<TCore, opcode>();
+			break;
+
+		case 0x0E: { /* 2E NOP */
+			break;
+		}
+		case 0x0F: { /* 2F DAS */
+			if ((state->al & 0x0f) > 9 || eflag<EFLAG_AF>(state)) {
+				fst->op[0].dword = state->al - 6;
+				state->al = fst->op[0].dword & 255;
+
+				if ((fst->op[0].dword & REG_MASK_HI8) != 0) {
+					eflag<EFLAG_CF>(state, 1);
+				}
+				else {
+					eflag<EFLAG_CF>(state, 0);
+				}
+
+				eflag<EFLAG_AF>(state, 1);
+			}
+			else {
+				eflag<EFLAG_AF>(state, 0);
+			}
+
+			if ((state->al & 0xf0) > 0x90 || eflag<EFLAG_CF>(state)) {
+				fst->res.dword = (state->al -= 0x60);
+				eflag<EFLAG_CF>(state, 1);
+			}
+			else {
+				eflag<EFLAG_CF>(state, 0);
+			}
+
+			fst->res.dword = (state->al &= 0xff);
+			FLAG_LAZY(LAZY_RES, sizeof(uint8_t));
+			break;
+		}
+		}
+	}
+
+	template<class TCore, uint8_t opcode>
+	void Ci8086::onOpcode3X() {
+		USE_STATE(this, state);
+
+		switch (opcode & 0x0f) {
+		case 0x00: case 0x01: case 0x02: /* 30 ~ 35 XOR */
+		case 0x03: case 0x04: case 0x05:
+			onAlu<TCore, opcode>();
+			break;
+
+		case 0x06: { /* 36 NOP */
+			break;
+		}
+
+		case 0x07: { /* 37 AAA */
+			if ((state->al & 0x0f) > 9 || eflag<EFLAG_AF>(state)) {
+				state->al += 6;
+				state->ah += 1;
+
+				eflag<EFLAG_CF>(state, 1);
+				eflag<EFLAG_AF>(state, 1);
+			}
+
+			else {
+				eflag<EFLAG_CF>(state, 0);
+				eflag<EFLAG_AF>(state, 0);
+			}
+
+			state->al &= 0x0f;
+			break;
+		}
+
+		case 0x08: case 0x09: case 0x0A: /* 38 ~ 3D CMP */
+		case 0x0B: case 0x0C: case 0x0D:
+			onAlu<TCore, opcode>();
+			break;
+
+		case 0x0E: { /* 3E NOP */
+			break;
+		}
+		case 0x0F: { /* 3F AAS */
+			if ((state->al & 0x0f) > 9 || eflag<EFLAG_AF>(state)) {
+				state->al -= 6;
+				state->ah -= 1;
+
+				eflag<EFLAG_CF>(state, 1);
+				eflag<EFLAG_AF>(state, 1);
+			}
+
+			else {
+				eflag<EFLAG_CF>(state, 0);
+				eflag<EFLAG_AF>(state, 0);
+			}
+
+			state->al &= 0x0f;
+			break;
+		}
+		}
+	}
+
+	template<class TCore, uint8_t opcode>
+	void Ci8086::onOpcode4X() {
+		USE_STATE(this, state);
+
+		/* 40 ~ 47 INC, 48 ~ 4F DEC: eAX (0), eCX, eDX, eBX, eSP, eBP, eSI, eDI (7) */
+		constexpr EALU op = (opcode & 0x08) ? ALU_DEC : ALU_INC;
+		uint16_t& reg = state->regs[opcode & 0x07].word[REG_WORD];
+
+		reg = alu<uint16_t, op>(state, reg, 1);
+	}
+
+	template<class TCore, uint8_t opcode>
+	void Ci8086::onOpcode5X() {
+		USE_STATE(this, state);
+
+		uint8_t reg = opcode & 0x07;
+
+		/* reg: eAX (0), eCX, eDX, eBX, eSP, eBP, eSI, eDI (7) */
+		if ((opcode & 0x0f) <= 0x07) {
+			uint16_t value = state->regs[reg].word[REG_WORD];
+
+			// --> 8086 pushes the decremented SP.
+			if (reg == REG_ESP) {
+				value -= 2;
+			}
+
+			push16<TCore>(value);
+		}
+
+		else {
+			state->regs[reg].word[REG_WORD] = pop16<TCore>();
+		}
+	}
+
+	template<class TCore, uint8_t opcode>
+	void Ci8086::onOpcode6X() {
+		USE_STATE(this, state);
+		USE_FETCH_STATE(this, fst);
+
+		switch (opcode & 0x0f) {
+		case 0x00: { /* 60 PUSHA */
+			uint16_t o_sp = state->sp;
+
+			{ PUSH16_REG(uint16_t, ax); }
+			{ PUSH16_REG(uint16_t, cx); }
+			{ PUSH16_REG(uint16_t, dx); }
+			{ PUSH16_REG(uint16_t, bx); }
+			push16<TCore>(o_sp);
+			{ PUSH16_REG(uint16_t, bp); }
+			{ PUSH16_REG(uint16_t, si); }
+			{ PUSH16_REG(uint16_t, di); }
+			break;
+		}
+
+		case 0x01: { /* 61 POPA */
+			{ POP16_REG(uint16_t, ax); }
+			{ POP16_REG(uint16_t, cx); }
+			{ POP16_REG(uint16_t, dx); }
+			{ POP16_REG(uint16_t, bx); }
+			pop16<TCore>(); // --> sp.
+			{ POP16_REG(uint16_t, bp); }
+			{ POP16_REG(uint16_t, si); }
+			{ POP16_REG(uint16_t, di); }
+			break;
+		}
+
+		case 0x02: { /* 62 BOUND Gv Ev */
+			fetchModRm16();
+			uint32_t addr = addrModRM16();
+
+			int32_t s1 = RM_REG_WORD(fst->reg);
+			int32_t s2 = 0;
+
+			core<TCore>()->load(addr, &s2, sizeof(s2));
+
+			if (s1 < s2) {
+				// todo: interrupt 0x05.
+			}
+
+			else {
+				addr += 2;
+				core<TCore>()->load((addr >> 8) + (addr & 15), &s2, sizeof(s2));
+
+				if (s1 > s2) {
+					// todo: interrupt 0x05.
+				}
+			}
+
+			break;
+		}
+
+		case 0x03: case 0x04: case 0x05: case 0x06: case 0x07:
+			/* 63 ~ 67 NOP. */
+			break;
+
+		case 0x08: { /* 68 PUSH Iv */
+			push16<TCore>(fetch16());
+			break;
+		}
+
+		case 0x09: { /* 69 IMUL Gv Ev Iv */
+			fetchModRm16();
+			fst->op[0].dword = readRM16<TCore>();
+			fst->op[1].dword = fetch16();
+
+			if ((fst->op[0].dword & 0x8000L) != 0) {
+				fst->op[0].dword |= REG_MASK_HI16;
+			}
+
+			if ((fst->op[1].dword & 0x8000L) != 0) {
+				fst->op[1].dword |= REG_MASK_HI16;
+			}
+
+			fst->res.dword
+				= fst->op[0].dword
+				* fst->op[1].dword;
+
+			writeRM16<TCore>(fst->res.word[REG_WORD]);
+			if ((fst->res.dword & REG_MASK_HI16) != 0) {
+				eflag<EFLAG_CF>(state, 1);
+				eflag<EFLAG_OF>(state, 1);
+			}
+
+			else {
+				eflag<EFLAG_CF>(state, 0);
+				eflag<EFLAG_OF>(state, 0);
+			}
+
+			break;
+		}
+
+		case 0x0A: { /* 6A PUSH Ib */
+			// --> sign extended.
+			push16<TCore>(uint16_t(int8_t(fetch8())));
+			break;
+		}
+
+		case 0x0B: { /* 6B IMUL Gv Eb Ib */
+			fetchModRm16();
+			fst->op[0].dword = readRM8<TCore>();
+			fst->op[1].dword = fetch8();
+
+			if ((fst->op[0].dword & 0x8000L) != 0) {
+				fst->op[0].dword |= REG_MASK_HI16;
+			}
+
+			if ((fst->op[1].dword & 0x8000L) != 0) {
+				fst->op[1].dword |= REG_MASK_HI16;
+			}
+
+			fst->res.dword
+				= fst->op[0].dword
+				* fst->op[1].dword;
+
+			writeRM16<TCore>(fst->res.word[REG_WORD]);
+			if ((fst->res.dword & REG_MASK_HI16) != 0) {
+				eflag<EFLAG_CF>(state, 1);
+				eflag<EFLAG_OF>(state, 1);
+			}
+
+			else {
+				eflag<EFLAG_CF>(state, 0);
+				eflag<EFLAG_OF>(state, 0);
+			}
+
+			break;
+		}
+		case 0x0C:   /* 6C INSB */
+		case 0x0D:   /* 6D INSW */
+			execIns16<TCore>(opcode);
+			break;
+
+		case 0x0E:   /* 6E OUTSB */
+		case 0x0F:   /* 6F OUTSW */
+			execOuts16<TCore>(opcode);
+			break;
+		}
+	}
+
+	template<class TCore, uint8_t opcode>
+	void Ci8086::onOpcode7X() {
+		USE_STATE(this, state);
+
+		switch (opcode & 0x0f) {
+		case 0x00: { /* 70 JO Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (eflag<EFLAG_OF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x01: { /* 71 JNO Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (!eflag<EFLAG_OF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x02: { /* 72 JB Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (eflag<EFLAG_CF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x03: { /* 73 JNB Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (!eflag<EFLAG_CF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x04: { /* 74 JZ Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (eflag<EFLAG_ZF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x05: { /* 75 JNZ Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (!eflag<EFLAG_ZF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x06: { /* 76 JBE Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (eflag<EFLAG_CF>(state) || eflag<EFLAG_ZF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x07: { /* 77 JA Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (!eflag<EFLAG_CF>(state) && !eflag<EFLAG_ZF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x08: { /* 78 JS Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (eflag<EFLAG_SF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x09: { /* 79 JNS Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (!eflag<EFLAG_SF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x0A: { /* 7A JPE Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (eflag<EFLAG_PF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x0B: { /* 7B JPO Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (!eflag<EFLAG_PF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x0C: { /* 7C JL Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (eflag<EFLAG_SF>(state) != eflag<EFLAG_OF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x0D: { /* 7D JGE Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (eflag<EFLAG_SF>(state) == eflag<EFLAG_OF>(state)) {
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x0E: { /* 7E JLE Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (eflag<EFLAG_SF>(state) != eflag<EFLAG_OF>(state) ||
+				eflag<EFLAG_ZF>(state))
+			{
+				state->ip += rel;
+			}
+
+			break;
+		}
+		case 0x0F: { /* 7F JG Jb */
+			uint16_t rel = int8_t(fetch8());
+			if (eflag<EFLAG_SF>(state) == eflag<EFLAG_OF>(state) &&
+				!eflag<EFLAG_ZF>(state))
+			{
+				state->ip += rel;
+			}
+
+			break;
+		}
+		}
+	}
+
+	template<class TCore, uint8_t opcode>
+	void Ci8086::onOpcode8X() {
+		USE_STATE(this, state);
+		USE_FETCH_STATE(this, fst);
+		switch (opcode & 0x0f) {
+		case 0x00: case 0x02: { /* 80/82 GRP1 Eb Ib */
+			fetchModRm16();
+			fst->op[0].dword = readRM8<TCore>();
+			fst->op[1].dword = fetch8();
+			PROFILE(group1(fst->reg));
+			GROUP1_8[fst->reg](this);
+
+			if (fst->reg < 7) {
+				writeRM8<TCore>(fst->res.byte[REG_BYTE_LO]);
+			}
+			break;
+		}
+
+		case 0x01: case 0x03: { /* 81 GRP1 Ev Iv, 83 GRP1 Ev Ib */
+			fetchModRm16();
+			fst->op[0].dword = readRM16<TCore>();
+			if ((opcode & 0x0f) == 0x01) {
+				fst->op[1].dword = fetch16();
+			}
+
+			else {
+				// --> sign extended.
+				fst->op[1].dword = uint16_t(int8_t(fetch8()));
+			}
+
+			PROFILE(group1(fst->reg));
+			GROUP1_16[fst->reg](this);
+
+			if (fst->reg < 7) {
+				writeRM16<TCore>(fst->res.word[REG_WORD]);
+			}
+			break;
+		}
+
+		case 0x04: { /* 84 TEST Gb Eb */
+			fetchModRm16();
+			alu<uint8_t, ALU_TEST>(state, RM_REG_BYTE(fst->reg), readRM8<TCore>());
+			break;
+		}
+
+		case 0x05: { /* 85 TEST Gv Ev */
+			fetchModRm16();
+			alu<uint16_t, ALU_TEST>(state, RM_REG_WORD(fst->reg), readRM16<TCore>());
+			break;
+		}
+
+		case 0x06: { /* 86 XCHG Gb Eb */
+			fetchModRm16();
+			OPERAND_REG8_RM8();
+			writeRM8<TCore>(fst->op[0].byte[REG_BYTE_LO]);
+			RM_REG_BYTE(fst->reg) = fst->op[1].byte[REG_BYTE_LO];
+			break;
+		}
+
+		case 0x07: { /* 87 XCHG Gv Ev */
+			fetchModRm16();
+			OPERAND_REG16_RM16();
+			writeRM16<TCore>(fst->op[0].word[REG_WORD]);
+			RM_REG_WORD(fst->reg) = fst->op[1].word[REG_WORD];
+			break;
+		}
+
+		case 0x08: { /* 88 MOV Eb Gb */
+			fetchModRm16();
+			writeRM8<TCore>(RM_REG_BYTE(fst->reg));
+			break;
+		}
+
+		case 0x09: { /* 89 MOV Ev Gv */
+			fetchModRm16();
+			writeRM16<TCore>(RM_REG_WORD(fst->reg));
+			break;
+		}
+		case 0x0A: { /* 8A MOV Gb Eb */
+			fetchModRm16();
+			RM_REG_BYTE(fst->reg) = readRM8<TCore>();
+			break;
+		}
+		case 0x0B: { /* 8B MOV Gv Ev */
+			fetchModRm16();
+			RM_REG_WORD(fst->reg) = readRM16<TCore>();
+			break;
+		}
+		case 0x0C: { /* 8C MOV Ew Sw */
+			fetchModRm16();
+
+			// --> 8086 decodes two bits of Sw, never the trace registers.
+			writeRM16<TCore>(state->segs[fst->reg & 0x03].word[REG_WORD]);
+			break;
+		}
+		case 0x0D: { /* 8D LEA Gv M */
+			fetchModRm16();
+			uint32_t addr = addrModRM16();
+			RM_REG_WORD(fst->reg) 
+				= addr - (state->prefix.seg << 4);
+			break;
+		}
+
+		case 0x0E: { /* 8E MOV Sw Ew */
+			fetchModRm16();
+			state->segs[fst->reg & 0x03].word[REG_WORD] = readRM16<TCore>();
+			break;
+		}
+
+		case 0x0F: { /* 8F POP Ev */
+			fetchModRm16();
+			writeRM16<TCore>(pop16<TCore>());
+			break;
+		}
+		}
+	}
+
+	template<class TCore, uint8_t opcode>
+	void Ci8086::onOpcodeFX() {
+		switch (opcode & 0x0f) {
+		case 0x04: /* F4 HLT */
+			stop(STOP_HALT);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+#define OPCODE_ROW(n) \
+	&Ci8086::onOpcode<TCore, n + 0x0>, &Ci8086::onOpcode<TCore, n + 0x1>, &Ci8086::onOpcode<TCore, n + 0x2>, &Ci8086::onOpcode<TCore, n + 0x3>, \
+	&Ci8086::onOpcode<TCore, n + 0x4>, &Ci8086::onOpcode<TCore, n + 0x5>, &Ci8086::onOpcode<TCore, n + 0x6>, &Ci8086::onOpcode<TCore, n + 0x7>, \
+	&Ci8086::onOpcode<TCore, n + 0x8>, &Ci8086::onOpcode<TCore, n + 0x9>, &Ci8086::onOpcode<TCore, n + 0xa>, &Ci8086::onOpcode<TCore, n + 0xb>, \
+	&Ci8086::onOpcode<TCore, n + 0xc>, &Ci8086::onOpcode<TCore, n + 0xd>, &Ci8086::onOpcode<TCore, n + 0xe>, &Ci8086::onOpcode<TCore, n + 0xf>
+
+	template<class TCore>
+	const Ci8086::opcode_t Ci8086::OPCODES[256] = {
+		OPCODE_ROW(0x00), OPCODE_ROW(0x10), OPCODE_ROW(0x20), OPCODE_ROW(0x30),
+		OPCODE_ROW(0x40), OPCODE_ROW(0x50), OPCODE_ROW(0x60), OPCODE_ROW(0x70),
+		OPCODE_ROW(0x80), OPCODE_ROW(0x90), OPCODE_ROW(0xa0), OPCODE_ROW(0xb0),
+		OPCODE_ROW(0xc0), OPCODE_ROW(0xd0), OPCODE_ROW(0xe0), OPCODE_ROW(0xf0)
+	};
+
+}
+
+#undef RM_REG_WORD
+#undef RM_REG_DWORD
+#undef RM_REG_BYTE
+#undef PUSH16_SEG
+#undef POP16_SEG
+#undef PUSH16_REG
+#undef POP16_REG
+#undef OPERAND_REG8_RM8
+#undef OPERAND_REG16_RM16
+#undef FLAG_LAZY
+#undef OPCODE_ROW
+
+#ifdef __V86_THREADED__
+#undef THREADED_ADDR
+#undef THREADED_ADDR_ROW
+#undef THREADED_NEXT
+#undef THREADED_OP
+#undef THREADED_OP_ROW
+#endif
+
+#endif // __V86_CPU_I8086OPS_H__
\ No newline at end of file
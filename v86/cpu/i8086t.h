@@ -0,0 +1,141 @@
+#ifndef __V86_CPU_I8086T_H__
+#define __V86_CPU_I8086T_H__
+#include <type_traits>
+
+// --> after the standard headers, the register macros collide with them.
+#include "i8086ops.h"
+#include "../dev/portbus.h"
+
+namespace v86 {
+
+	/**
+	 * 8086 processor bound to its memory and IO port backends at compile time.
+	 * the instruction templates are instantiated for this core: their accesses call `TMemory` and `TPort`
+	 * without the virtual interface, and inline into the handlers when the backends are final. (`CMemoryBus`, `CPortBus`)
+	 * the `IProc` entry points (`read()`, `inb()`, ...) are thin wrappers over the same typed calls,
+	 * so the block cache, the JIT, traces and lockstep run it as any `Ci8086`.
+	 *
+	 * the backends are attached by the typed setters. through `IProc`, only the bound instances are taken,
+	 * unless the backend type is the interface itself. (e.g. Ci8086T<CMemoryBus, IPort> takes `CReplay`)
+	 */
+	template<typename TMemory = CMemoryBus, typename TPort = CPortBus>
+	class Ci8086T final : public Ci8086 {
+		static_assert(std::is_base_of<IMemory, TMemory>::value, "TMemory should be an IMemory.");
+		static_assert(std::is_base_of<IPort, TPort>::value, "TPort should be an IPort.");
+
+	private:
+		TMemory* m_Mem;
+		TPort* m_Port;
+
+	public:
+		Ci8086T() : Ci8086(OPCODES<Ci8086T>), m_Mem(nullptr), m_Port(nullptr) { }
+
+	public:
+		/* set the memory instance. */
+		inline bool setMemory(TMemory* memory) {
+			m_Mem = memory;
+			return IProc::setMemory(memory);
+		}
+
+		/* set the IO port instance. */
+		inline bool setPort(TPort* port) {
+			m_Port = port;
+			return IProc::setPort(port);
+		}
+
+	protected:
+		virtual bool onAttach(IMemory* memory, IPort* port) override {
+			// --> the interface types take any instance.
+			if (std::is_same<TMemory, IMemory>::value) {
+				m_Mem = static_cast<TMemory*>(memory);
+			}
+
+			if (std::is_same<TPort, IPort>::value) {
+				m_Port = static_cast<TPort*>(port);
+			}
+
+			return memory == m_Mem && port == m_Port;
+		}
+
+	public:
+		/* execute instructions in a batch, through the handlers of this core. */
+		virtual ESTOP run(uint64_t maxInstructions, uint64_t maxCycles) override {
+			return execBatch<Ci8086T>(maxInstructions, maxCycles);
+		}
+
+		/* load bytes from the memory, as the processor: watches apply. */
+		inline uint32_t load(uint32_t addr, void* buf, uint32_t size) {
+			checkWatch(addr, size, WATCH_READ);
+			return read(addr, buf, size);
+		}
+
+		/* store bytes into the memory, as the processor: watches apply. */
+		inline uint32_t store(uint32_t addr, const void* buf, uint32_t size) {
+			checkWatch(addr, size, WATCH_WRITE);
+			return write(addr, buf, size);
+		}
+
+	public:
+		/* io port in, byte. */
+		virtual uint8_t inb(uint16_t port) override {
+			uint8_t out;
+			return m_Port && m_Port->read(port, &out) ? out : 0xff;
+		}
+
+		/* io port out, byte. */
+		virtual void outb(uint16_t port, uint8_t value) override {
+			if (m_Port) {
+				m_Port->write(port, value);
+			}
+		}
+
+		/* io port in, word. */
+		virtual uint16_t inw(uint16_t port) override {
+			uint16_t out;
+			return m_Port && m_Port->read16(port, &out) ? out : 0xffff;
+		}
+
+		/* io port out, word. */
+		virtual void outw(uint16_t port, uint16_t value) override {
+			if (m_Port) {
+				m_Port->write16(port, value);
+			}
+		}
+
+		/* io port in, `count` elements of `width` bytes. */
+		virtual void inBlock(uint16_t port, void* buf, uint32_t count, uint8_t width) override {
+			if (m_Port) {
+				m_Port->readBlock(port, buf, count, width);
+				return;
+			}
+
+			memset(buf, 0xff, count * width);
+		}
+
+		/* io port out, `count` elements of `width` bytes. */
+		virtual void outBlock(uint16_t port, const void* buf, uint32_t count, uint8_t width) override {
+			if (m_Port) {
+				m_Port->writeBlock(port, buf, count, width);
+			}
+		}
+
+		/* read bytes from the memory. */
+		virtual uint32_t read(uint32_t addr, void* buf, uint32_t size) override {
+			return m_Mem ? m_Mem->read(addr, buf, size) : 0;
+		}
+
+		/* write bytes into the memory, invalidating decoded code. */
+		virtual uint32_t write(uint32_t addr, const void* buf, uint32_t size) override {
+			uint32_t ret = m_Mem ? m_Mem->write(addr, buf, size) : 0;
+
+			if (isDecoding() && size) {
+				invalidate(addr, size);
+			}
+
+			return ret;
+		}
+	};
+
+}
+
+#endif // __V86_CPU_I8086T_H__
\ No newline at end of file
@@ -0,0 +1,1425 @@
+#include <algorithm>
+#include <functional>
+#include <stddef.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// --> after the standard headers, the register macros collide with them.
+#include "i8086.h"
+
+namespace v86 {
+#ifdef __V86_JIT__
+	/* host registers. */
+	enum EHOST {
+		HR_RAX = 0, HR_RCX, HR_RDX, HR_RBX, HR_RSP, HR_RBP, HR_RSI, HR_RDI,
+		HR_R8, HR_R9, HR_R10, HR_R11, HR_R12, HR_R13, HR_R14, HR_R15,
+		HR_AH = 4, // --> byte forms without REX.
+	};
+
+	/**
+	 * guest registers held in callee-saved host registers, -1 if kept in `state_t`.
+	 * rbx holds `state_t*`, r10 the effective address and r11 the operand, the rest is scratch.
+	 */
+	static const int8_t HOST_REGS[8] = {
+		HR_R12, HR_R13, HR_R14, HR_R15, // --> AX, CX, DX, BX.
+		-1, -1, HR_RBP, -1 // --> SP, BP, SI, DI.
+	};
+
+	/* frame of the trampoline, above the shadow space of Win64 calls. */
+	enum EFRAME {
+		FRAME_CTX = 32,
+		FRAME_UNTIL = 40,
+		FRAME_LEFT = 48,
+		FRAME_EVENTS = 56,
+		FRAME_CPU = 64,
+		FRAME_PAGES = 72,
+		FRAME_CODEMAP = 80,
+		FRAME_FLAGS = 88, // --> spilled guest flags.
+		FRAME_EA = 96, // --> effective address across helper calls.
+		FRAME_STOPS = 104, // --> events that stop the block. (`IProc::getStops()`)
+		FRAME_SIZE = 120, // --> keeps rsp 16 byte aligned at the calls.
+	};
+
+	/* integer arguments of the helpers. */
+#ifdef _WIN32
+	static const uint8_t HR_ARG0 = HR_RCX, HR_ARG1 = HR_RDX, HR_ARG2 = HR_R8;
+#else
+	static const uint8_t HR_ARG0 = HR_RDI, HR_ARG1 = HR_RSI, HR_ARG2 = HR_RDX;
+#endif
+
+	/* host condition codes, same encoding as the 8086 Jcc. */
+	enum ECOND {
+		CC_B = 0x2, CC_AE = 0x3, CC_Z = 0x4, CC_NZ = 0x5, CC_A = 0x7,
+	};
+
+	/* CF, PF, AF, ZF, SF, OF: computed by the host ALU exactly as the 8086 does. */
+	static constexpr uint32_t STATUS = 0x8d5;
+
+	/* room for a block of MAX_INSNS instructions and its exits. */
+	static constexpr uint32_t BLOCK_ROOM = 64 << 10;
+
+	static constexpr int32_t OFFSET_CYCLES = int32_t(offsetof(state_t, cycles));
+
+	static inline int32_t offsetReg(uint32_t reg) {
+		return int32_t(offsetof(state_t, regs) + reg * sizeof(reg_t));
+	}
+
+	static inline int32_t offsetSeg(uint32_t seg) {
+		return int32_t(offsetof(state_t, segs) + seg * sizeof(reg_t));
+	}
+
+	/* operand of the emitter: host register, [base + index + disp], or immediate. */
+	struct jarg_t {
+		uint8_t kind;
+		uint8_t reg; // --> register, or the base.
+		int8_t index; // --> -1 if none.
+		int32_t disp;
+	};
+
+	enum EJARG {
+		JARG_REG = 0,
+		JARG_MEM,
+	};
+
+	static inline jarg_t argReg(uint8_t reg) {
+		return jarg_t{ JARG_REG, reg, -1, 0 };
+	}
+
+	static inline jarg_t argMem(uint8_t base, int32_t disp, int8_t index = -1) {
+		return jarg_t{ JARG_MEM, base, index, disp };
+	}
+
+	/* where the guest status flags are. */
+	enum EJFLAGS {
+		JFLAGS_STATE = 0, // --> in `state_t::eflags`, exact.
+		JFLAGS_HOST, // --> in host flags, not written back.
+		JFLAGS_SLOT, // --> spilled to the frame, not written back.
+	};
+
+	struct jflags_t {
+		uint8_t loc; // --> EJFLAGS.
+		bool host; // --> host flags hold them. (also after a reload)
+		bool logic; // --> produced by a logical op, AF should be cleared when spilled.
+	};
+
+	/* branch target in the code being emitted. */
+	struct jlabel_t {
+		int32_t pos; // --> -1 until bound.
+		std::vector<uint32_t> sites; // --> rel32 fields to patch.
+	};
+
+	/* x86-64 emitter of a translated block. */
+	class CJitEmitter {
+	private:
+		CJit* m_Jit;
+		jblock_t* m_Block;
+
+		uint8_t* m_Code;
+		uint32_t m_Pos;
+		uint32_t m_End;
+		bool m_Overflow;
+
+		std::deque<jlabel_t> m_Labels;
+		std::vector<std::function<void()>> m_Cold; // --> slow paths and exits, after the block.
+
+		uint8_t m_Used; // --> guest registers loaded into host registers.
+		bool m_Inline; // --> loads walk the page table inline.
+		bool m_InlineStore; // --> stores too, with the code map check.
+		jflags_t m_Flags;
+
+	public:
+		CJitEmitter(CJit* jit, jblock_t* block, uint8_t* code, uint32_t size, bool loads, bool stores)
+			: m_Jit(jit), m_Block(block), m_Code(code), m_Pos(0), m_End(size), m_Overflow(false),
+			  m_Used(0), m_Inline(loads), m_InlineStore(stores)
+		{
+			m_Flags.loc = JFLAGS_STATE;
+			m_Flags.host = false;
+			m_Flags.logic = false;
+		}
+
+	public:
+		inline uint32_t getSize() const { return m_Pos; }
+		inline bool isOverflow() const { return m_Overflow; }
+		inline const uint8_t* at(uint32_t pos) const { return m_Code + pos; }
+
+	public:
+		inline void u8(uint8_t value) {
+			if (m_Pos < m_End) {
+				m_Code[m_Pos] = value;
+			}
+
+			else {
+				m_Overflow = true;
+			}
+
+			m_Pos++;
+		}
+
+		inline void u16(uint16_t value) {
+			u8(uint8_t(value));
+			u8(uint8_t(value >> 8));
+		}
+
+		inline void u32(uint32_t value) {
+			u16(uint16_t(value));
+			u16(uint16_t(value >> 16));
+		}
+
+		inline void u64(uint64_t value) {
+			u32(uint32_t(value));
+			u32(uint32_t(value >> 32));
+		}
+
+		/* REX prefix, omitted if nothing is set. */
+		void rex(bool w, uint8_t reg, const jarg_t& rm) {
+			uint8_t value = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0);
+
+			if (rm.kind == JARG_MEM && rm.index >= 0 && (rm.index & 8)) {
+				value |= 2;
+			}
+
+			if (rm.reg & 8) {
+				value |= 1;
+			}
+
+			if (value != 0x40) {
+				u8(value);
+			}
+		}
+
+		/* ModRM, SIB and displacement. */
+		void modrm(uint8_t reg, const jarg_t& rm) {
+			if (rm.kind == JARG_REG) {
+				u8(0xc0 | ((reg & 7) << 3) | (rm.reg & 7));
+				return;
+			}
+
+			// --> always with a displacement: no special cases of rbp and r13.
+			bool short8 = rm.disp >= -128 && rm.disp <= 127;
+			uint8_t mode = short8 ? 0x40 : 0x80;
+
+			if (rm.index >= 0 || (rm.reg & 7) == HR_RSP) {
+				u8(mode | ((reg & 7) << 3) | 4);
+				u8((((rm.index >= 0 ? uint8_t(rm.index) : uint8_t(HR_RSP)) & 7) << 3) | (rm.reg & 7));
+			}
+
+			else {
+				u8(mode | ((reg & 7) << 3) | (rm.reg & 7));
+			}
+
+			if (short8) {
+				u8(uint8_t(rm.disp));
+			}
+
+			else {
+				u32(uint32_t(rm.disp));
+			}
+		}
+
+		/* [prefix] [REX] opcode ModRM: `reg` is the register or the /digit. */
+		void op(uint8_t prefix, bool w, std::initializer_list<uint8_t> opcode, uint8_t reg, const jarg_t& rm) {
+			if (prefix) {
+				u8(prefix);
+			}
+
+			rex(w, reg, rm);
+			for (uint8_t byte : opcode) {
+				u8(byte);
+			}
+
+			modrm(reg, rm);
+		}
+
+	public:
+		jlabel_t* label() {
+			m_Labels.push_back(jlabel_t{ -1, {} });
+			return &m_Labels.back();
+		}
+
+		void bind(jlabel_t* label) {
+			label->pos = int32_t(m_Pos);
+
+			for (uint32_t site : label->sites) {
+				if (site + 4 <= m_End) {
+					int32_t rel = label->pos - int32_t(site + 4);
+					memcpy(m_Code + site, &rel, sizeof(rel));
+				}
+			}
+
+			label->sites.clear();
+		}
+
+		void rel32(jlabel_t* label) {
+			if (label->pos >= 0) {
+				u32(uint32_t(label->pos - int32_t(m_Pos + 4)));
+				return;
+			}
+
+			label->sites.push_back(m_Pos);
+			u32(0);
+		}
+
+		void rel32(const uint8_t* target) {
+			u32(uint32_t(int32_t(target - (m_Code + m_Pos + 4))));
+		}
+
+		void jcc(uint8_t cond, jlabel_t* label) {
+			u8(0x0f);
+			u8(0x80 | cond);
+			rel32(label);
+		}
+
+		void jmp(jlabel_t* label) {
+			u8(0xe9);
+			rel32(label);
+		}
+
+		/* emit the code later, after the block. */
+		void cold(std::function<void()> code) {
+			m_Cold.push_back(code);
+		}
+
+	public:
+		/* mov r64, imm64. */
+		void movImm64(uint8_t reg, uint64_t value) {
+			u8(0x48 | ((reg & 8) ? 1 : 0));
+			u8(0xb8 | (reg & 7));
+			u64(value);
+		}
+
+		/* mov r32, imm32. */
+		void movImm32(uint8_t reg, uint32_t value) {
+			if (reg & 8) {
+				u8(0x41);
+			}
+
+			u8(0xb8 | (reg & 7));
+			u32(value);
+		}
+
+		/* call the helper, arguments are already set. */
+		void call(const void* helper) {
+			movImm64(HR_RAX, uint64_t(uintptr_t(helper)));
+			u8(0xff);
+			u8(0xd0); // --> call rax.
+		}
+
+		/* the guest register as an operand. */
+		jarg_t guest(uint8_t reg) {
+			int8_t host = HOST_REGS[reg & 7];
+
+			if (host >= 0) {
+				return argReg(uint8_t(host));
+			}
+
+			return argMem(HR_RBX, offsetReg(reg & 7));
+		}
+
+	public:
+		/* write the host flags to the frame. */
+		void spill(jflags_t& fl) {
+			u8(0x9c); // --> pushfq.
+			op(0, false, { 0x8f }, 0, argMem(HR_RSP, FRAME_FLAGS)); // --> pop [rsp + FLAGS], after rsp is restored.
+
+			if (fl.logic) {
+				// --> the 8086 clears AF on logical ops, the host leaves it undefined.
+				op(0, false, { 0x80 }, 4, argMem(HR_RSP, FRAME_FLAGS));
+				u8(0xef);
+				fl.host = false;
+			}
+
+			fl.loc = JFLAGS_SLOT;
+		}
+
+		/* before the code that changes host flags. */
+		void clobber(jflags_t& fl) {
+			if (fl.loc == JFLAGS_HOST) {
+				spill(fl);
+			}
+
+			fl.host = false;
+		}
+
+		/* before the code that reads host flags, clobbers eax and ecx. */
+		void need(jflags_t& fl) {
+			if (fl.host) {
+				return;
+			}
+
+			jarg_t src = fl.loc == JFLAGS_SLOT
+				? argMem(HR_RSP, FRAME_FLAGS)
+				: argMem(HR_RBX, offsetReg(REG_EFLAGS));
+
+			// --> OF: 0x78 + 8 overflows, 0x78 + 0 does not.
+			op(0, false, { 0x8a }, HR_RCX, argMem(src.reg, src.disp + 1)); // --> mov cl, [src + 1].
+			op(0, false, { 0x80 }, 4, argReg(HR_RCX));
+			u8(0x08);
+			op(0, false, { 0x80 }, 0, argReg(HR_RCX));
+			u8(0x78);
+
+			// --> SF, ZF, AF, PF, CF.
+			op(0, false, { 0x8a }, HR_AH, src);
+			u8(0x9e); // --> sahf.
+
+			fl.host = true;
+		}
+
+		/* after the code that sets all status flags. */
+		void produce(jflags_t& fl, bool logic) {
+			fl.loc = JFLAGS_HOST;
+			fl.host = true;
+			fl.logic = logic;
+		}
+
+		/* write the flags back to `state_t::eflags`. */
+		void writeFlags(jflags_t fl) {
+			if (fl.loc == JFLAGS_HOST) {
+				spill(fl);
+			}
+
+			if (fl.loc != JFLAGS_SLOT) {
+				return;
+			}
+
+			op(0, false, { 0x8b }, HR_RAX, argMem(HR_RSP, FRAME_FLAGS));
+			op(0, false, { 0x81 }, 4, argReg(HR_RAX));
+			u32(STATUS);
+			op(0, false, { 0x8b }, HR_RCX, argMem(HR_RBX, offsetReg(REG_EFLAGS)));
+			op(0, false, { 0x81 }, 4, argReg(HR_RCX));
+			u32(~STATUS);
+			op(0, false, { 0x09 }, HR_RAX, argReg(HR_RCX));
+			op(0, false, { 0x89 }, HR_RCX, argMem(HR_RBX, offsetReg(REG_EFLAGS)));
+		}
+
+		/**
+		 * return to the dispatcher at `next`, after `insns` instructions and `cycles` cycles.
+		 * the exit starts as `mov rax, exit; jmp epilogue`, chaining patches the mov to a jump.
+		 */
+		void exit(const jflags_t& fl, bool regs, uint16_t next, uint32_t insns, uint32_t cycles, EJEXIT kind) {
+			writeFlags(fl);
+
+			for (uint8_t reg = 0; regs && reg < 8; ++reg) {
+				if (m_Used & (1 << reg)) {
+					op(0x66, false, { 0x89 }, uint8_t(HOST_REGS[reg]), argMem(HR_RBX, offsetReg(reg)));
+				}
+			}
+
+			if (cycles) {
+				op(0, true, { 0x81 }, 0, argMem(HR_RBX, OFFSET_CYCLES));
+				u32(cycles);
+			}
+
+			if (insns) {
+				op(0, true, { 0x81 }, 5, argMem(HR_RSP, FRAME_LEFT));
+				u32(insns);
+			}
+
+			op(0x66, false, { 0xc7 }, 0, argMem(HR_RBX, offsetReg(REG_EIP)));
+			u16(next);
+
+			m_Jit->m_Exits.push_back(jexit_t());
+			jexit_t* record = &m_Jit->m_Exits.back();
+
+			record->kind = kind;
+			record->key = (m_Block->key & 0xffff0000u) | next;
+			record->site = m_Code + m_Pos;
+			record->owner = m_Block;
+			record->target = nullptr;
+			m_Block->exits.push_back(record);
+
+			movImm64(HR_RAX, uint64_t(uintptr_t(record)));
+			u8(0xe9);
+			rel32(m_Jit->m_Epilogue);
+		}
+
+	public:
+		/* effective address of the ModRM operand, linear, into r10d. */
+		void address(const jinsn_t& insn) {
+			const modrm_t& m = MODRM16[uint8_t((insn.mode << 6) | insn.rm)];
+			uint8_t seg = insn.sov != SEG_MAX ? insn.sov : m.seg;
+
+			if (!m.bmask) {
+				movImm32(HR_R10, insn.disp);
+			}
+
+			else {
+				int8_t hosts[2] = { -1, -1 };
+				static const uint8_t SCRATCH[2] = { HR_RCX, HR_RDX };
+
+				for (uint32_t i = 0; i < 2; ++i) {
+					uint8_t reg = i ? m.index : m.base;
+
+					if (!(i ? m.imask : m.bmask)) {
+						continue;
+					}
+
+					if ((hosts[i] = HOST_REGS[reg]) < 0) {
+						// --> movzx ecx/edx, word [rbx + reg].
+						op(0, false, { 0x0f, 0xb7 }, SCRATCH[i], guest(reg));
+						hosts[i] = SCRATCH[i];
+					}
+				}
+
+				// --> lea r10d, [a + b + disp], then wrap to 16 bits.
+				op(0, false, { 0x8d }, HR_R10, argMem(uint8_t(hosts[0]), insn.mode ? int16_t(insn.disp) : 0, hosts[1]));
+				op(0, false, { 0x0f, 0xb7 }, HR_R10, argReg(HR_R10));
+			}
+
+			// --> + segment * 16.
+			op(0, false, { 0x0f, 0xb7 }, HR_RAX, argMem(HR_RBX, offsetSeg(seg)));
+			op(0, false, { 0xc1 }, 4, argReg(HR_RAX));
+			u8(4);
+			op(0, false, { 0x01 }, HR_RAX, argReg(HR_R10));
+		}
+
+		/* linear address of SS:SP into r10d. */
+		void stackAddress() {
+			op(0, false, { 0x0f, 0xb7 }, HR_R10, guest(REG_ESP));
+			op(0, false, { 0x0f, 0xb7 }, HR_RAX, argMem(HR_RBX, offsetSeg(SEG_SS)));
+			op(0, false, { 0xc1 }, 4, argReg(HR_RAX));
+			u8(4);
+			op(0, false, { 0x01 }, HR_RAX, argReg(HR_R10));
+		}
+
+		/* page of r10d into rdx, the offset in the page into ecx. jumps to `slow` unless the word is in the page. */
+		void page(uint8_t perm, jlabel_t* slow) {
+			op(0, false, { 0x8b }, HR_RDX, argReg(HR_R10));
+			op(0, false, { 0xc1 }, 5, argReg(HR_RDX));
+			u8(CMemoryBus::PAGE_BITS);
+			op(0, false, { 0x81 }, 4, argReg(HR_RDX));
+			u32(CMemoryBus::PAGES - 1);
+			op(0, false, { 0x6b }, HR_RDX, argReg(HR_RDX));
+			u8(sizeof(page_t));
+			op(0, true, { 0x03 }, HR_RDX, argMem(HR_RSP, FRAME_PAGES));
+
+			op(0, false, { 0xf6 }, 0, argMem(HR_RDX, int32_t(offsetof(page_t, perm))));
+			u8(perm);
+			jcc(CC_Z, slow);
+
+			op(0, false, { 0x8b }, HR_RCX, argReg(HR_R10));
+			op(0, false, { 0x81 }, 4, argReg(HR_RCX));
+			u32(CMemoryBus::PAGE_SIZE - 1);
+			op(0, false, { 0x81 }, 7, argReg(HR_RCX));
+			u32(CMemoryBus::PAGE_SIZE - 2);
+			jcc(CC_A, slow);
+		}
+
+		/**
+		 * load the word at r10d into r11d, host flags are clobbered.
+		 * a load that hits a watch leaves before the instruction, which the interpreter runs then.
+		 */
+		void load(const jinsn_t& insn, uint32_t insns, uint32_t cycles) {
+			jlabel_t* slow = label();
+			jlabel_t* done = label();
+
+			if (!m_Inline) {
+				jmp(slow);
+			}
+
+			else {
+				page(PAGE_READ, slow);
+				op(0, true, { 0x03 }, HR_RCX, argMem(HR_RDX, int32_t(offsetof(page_t, host))));
+				op(0, false, { 0x0f, 0xb7 }, HR_R11, argMem(HR_RCX, 0));
+			}
+
+			bind(done);
+
+			jflags_t fl = m_Flags;
+			uint16_t off = insn.off;
+			uint32_t before = cycles - insn.cycles;
+
+			cold([this, slow, done, fl, off, insns, before]() {
+				jlabel_t* watched = label();
+
+				bind(slow);
+				op(0, true, { 0x89 }, HR_R10, argMem(HR_RSP, FRAME_EA));
+				op(0, true, { 0x8b }, HR_ARG0, argMem(HR_RSP, FRAME_CPU));
+				op(0, false, { 0x8b }, HR_ARG1, argReg(HR_R10));
+				call((const void*)&CJit::load16);
+
+				op(0, false, { 0xf7 }, 0, argReg(HR_RAX)); // --> test eax, LOAD_WATCHED.
+				u32(CJit::LOAD_WATCHED);
+				jcc(CC_NZ, watched);
+
+				op(0, false, { 0x0f, 0xb7 }, HR_R11, argReg(HR_RAX));
+				op(0, true, { 0x8b }, HR_R10, argMem(HR_RSP, FRAME_EA));
+				jmp(done);
+
+				// --> nothing of the instruction has been written back yet.
+				bind(watched);
+				exit(fl, true, off, insns - 1, before, JEXIT_FALLBACK);
+			});
+		}
+
+		/**
+		 * store r11w at r10d as the last action of the instruction, host flags are clobbered.
+		 * exits after the instruction if the store hits translated code or raises an event.
+		 */
+		void store(uint16_t next, uint32_t insns, uint32_t cycles) {
+			jlabel_t* slow = label();
+			jlabel_t* done = label();
+
+			if (!m_InlineStore) {
+				jmp(slow);
+			}
+
+			else {
+				page(PAGE_WRITE, slow);
+
+				// --> translated code around: through the helper, which invalidates it.
+				op(0, false, { 0x8b }, HR_RAX, argReg(HR_R10));
+				op(0, false, { 0xc1 }, 5, argReg(HR_RAX));
+				u8(CJit::CODE_BITS);
+				op(0, false, { 0x81 }, 4, argReg(HR_RAX));
+				u32(CJit::CODE_CHUNKS - 1);
+				op(0, true, { 0x8b }, HR_R8, argMem(HR_RSP, FRAME_CODEMAP));
+				op(0, false, { 0x80 }, 7, argMem(HR_R8, 0, HR_RAX));
+				u8(0);
+				jcc(CC_NZ, slow);
+
+				op(0, true, { 0x03 }, HR_RCX, argMem(HR_RDX, int32_t(offsetof(page_t, host))));
+				op(0x66, false, { 0x89 }, HR_R11, argMem(HR_RCX, 0));
+			}
+
+			bind(done);
+
+			jflags_t fl = m_Flags;
+			cold([this, slow, done, fl, next, insns, cycles]() {
+				bind(slow);
+				op(0, true, { 0x8b }, HR_ARG0, argMem(HR_RSP, FRAME_CPU));
+				op(0, false, { 0x8b }, HR_ARG1, argReg(HR_R10));
+				op(0, false, { 0x8b }, HR_ARG2, argReg(HR_R11));
+				call((const void*)&CJit::store16);
+
+				op(0, false, { 0x84 }, HR_RAX, argReg(HR_RAX)); // --> test al, al.
+				jcc(CC_Z, done);
+				exit(fl, true, next, insns, cycles, JEXIT_DIRTY);
+			});
+		}
+
+		/* `dst (op) src` on words, `mr` is the r/m,reg form and `rm` the reg,r/m form. */
+		void binary(uint8_t mr, uint8_t rm, const jarg_t& dst, const jarg_t& src) {
+			if (dst.kind == JARG_MEM && src.kind == JARG_MEM) {
+				op(0, false, { 0x0f, 0xb7 }, HR_R11, src);
+				op(0x66, false, { mr }, HR_R11, dst);
+			}
+
+			else if (src.kind == JARG_REG) {
+				op(0x66, false, { mr }, src.reg, dst);
+			}
+
+			else {
+				op(0x66, false, { rm }, dst.reg, src);
+			}
+		}
+
+		/* ALU op 0 ~ 7 (ADD ~ CMP) of `dst` and the immediate. */
+		void binaryImm(uint8_t aop, const jarg_t& dst, uint16_t imm) {
+			if (int16_t(imm) >= -128 && int16_t(imm) <= 127) {
+				op(0x66, false, { 0x83 }, aop, dst);
+				u8(uint8_t(imm));
+			}
+
+			else {
+				op(0x66, false, { 0x81 }, aop, dst);
+				u16(imm);
+			}
+		}
+
+	public:
+		/* guest registers that the instruction reads or writes. */
+		static uint8_t uses(const jinsn_t& insn) {
+			static const uint8_t BASES[8] = {
+				(1 << REG_EBX) | (1 << REG_ESI), (1 << REG_EBX) | (1 << REG_EDI),
+				(1 << REG_EBP) | (1 << REG_ESI), (1 << REG_EBP) | (1 << REG_EDI),
+				1 << REG_ESI, 1 << REG_EDI, 1 << REG_EBP, 1 << REG_EBX,
+			};
+
+			uint8_t opcode = insn.opcode;
+			uint8_t mask = 0;
+
+			if (opcode >= 0x40 && opcode < 0x60) {
+				mask = uint8_t(1 << (opcode & 7));
+
+				if (opcode >= 0x50) {
+					mask |= 1 << REG_ESP;
+				}
+
+				return mask;
+			}
+
+			if (opcode < 0x40 && (opcode & 7) == 5) {
+				return 1 << REG_EAX;
+			}
+
+			if (opcode >= 0x70 && opcode < 0x80) {
+				return 0;
+			}
+
+			// --> ModRM forms.
+			if (opcode != 0x81 && opcode != 0x83) {
+				mask |= 1 << insn.reg;
+			}
+
+			if (insn.mode == 3) {
+				mask |= 1 << insn.rm;
+			}
+
+			else if (insn.mode != 0 || insn.rm != 6) {
+				mask |= BASES[insn.rm];
+			}
+
+			return mask;
+		}
+
+		/* emit the instruction. `insns` and `cycles` count it. */
+		void emit(const jinsn_t& insn, uint32_t insns, uint32_t cycles) {
+			uint8_t opcode = insn.opcode;
+			uint16_t next = uint16_t(insn.off + insn.length);
+
+			if (opcode < 0x40) {
+				/* 01 ~ 3D: ADD, OR, ADC, SBB, AND, SUB, XOR, CMP. */
+				uint8_t aop = (opcode >> 3) & 7;
+				bool carry = aop == 2 || aop == 3;
+				bool logic = aop == 1 || aop == 4 || aop == 6;
+				uint8_t mr = uint8_t(aop * 8 + 1), rm = uint8_t(aop * 8 + 3);
+
+				if ((opcode & 7) == 5) {
+					if (carry) {
+						need(m_Flags);
+					}
+
+					binaryImm(aop, guest(REG_EAX), insn.imm);
+					produce(m_Flags, logic);
+					return;
+				}
+
+				if (insn.mode == 3) {
+					if (carry) {
+						need(m_Flags);
+					}
+
+					if ((opcode & 7) == 1) {
+						binary(mr, rm, guest(insn.rm), guest(insn.reg));
+					}
+
+					else {
+						binary(mr, rm, guest(insn.reg), guest(insn.rm));
+					}
+
+					produce(m_Flags, logic);
+					return;
+				}
+
+				clobber(m_Flags);
+				address(insn);
+				load(insn, insns, cycles);
+
+				if (carry) {
+					need(m_Flags);
+				}
+
+				if ((opcode & 7) == 1) {
+					binary(mr, rm, argReg(HR_R11), guest(insn.reg));
+					produce(m_Flags, logic);
+
+					if (aop != 7) {
+						clobber(m_Flags);
+						store(next, insns, cycles);
+					}
+				}
+
+				else {
+					binary(mr, rm, guest(insn.reg), argReg(HR_R11));
+					produce(m_Flags, logic);
+				}
+
+				return;
+			}
+
+			if (opcode < 0x50) {
+				/* 40 ~ 4F: INC, DEC keep CF. */
+				need(m_Flags);
+				op(0x66, false, { 0xff }, (opcode & 0x08) ? 1 : 0, guest(opcode & 7));
+				produce(m_Flags, false);
+				return;
+			}
+
+			if (opcode < 0x58) {
+				/* 50 ~ 57: PUSH, the 8086 pushes the decremented SP. */
+				clobber(m_Flags);
+				op(0x66, false, { 0x83 }, 5, guest(REG_ESP));
+				u8(2);
+
+				op(0, false, { 0x0f, 0xb7 }, HR_R11, guest(opcode & 7));
+				stackAddress();
+				store(next, insns, cycles);
+				return;
+			}
+
+			if (opcode < 0x60) {
+				/* 58 ~ 5F: POP, SP is incremented before the register is written. */
+				clobber(m_Flags);
+				stackAddress();
+				load(insn, insns, cycles);
+
+				op(0x66, false, { 0x83 }, 0, guest(REG_ESP));
+				u8(2);
+				op(0x66, false, { 0x89 }, HR_R11, guest(opcode & 7));
+				return;
+			}
+
+			switch (opcode) {
+			case 0x81: case 0x83: { /* GRP1 Ev Iv, Ev Ib */
+				bool carry = insn.reg == 2 || insn.reg == 3;
+				bool logic = insn.reg == 1 || insn.reg == 4 || insn.reg == 6;
+
+				if (insn.mode == 3) {
+					if (carry) {
+						need(m_Flags);
+					}
+
+					binaryImm(insn.reg, guest(insn.rm), insn.imm);
+					produce(m_Flags, logic);
+					break;
+				}
+
+				clobber(m_Flags);
+				address(insn);
+				load(insn, insns, cycles);
+
+				if (carry) {
+					need(m_Flags);
+				}
+
+				binaryImm(insn.reg, argReg(HR_R11), insn.imm);
+				produce(m_Flags, logic);
+
+				if (insn.reg != 7) {
+					clobber(m_Flags);
+					store(next, insns, cycles);
+				}
+				break;
+			}
+
+			case 0x85: /* TEST Gv Ev */
+				if (insn.mode == 3) {
+					binary(0x85, 0x85, guest(insn.rm), guest(insn.reg));
+				}
+
+				else {
+					clobber(m_Flags);
+					address(insn);
+					load(insn, insns, cycles);
+					binary(0x85, 0x85, argReg(HR_R11), guest(insn.reg));
+				}
+
+				produce(m_Flags, true);
+				break;
+
+			case 0x89: /* MOV Ev Gv */
+				if (insn.mode == 3) {
+					binary(0x89, 0x8b, guest(insn.rm), guest(insn.reg));
+					break;
+				}
+
+				clobber(m_Flags);
+				address(insn);
+				op(0, false, { 0x0f, 0xb7 }, HR_R11, guest(insn.reg));
+				store(next, insns, cycles);
+				break;
+
+			case 0x8b: /* MOV Gv Ev */
+				if (insn.mode == 3) {
+					binary(0x89, 0x8b, guest(insn.reg), guest(insn.rm));
+					break;
+				}
+
+				clobber(m_Flags);
+				address(insn);
+				load(insn, insns, cycles);
+				binary(0x89, 0x8b, guest(insn.reg), argReg(HR_R11));
+				break;
+
+			default: { /* 70 ~ 7F: Jcc, ends the block. */
+				need(m_Flags);
+
+				jlabel_t* taken = label();
+				jcc(opcode & 0x0f, taken);
+				exit(m_Flags, true, next, insns, cycles, JEXIT_CHAIN);
+
+				bind(taken);
+				exit(m_Flags, true, insn.imm, insns, cycles, JEXIT_CHAIN);
+				break;
+			}
+			}
+		}
+
+		/* emit the block, returns its entry. `end` tells how the last instruction leaves. */
+		const uint8_t* block(const std::vector<jinsn_t>& insns, EJEXIT end, uint16_t next) {
+			uint32_t total = 0;
+
+			for (const jinsn_t& insn : insns) {
+				m_Used |= uses(insn);
+				total += insn.cycles;
+			}
+
+			// --> guest registers in `state_t` are not loaded.
+			for (uint8_t reg = 0; reg < 8; ++reg) {
+				if (HOST_REGS[reg] < 0) {
+					m_Used &= ~(1 << reg);
+				}
+			}
+
+			/* every instruction would start before `until`, with budget and no events. */
+			jlabel_t* miss = label();
+			uint32_t pre = total - insns.back().cycles;
+
+			op(0, true, { 0x8b }, HR_RAX, argMem(HR_RBX, OFFSET_CYCLES));
+			if (pre) {
+				op(0, true, { 0x81 }, 0, argReg(HR_RAX));
+				u32(pre);
+			}
+
+			op(0, true, { 0x3b }, HR_RAX, argMem(HR_RSP, FRAME_UNTIL));
+			jcc(CC_AE, miss);
+
+			op(0, true, { 0x81 }, 7, argMem(HR_RSP, FRAME_LEFT));
+			u32(uint32_t(insns.size()));
+			jcc(CC_B, miss);
+
+			// --> a masked interrupt request waits.
+			op(0, true, { 0x8b }, HR_RAX, argMem(HR_RSP, FRAME_EVENTS));
+			op(0, false, { 0x8b }, HR_RAX, argMem(HR_RAX, 0));
+			op(0, false, { 0x85 }, HR_RAX, argMem(HR_RSP, FRAME_STOPS));
+			jcc(CC_NZ, miss);
+
+			for (uint8_t reg = 0; reg < 8; ++reg) {
+				if (m_Used & (1 << reg)) {
+					op(0, false, { 0x8b }, uint8_t(HOST_REGS[reg]), argMem(HR_RBX, offsetReg(reg)));
+				}
+			}
+
+			uint32_t count = 0, cycles = 0;
+			for (const jinsn_t& insn : insns) {
+				emit(insn, ++count, cycles += insn.cycles);
+			}
+
+			// --> Jcc has emitted its exits.
+			bool branch = insns.back().opcode >= 0x70 && insns.back().opcode < 0x80;
+			if (!branch) {
+				exit(m_Flags, true, next, count, cycles, end);
+			}
+
+			cold([this, miss]() {
+				jflags_t fl = { JFLAGS_STATE, false, false };
+				bind(miss);
+				exit(fl, false, uint16_t(m_Block->key), 0, 0, JEXIT_MISS);
+			});
+
+			// --> slow paths and exits may add more.
+			for (size_t i = 0; i < m_Cold.size(); ++i) {
+				m_Cold[i]();
+			}
+
+			return m_Overflow ? nullptr : m_Code;
+		}
+	};
+
+	CJit::CJit(Ci8086* cpu)
+		: m_Cpu(cpu), m_Code(nullptr), m_Used(0), m_Base(0), m_Enter(nullptr), m_Epilogue(nullptr),
+		  m_CodeMap(nullptr), m_Flush(false), m_Bus(nullptr)
+	{
+	}
+
+	CJit::~CJit() {
+		reset();
+
+		if (m_Code) {
+#ifdef _WIN32
+			VirtualFree(m_Code, 0, MEM_RELEASE);
+#else
+			munmap(m_Code, CACHE_SIZE);
+#endif
+		}
+
+		delete[] m_CodeMap;
+	}
+
+	CJit* CJit::create(Ci8086* cpu) {
+#ifdef _WIN32
+		void* code = VirtualAlloc(nullptr, CACHE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+		void* code = mmap(nullptr, CACHE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (code == MAP_FAILED) {
+			code = nullptr;
+		}
+#endif
+
+		if (!code) {
+			return nullptr;
+		}
+
+		CJit* jit = new CJit(cpu);
+
+		jit->m_Code = (uint8_t*)code;
+		jit->m_CodeMap = new uint8_t[CODE_CHUNKS];
+		jit->m_Bus = cpu->getBus();
+		memset(jit->m_CodeMap, 0, CODE_CHUNKS);
+
+		jit->emitTrampoline();
+		return jit;
+	}
+
+	void CJit::emitTrampoline() {
+		CJitEmitter e(this, nullptr, m_Code, CACHE_SIZE, false, false);
+
+		/* jexit_t* (jctx_t* ctx, const uint8_t* entry). */
+		static const uint8_t SAVED[6] = { HR_RBX, HR_RBP, HR_R12, HR_R13, HR_R14, HR_R15 };
+
+		for (uint8_t reg : SAVED) {
+			if (reg & 8) {
+				e.u8(0x41);
+			}
+
+			e.u8(0x50 | (reg & 7));
+		}
+
+		e.op(0, true, { 0x83 }, 5, argReg(HR_RSP));
+		e.u8(FRAME_SIZE);
+
+		e.op(0, true, { 0x89 }, HR_ARG0, argMem(HR_RSP, FRAME_CTX));
+		e.op(0, true, { 0x8b }, HR_RBX, argMem(HR_ARG0, int32_t(offsetof(jctx_t, state))));
+
+		static const int32_t FIELDS[7][2] = {
+			{ int32_t(offsetof(jctx_t, until)), FRAME_UNTIL },
+			{ int32_t(offsetof(jctx_t, left)), FRAME_LEFT },
+			{ int32_t(offsetof(jctx_t, events)), FRAME_EVENTS },
+			{ int32_t(offsetof(jctx_t, cpu)), FRAME_CPU },
+			{ int32_t(offsetof(jctx_t, pages)), FRAME_PAGES },
+			{ int32_t(offsetof(jctx_t, codemap)), FRAME_CODEMAP },
+			{ int32_t(offsetof(jctx_t, stops)), FRAME_STOPS },
+		};
+
+		for (const int32_t* field : FIELDS) {
+			e.op(0, true, { 0x8b }, HR_RAX, argMem(HR_ARG0, field[0]));
+			e.op(0, true, { 0x89 }, HR_RAX, argMem(HR_RSP, field[1]));
+		}
+
+		e.op(0, false, { 0xff }, 4, argReg(HR_ARG1)); // --> jmp entry.
+
+		/* the exits jump here with the exit record in rax. */
+		m_Epilogue = m_Code + e.getSize();
+
+		e.op(0, true, { 0x8b }, HR_RCX, argMem(HR_RSP, FRAME_CTX));
+		e.op(0, true, { 0x8b }, HR_RDX, argMem(HR_RSP, FRAME_LEFT));
+		e.op(0, true, { 0x89 }, HR_RDX, argMem(HR_RCX, int32_t(offsetof(jctx_t, left))));
+
+		e.op(0, true, { 0x83 }, 0, argReg(HR_RSP));
+		e.u8(FRAME_SIZE);
+
+		for (int32_t i = 5; i >= 0; --i) {
+			if (SAVED[i] & 8) {
+				e.u8(0x41);
+			}
+
+			e.u8(0x58 | (SAVED[i] & 7));
+		}
+
+		e.u8(0xc3);
+
+		m_Enter = (trampoline_t)(void*)m_Code;
+		m_Base = m_Used = (e.getSize() + 15) & ~15u;
+	}
+
+	bool CJit::decode(uint32_t base, uint16_t off, jinsn_t* insn) const {
+		uint8_t bytes[16];
+
+		if (off > 0xffff - sizeof(bytes)) {
+			return false; // --> IP would wrap.
+		}
+
+		// --> host memory only: reads of MMIO may have side effects. (pages with breakpoints are interpreted)
+		for (uint32_t i = 0; i < sizeof(bytes); ++i) {
+			const uint8_t* host = m_Bus->code(base + off + i);
+
+			if (!host) {
+				return false;
+			}
+
+			bytes[i] = *host;
+		}
+
+		uint32_t pos = 0;
+		uint8_t opcode;
+
+		insn->off = off;
+		insn->sov = SEG_MAX;
+
+		while (true) {
+			if (pos >= 8) {
+				return false;
+			}
+
+			opcode = bytes[pos++];
+
+			if ((opcode & 0xe7) == 0x26) {
+				insn->sov = (opcode - 0x26) >> 3;
+				continue;
+			}
+
+			break;
+		}
+
+		// --> replaced handlers keep their opcodes on the interpreter.
+		if (!m_Cpu->isDefault(opcode)) {
+			return false;
+		}
+
+		bool modrm = false;
+		uint8_t imm = 0; // --> immediate bytes.
+
+		if (opcode < 0x40) {
+			switch (opcode & 7) {
+			case 1: case 3: modrm = true; break;
+			case 5: imm = 2; break;
+			default: return false;
+			}
+		}
+
+		else if (opcode < 0x60) {
+		}
+
+		else if (opcode >= 0x70 && opcode < 0x80) {
+			imm = 1;
+		}
+
+		else {
+			switch (opcode) {
+			case 0x81: modrm = true; imm = 2; break;
+			case 0x83: modrm = true; imm = 1; break;
+			case 0x85: case 0x89: case 0x8b: modrm = true; break;
+			default: return false;
+			}
+		}
+
+		insn->opcode = opcode;
+		insn->cycles = Ci8086::CYCLES[opcode];
+		insn->mode = insn->reg = insn->rm = 0;
+		insn->disp = 0;
+
+		if (modrm) {
+			const modrm_t& m = MODRM16[bytes[pos++]];
+
+			insn->mode = m.mode;
+			insn->reg = m.reg;
+			insn->rm = m.rm;
+
+			if (m.disp == 1) {
+				insn->disp = uint16_t(int8_t(bytes[pos++]));
+			}
+
+			else if (m.disp == 2) {
+				insn->disp = bytes[pos] | (uint16_t(bytes[pos + 1]) << 8);
+				pos += 2;
+			}
+		}
+
+		if (imm == 2) {
+			insn->imm = bytes[pos] | (uint16_t(bytes[pos + 1]) << 8);
+		}
+
+		else if (imm == 1) {
+			insn->imm = uint16_t(int8_t(bytes[pos]));
+		}
+
+		insn->length = uint8_t(pos + imm);
+
+		if (opcode >= 0x70 && opcode < 0x80) {
+			insn->imm = uint16_t(off + insn->length + insn->imm);
+		}
+
+		return true;
+	}
+
+	bool CJit::translate(jblock_t* block) {
+		std::vector<jinsn_t> insns;
+		uint32_t base = (block->key >> 16) << 4;
+		uint16_t off = uint16_t(block->key);
+		EJEXIT end = JEXIT_CHAIN;
+
+		if (!m_Bus) {
+			return false;
+		}
+
+		while (insns.size() < MAX_INSNS) {
+			jinsn_t insn;
+
+			if (!decode(base, off, &insn)) {
+				end = JEXIT_FALLBACK;
+				break;
+			}
+
+			insns.push_back(insn);
+			off = uint16_t(off + insn.length);
+
+			if (insn.opcode >= 0x70 && insn.opcode < 0x80) {
+				break;
+			}
+		}
+
+		if (insns.empty()) {
+			return false;
+		}
+
+		CJitEmitter emitter(this, block, m_Code + m_Used, CACHE_SIZE - m_Used,
+			true, m_Cpu->m_Blocks == nullptr);
+
+		const uint8_t* entry = emitter.block(insns, end, off);
+		if (!entry) {
+			block->exits.clear();
+			return false;
+		}
+
+		block->entry = entry;
+		block->addr = base + uint16_t(block->key);
+		block->size = uint16_t(off - uint16_t(block->key));
+		m_Used = (m_Used + emitter.getSize() + 15) & ~15u;
+
+		mark(block);
+		return true;
+	}
+
+	void CJit::mark(const jblock_t* block) {
+		// --> a word store may start in the chunk before.
+		uint32_t chunk = ((block->addr - 1) & 0xffffff) >> CODE_BITS;
+		uint32_t last = ((block->addr + block->size - 1) & 0xffffff) >> CODE_BITS;
+
+		while (true) {
+			m_CodeMap[chunk] = 1;
+
+			if (chunk == last) {
+				break;
+			}
+
+			chunk = (chunk + 1) & (CODE_CHUNKS - 1);
+		}
+	}
+
+	void CJit::sync() {
+		CMemoryBus* bus = m_Cpu->getBus();
+
+		if (m_Flush || bus != m_Bus) {
+			reset();
+			m_Bus = bus;
+			return;
+		}
+
+		if (!m_Dirty.empty()) {
+			for (size_t i = 0; i < m_Dirty.size(); i += 2) {
+				drop(m_Dirty[i], m_Dirty[i + 1]);
+			}
+
+			m_Dirty.clear();
+		}
+	}
+
+	jblock_t* CJit::find(uint16_t seg, uint16_t off) {
+		uint32_t key = (uint32_t(seg) << 16) | off;
+		jblock_t*& slot = m_Blocks[key];
+
+		if (!slot) {
+			slot = new jblock_t();
+			slot->key = key;
+			slot->addr = (uint32_t(seg) << 4) + off;
+			slot->size = 0;
+			slot->count = 0;
+			slot->failed = false;
+			slot->entry = nullptr;
+		}
+
+		jblock_t* block = slot;
+		if (block->entry) {
+			return block;
+		}
+
+		if (block->failed || ++block->count < THRESHOLD) {
+			return nullptr;
+		}
+
+		// --> full: start over, hot blocks come back soon.
+		if (CACHE_SIZE - m_Used < BLOCK_ROOM) {
+			reset();
+			return nullptr;
+		}
+
+		if (!translate(block)) {
+			block->failed = true;
+			return nullptr;
+		}
+
+		return block;
+	}
+
+	uint32_t CJit::enter(jblock_t* block, uint32_t count, uint64_t until, bool* interpret) {
+		USE_STATE(m_Cpu, state);
+		jctx_t ctx;
+
+		// --> the translated code reads and writes eflags.
+		eflag_sync(state);
+
+		ctx.state = state;
+		ctx.cpu = m_Cpu;
+		ctx.until = until;
+		ctx.left = count;
+		ctx.events = m_Cpu->getEvents();
+		ctx.stops = m_Cpu->getStops(); // --> IF does not change in translated code.
+		ctx.pages = m_Bus ? m_Bus->getPage(0) : nullptr;
+		ctx.codemap = m_CodeMap;
+
+		jexit_t* exit = m_Enter(&ctx, block->entry);
+
+		if (exit->kind == JEXIT_CHAIN) {
+			link(exit);
+		}
+
+		*interpret = exit->kind == JEXIT_FALLBACK || exit->kind == JEXIT_MISS;
+		return count - uint32_t(ctx.left);
+	}
+
+	void CJit::link(jexit_t* exit) {
+		if (exit->target) {
+			return;
+		}
+
+		auto found = m_Blocks.find(exit->key);
+		if (found == m_Blocks.end() || !found->second->entry) {
+			return;
+		}
+
+		jblock_t* target = found->second;
+		int32_t rel = int32_t(target->entry - (exit->site + 5));
+
+		exit->site[0] = 0xe9; // --> jmp entry.
+		memcpy(exit->site + 1, &rel, sizeof(rel));
+
+		exit->target = target;
+		target->incoming.push_back(exit);
+	}
+
+	void CJit::unlink(jexit_t* exit) {
+		exit->site[0] = 0x48; // --> mov rax, exit.
+		exit->site[1] = 0xb8;
+		memcpy(exit->site + 2, &exit, sizeof(exit));
+		exit->target = nullptr;
+	}
+
+	void CJit::drop(uint32_t addr, uint32_t size) {
+		uint32_t end = addr + size;
+		uint32_t first = UINT32_MAX, last = 0;
+
+		for (auto it = m_Blocks.begin(); it != m_Blocks.end(); ) {
+			jblock_t* block = it->second;
+
+			if (!block->entry || block->addr >= end || block->addr + block->size <= addr) {
+				++it;
+				continue;
+			}
+
+			for (jexit_t* exit : block->incoming) {
+				unlink(exit);
+			}
+
+			for (jexit_t* exit : block->exits) {
+				jblock_t* target = exit->target;
+
+				if (target && target != block) {
+					auto& incoming = target->incoming;
+					incoming.erase(std::remove(incoming.begin(), incoming.end(), exit), incoming.end());
+				}
+			}
+
+			block->incoming.clear();
+			first = std::min(first, block->addr - 1);
+			last = std::max(last, block->addr + block->size - 1);
+
+			m_Dead.push_back(block);
+			it = m_Blocks.erase(it);
+		}
+
+		if (first > last) {
+			return;
+		}
+
+		// --> clear the chunks of the dropped blocks, then mark the blocks left there.
+		first >>= CODE_BITS;
+		last >>= CODE_BITS;
+
+		for (uint32_t chunk = first; chunk <= last; ++chunk) {
+			m_CodeMap[chunk & (CODE_CHUNKS - 1)] = 0;
+		}
+
+		// --> a block sharing a chunk keeps it, even if its bytes are apart.
+		for (auto& it : m_Blocks) {
+			jblock_t* block = it.second;
+
+			if (block->entry && ((block->addr - 1) >> CODE_BITS) <= last &&
+				((block->addr + block->size - 1) >> CODE_BITS) >= first)
+			{
+				mark(block);
+			}
+		}
+	}
+
+	void CJit::reset() {
+		for (auto& it : m_Blocks) {
+			delete it.second;
+		}
+
+		for (jblock_t* block : m_Dead) {
+			delete block;
+		}
+
+		m_Blocks.clear();
+		m_Dead.clear();
+		m_Exits.clear();
+		m_Dirty.clear();
+		m_Flush = false;
+		m_Used = m_Base;
+
+		if (m_CodeMap) {
+			memset(m_CodeMap, 0, CODE_CHUNKS);
+		}
+	}
+
+	uint32_t CJit::load16(Ci8086* cpu, uint32_t addr) {
+		if (cpu->isWatched(addr, 2, WATCH_READ)) {
+			return LOAD_WATCHED;
+		}
+
+		return cpu->load16(addr);
+	}
+
+	uint32_t CJit::store16(Ci8086* cpu, uint32_t addr, uint32_t value) {
+		cpu->store16(addr, uint16_t(value));
+		return cpu->m_Jit->isDirty() || cpu->hasStops() ? 1 : 0;
+	}
+#else
+	CJit::CJit(Ci8086* cpu) : m_Cpu(cpu) { }
+	CJit::~CJit() { }
+
+	CJit* CJit::create(Ci8086*) {
+		return nullptr; // --> not an x86-64 host.
+	}
+
+	void CJit::sync() { }
+	jblock_t* CJit::find(uint16_t, uint16_t) { return nullptr; }
+	uint32_t CJit::enter(jblock_t*, uint32_t, uint64_t, bool*) { return 0; }
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,203 @@
+#ifndef __V86_CPU_JIT_H__
+#define __V86_CPU_JIT_H__
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+// --> after the standard headers, the register macros collide with them.
+#include "state.h"
+
+/* the translator emits x86-64 machine code, other hosts stay on the interpreter. */
+#if defined(__x86_64__) || defined(_M_X64)
+#define __V86_JIT__
+#endif
+
+namespace v86 {
+	class Ci8086;
+	class CMemoryBus;
+	struct jblock_t;
+
+	/* how a translated block returned to the dispatcher. */
+	enum EJEXIT {
+		JEXIT_CHAIN = 0,	// --> to a block head, patched to jump there once it is translated.
+		JEXIT_DIRTY,		// --> after a store that hit translated code or raised an event.
+		JEXIT_FALLBACK,		// --> at an instruction that is not translated.
+		JEXIT_MISS,			// --> at the entry, the budget or an event stops it before the first instruction.
+	};
+
+	/* exit of a translated block. */
+	struct jexit_t {
+		uint8_t kind; // --> EJEXIT.
+		uint32_t key; // --> CS:IP of the next instruction.
+		uint8_t* site; // --> `mov rax, exit` that chaining overwrites with a jump.
+		jblock_t* owner;
+		jblock_t* target; // --> chained block.
+	};
+
+	/* decoded instruction. */
+	struct jinsn_t {
+		uint16_t off; // --> IP.
+		uint8_t length; // --> including prefixes.
+		uint8_t opcode;
+		uint8_t sov; // --> overriding segment, SEG_MAX if not overridden.
+		uint8_t cycles;
+
+		/* ModRM. */
+		uint8_t mode;
+		uint8_t reg;
+		uint8_t rm;
+		uint16_t disp;
+
+		uint16_t imm; // --> sign extended immediate, or the target IP of Jcc.
+	};
+
+	/* block head, counted while interpreted and translated when hot. */
+	struct jblock_t {
+		uint32_t key; // --> CS:IP.
+		uint32_t addr; // --> linear address of the first instruction.
+		uint32_t size; // --> translated bytes.
+		uint32_t count; // --> entries counted by the dispatcher.
+		bool failed; // --> the first instruction is not translatable.
+
+		const uint8_t* entry; // --> nullptr until translated.
+		std::vector<jexit_t*> exits;
+		std::vector<jexit_t*> incoming; // --> chained exits of other blocks.
+	};
+
+	/* arguments of the trampoline. */
+	struct jctx_t {
+		state_t* state;
+		Ci8086* cpu;
+		uint64_t until;
+		uint64_t left; // --> instructions left, updated on return.
+		const void* events;
+		const void* pages; // --> page table of the bus, nullptr if the memory is not a bus.
+		const uint8_t* codemap;
+		uint64_t stops; // --> mask of the events.
+	};
+
+	/**
+	 * translates hot real-mode blocks of Ci8086 into x86-64 machine code.
+	 * AX, CX, DX, BX and SI live in callee-saved host registers inside a block,
+	 * guest status flags live in host flags, and exits to translated blocks are chained.
+	 * stores that hit translated code exit to the dispatcher, which drops the blocks.
+	 */
+	class CJit {
+	public:
+		static constexpr uint32_t THRESHOLD = 32; // --> entries before a block is translated.
+		static constexpr uint32_t MAX_INSNS = 64; // --> instructions per block.
+		static constexpr uint32_t CACHE_SIZE = 8 << 20;
+		static constexpr uint32_t CODE_BITS = 8; // --> granularity of the code map, 256 bytes.
+		static constexpr uint32_t CODE_CHUNKS = 1 << (24 - CODE_BITS);
+		static constexpr uint32_t LOAD_WATCHED = 0x10000; // --> `load16()` hit a watch, nothing was read.
+
+	private:
+		typedef jexit_t* (*trampoline_t)(jctx_t* ctx, const uint8_t* entry);
+
+		Ci8086* m_Cpu;
+
+		/* code cache, trampoline first. */
+		uint8_t* m_Code;
+		uint32_t m_Used;
+		uint32_t m_Base; // --> end of the trampoline.
+		trampoline_t m_Enter;
+		const uint8_t* m_Epilogue;
+
+		std::unordered_map<uint32_t, jblock_t*> m_Blocks;
+		std::vector<jblock_t*> m_Dead; // --> invalidated, freed by the next flush.
+		std::deque<jexit_t> m_Exits;
+
+		/* a byte per 256 bytes of guest memory, set if translated code is there. */
+		uint8_t* m_CodeMap;
+
+		/* pending invalidation, applied by `sync()` outside the translated code. */
+		std::vector<uint32_t> m_Dirty; // --> address, size pairs.
+		bool m_Flush;
+
+		CMemoryBus* m_Bus; // --> translated for this bus.
+
+	private:
+		CJit(Ci8086* cpu);
+
+	public:
+		~CJit();
+
+	public:
+		/* create the translator, nullptr if the host can not run it. */
+		static CJit* create(Ci8086* cpu);
+
+		/* test whether the range has translated code, and schedule it to be dropped. */
+		inline bool invalidate(uint32_t addr, uint32_t size) {
+			uint32_t chunk = (addr & 0xffffff) >> CODE_BITS;
+			uint32_t last = ((addr + size - 1) & 0xffffff) >> CODE_BITS;
+
+			while (!m_CodeMap[chunk]) {
+				if (chunk == last) {
+					return false;
+				}
+
+				chunk = (chunk + 1) & (CODE_CHUNKS - 1);
+			}
+
+			m_Dirty.push_back(addr);
+			m_Dirty.push_back(size);
+			return true;
+		}
+
+		/* test whether an invalidation is pending. */
+		inline bool isDirty() const {
+			return m_Flush || !m_Dirty.empty();
+		}
+
+		/* drop all blocks at the next `sync()`. */
+		inline void flush() { m_Flush = true; }
+
+	public:
+		/* apply pending invalidations, before looking blocks up. */
+		void sync();
+
+		/* count the entry of the block at CS:IP, translate it when hot. returns it if translated. */
+		jblock_t* find(uint16_t seg, uint16_t off);
+
+		/**
+		 * run translated code from the block until it exits.
+		 * returns the number of retired instructions, `interpret` is set if the dispatcher
+		 * should interpret the next instruction before looking blocks up again.
+		 */
+		uint32_t enter(jblock_t* block, uint32_t count, uint64_t until, bool* interpret);
+
+	private:
+		/* emit the trampoline at the head of the cache. */
+		void emitTrampoline();
+
+		/* decode the instruction at the linear address, false if it is not translatable. */
+		bool decode(uint32_t base, uint16_t off, jinsn_t* insn) const;
+
+		/* translate the block, false if nothing is translatable. */
+		bool translate(jblock_t* block);
+
+		/* mark the code map for the block. */
+		void mark(const jblock_t* block);
+
+		/* patch the exit to jump to its target if translated. */
+		void link(jexit_t* exit);
+
+		/* restore the exit to return to the dispatcher. */
+		void unlink(jexit_t* exit);
+
+		/* drop the blocks that overlap the range. */
+		void drop(uint32_t addr, uint32_t size);
+
+		/* drop all blocks and the code. */
+		void reset();
+
+	private:
+		/* called by the translated code. */
+		static uint32_t load16(Ci8086* cpu, uint32_t addr);
+		static uint32_t store16(Ci8086* cpu, uint32_t addr, uint32_t value);
+
+		friend class CJitEmitter;
+	};
+}
+
+#endif // __V86_CPU_JIT_H__
\ No newline at end of file
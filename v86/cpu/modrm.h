@@ -0,0 +1,83 @@
+#ifndef __V86_CPU_MODRM_H__
+#define __V86_CPU_MODRM_H__
+#include "reg.h"
+
+namespace v86 {
+	/* decoded ModRM byte, 16-bit addressing. */
+	struct modrm_t {
+		uint8_t mode;
+		uint8_t reg;
+		uint8_t rm;
+		uint8_t disp; // --> displacement bytes: 0, 1 (sign extended) or 2.
+		uint8_t memory; // --> 1 if the operand is in memory, 0 if it is a register.
+		uint8_t seg; // --> default segment, SEG_SS for the BP based forms.
+
+		/* effective address: (base & bmask) + (index & imask) + disp. */
+		uint8_t base;
+		uint8_t index;
+		uint16_t bmask;
+		uint16_t imask;
+	};
+
+	/* decode the ModRM byte. */
+	constexpr modrm_t modrm_decode(uint8_t byte) {
+		/**
+		 * rm	base	index
+		 * 0	BX		SI
+		 * 1	BX		DI
+		 * 2	BP		SI
+		 * 3	BP		DI
+		 * 4	SI		-
+		 * 5	DI		-
+		 * 6	BP		-		(mode 0: DISP16 only)
+		 * 7	BX		-
+		 */
+		constexpr uint8_t BASES[8] = { REG_EBX, REG_EBX, REG_EBP, REG_EBP, REG_ESI, REG_EDI, REG_EBP, REG_EBX };
+		constexpr uint8_t INDEXES[8] = { REG_ESI, REG_EDI, REG_ESI, REG_EDI, REG_EAX, REG_EAX, REG_EAX, REG_EAX };
+
+		modrm_t m = { };
+		m.mode = byte >> 6;
+		m.reg = (byte >> 3) & 7;
+		m.rm = byte & 7;
+		m.memory = m.mode < 3;
+		m.seg = SEG_DS;
+
+		if (!m.memory) {
+			return m;
+		}
+
+		bool direct = m.mode == 0 && m.rm == 6;
+
+		m.disp = m.mode == 1 ? 1 : (m.mode == 2 || direct ? 2 : 0);
+		m.base = BASES[m.rm];
+		m.index = INDEXES[m.rm];
+		m.bmask = direct ? 0 : 0xffff;
+		m.imask = m.rm < 4 ? 0xffff : 0;
+
+		if (!direct && m.base == REG_EBP) {
+			m.seg = SEG_SS;
+		}
+
+		return m;
+	}
+
+	/* ModRM decode table, indexed by the ModRM byte. */
+	struct modrm_table_t {
+		modrm_t entries[256];
+
+		constexpr modrm_table_t() : entries() {
+			for (uint32_t i = 0; i < 256; ++i) {
+				entries[i] = modrm_decode(uint8_t(i));
+			}
+		}
+
+		constexpr const modrm_t& operator[](uint8_t byte) const {
+			return entries[byte];
+		}
+	};
+
+	/* decoded ModRM bytes, built at compile time. */
+	inline constexpr modrm_table_t MODRM16;
+}
+
+#endif // __V86_CPU_MODRM_H__
\ No newline at end of file
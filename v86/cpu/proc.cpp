@@ -1,8 +1,26 @@
 #include "proc.h"
 
 namespace v86 {
-	void IProc::setMemory(IMemory* memory) {
+	namespace {
+		/* test whether the range overlaps the watch, both wrap around the address space as the bus does. */
+		inline bool overlaps(const watch_t& w, uint32_t addr, uint32_t size) {
+			const uint32_t mask = (1u << CMemoryBus::ADDR_BITS) - 1;
+			return ((addr - w.addr) & mask) < w.size || ((w.addr - addr) & mask) < size;
+		}
+	}
+
+	bool IProc::setMemory(IMemory* memory) {
 		if (m_Memory != memory) {
+			if (!onAttach(memory, m_Ports)) {
+				return false;
+			}
+
+			if (m_Bus) {
+				for (const watch_t& w : m_Watches) {
+					m_Bus->setWatch(w.addr, w.size, WATCH_NONE);
+				}
+			}
+
 			if (m_Memory) {
 				m_Memory->drop();
 			}
@@ -10,11 +28,24 @@ namespace v86 {
 			if ((m_Memory = memory) != nullptr) {
 				m_Memory->grab();
 			}
+
+			// --> host pages of the bus are accessed without the virtual interface.
+			m_Bus = dynamic_cast<CMemoryBus*>(memory);
+
+			for (const watch_t& w : m_Watches) {
+				flagWatches(w.addr, w.size);
+			}
 		}
+
+		return true;
 	}
 
-	void IProc::setPort(IPort* port) {
+	bool IProc::setPort(IPort* port) {
 		if (m_Ports != port) {
+			if (!onAttach(m_Memory, port)) {
+				return false;
+			}
+
 			if (m_Ports) {
 				m_Ports->drop();
 			}
@@ -23,12 +54,74 @@ namespace v86 {
 				m_Ports->grab();
 			}
 		}
+
+		return true;
+	}
+
+	bool IProc::watch(uint32_t addr, uint32_t size, uint8_t kind) {
+		kind &= WATCH_RW | WATCH_EXEC;
+
+		if (!m_Bus || !size || size > (1u << CMemoryBus::ADDR_BITS) || !kind) {
+			return false;
+		}
+
+		m_Watches.push_back(watch_t { addr, size, kind });
+		flagWatches(addr, size);
+		return true;
+	}
+
+	bool IProc::unwatch(uint32_t addr, uint32_t size, uint8_t kind) {
+		kind &= WATCH_RW | WATCH_EXEC;
+
+		for (auto it = m_Watches.begin(); it != m_Watches.end(); ++it) {
+			if (it->addr == addr && it->size == size && it->kind == kind) {
+				m_Watches.erase(it);
+				flagWatches(addr, size);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool IProc::findWatch(uint32_t addr, uint32_t size, uint8_t kind) const {
+		for (const watch_t& w : m_Watches) {
+			if ((w.kind & kind) && overlaps(w, addr, size)) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void IProc::flagWatches(uint32_t addr, uint32_t size) {
+		const uint32_t pageSize = CMemoryBus::PAGE_SIZE;
+		uint32_t first = addr & ~(pageSize - 1);
+		uint32_t count = ((addr & (pageSize - 1)) + size - 1) / pageSize + 1;
+
+		if (!m_Bus) {
+			return;
+		}
+
+		// --> the pages are shared by the watches that touch them.
+		for (uint32_t i = 0; i < count && i < CMemoryBus::PAGES; ++i) {
+			uint32_t page = first + i * pageSize;
+			uint8_t kind = WATCH_NONE;
+
+			for (const watch_t& w : m_Watches) {
+				if (overlaps(w, page, pageSize)) {
+					kind |= w.kind;
+				}
+			}
+
+			m_Bus->setWatch(page, pageSize, kind);
+		}
 	}
 
 	uint8_t IProc::inb(uint16_t port) {
-		if (m_Ports) {
-			uint8_t out;
-			m_Ports->read(port, &out);
+		uint8_t out;
+
+		if (m_Ports && m_Ports->read(port, &out)) {
 			return out;
 		}
 
@@ -41,6 +134,37 @@ namespace v86 {
 		}
 	}
 
+	uint16_t IProc::inw(uint16_t port) {
+		uint16_t out;
+
+		if (m_Ports && m_Ports->read16(port, &out)) {
+			return out;
+		}
+
+		return 0xffff;
+	}
+
+	void IProc::outw(uint16_t port, uint16_t value) {
+		if (m_Ports) {
+			m_Ports->write16(port, value);
+		}
+	}
+
+	void IProc::inBlock(uint16_t port, void* buf, uint32_t count, uint8_t width) {
+		if (m_Ports) {
+			m_Ports->readBlock(port, buf, count, width);
+			return;
+		}
+
+		memset(buf, 0xff, count * width);
+	}
+
+	void IProc::outBlock(uint16_t port, const void* buf, uint32_t count, uint8_t width) {
+		if (m_Ports) {
+			m_Ports->writeBlock(port, buf, count, width);
+		}
+	}
+
 	uint32_t IProc::read(uint32_t addr, void* buf, uint32_t size) {
 		if (m_Memory) {
 			return m_Memory->read(addr, buf, size);
@@ -56,4 +180,79 @@ namespace v86 {
 
 		return 0;
 	}
+
+	ESTOP IProc::run(uint64_t maxInstructions, uint64_t maxCycles) {
+		uint64_t until = cyclesUntil(maxCycles);
+		uint64_t limit = runTimers(until);
+		ESTOP reason;
+
+		for (uint64_t n = 0; n < maxInstructions; ++n) {
+			if (m_State.cycles >= limit) {
+				limit = runTimers(until);
+			}
+
+			if (hasEvents() && (reason = takeEvent()) != STOP_NONE) {
+				return reason;
+			}
+
+			if (m_State.cycles >= until) {
+				break;
+			}
+
+			exec();
+		}
+
+		if (hasEvents() && (reason = takeEvent()) != STOP_NONE) {
+			return reason;
+		}
+
+		return STOP_BUDGET;
+	}
+
+	uint64_t IProc::runTimers(uint64_t until) {
+		uint64_t next = m_Timers.getNext();
+
+		while (next <= m_State.cycles || (isHalted() && next < until)) {
+			// --> nothing happens until the next alarm.
+			if (next > m_State.cycles) {
+				m_State.cycles = next;
+			}
+
+			m_Timers.advance(m_State.cycles);
+			next = m_Timers.getNext();
+
+			if (m_Events.load() & ~(1u << STOP_HALT)) {
+				break; // --> e.g. woken by an interrupt request.
+			}
+		}
+
+		return next < until ? next : until;
+	}
+
+	ESTOP IProc::takeEvent() {
+		uint32_t events = m_Events.load();
+
+		if (events & (1u << STOP_REQUESTED)) {
+			m_Events.fetch_and(~(1u << STOP_REQUESTED));
+			return STOP_REQUESTED;
+		}
+
+		if (events & (1u << STOP_BREAKPOINT)) {
+			m_Events.fetch_and(~(1u << STOP_BREAKPOINT));
+			return STOP_BREAKPOINT;
+		}
+
+		// --> the line stays raised until the host lowers it.
+		if ((events & (1u << STOP_IRQ)) && eflag<EFLAG_IT>(&m_State)) {
+			m_Events.fetch_and(~(1u << STOP_HALT));
+			return STOP_IRQ;
+		}
+
+		// --> stays halted until an interrupt.
+		if (events & (1u << STOP_HALT)) {
+			return STOP_HALT;
+		}
+
+		return STOP_NONE;
+	}
 }
\ No newline at end of file
@@ -5,21 +5,59 @@
 
 #include "../dev/port.h"
 #include "../dev/memory.h"
+#include "../dev/bus.h"
+#include "../dev/timer.h"
 #include <string.h>
+#include <atomic>
+#include <vector>
 
 namespace v86 {
+	/* reason why `run()` returned. */
+	enum ESTOP {
+		STOP_NONE = 0,
+		STOP_BUDGET,	// --> instruction or cycle budget exhausted.
+		STOP_HALT,		// --> halted, waiting for an interrupt.
+		STOP_BREAKPOINT,
+		STOP_IRQ,		// --> interrupt request pending and IF set.
+		STOP_REQUESTED,	// --> `requestStop()` called.
+	};
+
+	/* watched range of the memory, or the access that hit one. */
+	struct watch_t {
+		uint32_t addr; // --> linear.
+		uint32_t size;
+		uint8_t kind; // --> EWATCH.
+	};
+
 	class IProc {
 	private:
 		state_t m_State;
 		IMemory* m_Memory;
 		IPort* m_Ports;
 
+		/* set if the memory is a bus, its host pages are accessed directly. */
+		CMemoryBus* m_Bus;
+
+		/* pending events, a bit per ESTOP. */
+		std::atomic<uint32_t> m_Events;
+
+		/* device alarms, keyed by `state_t::cycles` and fired by `run()`. */
+		CTimerWheel m_Timers;
+
+		/* watches, their pages are flagged on the bus. */
+		std::vector<watch_t> m_Watches;
+		watch_t m_Hit; // --> last access that hit one.
+
 	public:
-		IProc() : m_Memory(nullptr), m_Ports(nullptr) {
+		IProc() : m_Memory(nullptr), m_Ports(nullptr), m_Bus(nullptr), m_Events(0) {
 			memset(&m_State, 0, sizeof(m_State));
+			memset(&m_Hit, 0, sizeof(m_Hit));
 		}
 
-		virtual ~IProc() { }
+		virtual ~IProc() {
+			setMemory(nullptr);
+			setPort(nullptr);
+		}
 
 
 	public:
@@ -29,6 +67,8 @@ namespace v86 {
 
 		inline IMemory* getMemory() const { return m_Memory; }
 		inline IPort* getPort() const { return m_Ports; }
+		inline CMemoryBus* getBus() const { return m_Bus; }
+		inline CTimerWheel* getTimers() { return &m_Timers; }
 
 		/* simple definition macros. */
 #define USE_STATE(proc, name)	v86::state_t*	name = (proc)->getState()
@@ -37,16 +77,128 @@ namespace v86 {
 #define USE_MEMORY(proc, name)	v86::IMemory*	name = (proc)->getMemory()
 #define USE_PORT(proc, name)	v86::IPort*		name = (proc)->getPort()
 
-		/* set the memory instance. */
-		void setMemory(IMemory* memory);
+		/* set the memory instance, false if the processor does not take it. */
+		bool setMemory(IMemory* memory);
 
-		/* set the IO port instance. */
-		void setPort(IPort* port);
+		/* set the IO port instance, false if the processor does not take it. */
+		bool setPort(IPort* port);
+
+	protected:
+		/* called before the memory or the IO port instance is replaced, false keeps the previous ones. */
+		virtual bool onAttach(IMemory*, IPort*) { return true; }
 
 	public:
 		/* execute single step. */
 		virtual void exec() = 0;
 
+		/**
+		 * execute instructions until one of the budgets is exhausted or an event stops it.
+		 * pass UINT64_MAX for no limit.
+		 */
+		virtual ESTOP run(uint64_t maxInstructions, uint64_t maxCycles);
+
+	public:
+		/* request the running batch to stop, can be called from other threads. */
+		inline void requestStop() {
+			m_Events.fetch_or(1u << STOP_REQUESTED);
+		}
+
+		/* stop the batch after the current instruction. (e.g. from an opcode handler) */
+		inline void stop(ESTOP reason) {
+			m_Events.fetch_or(1u << reason);
+		}
+
+		/* raise or lower the interrupt request line. */
+		inline void setIrq(bool pending) {
+			if (pending) {
+				m_Events.fetch_or(1u << STOP_IRQ);
+			}
+
+			else {
+				m_Events.fetch_and(~(1u << STOP_IRQ));
+			}
+		}
+
+		/* test whether the processor is halted. */
+		inline bool isHalted() const {
+			return (m_Events.load(std::memory_order_relaxed) & (1u << STOP_HALT)) != 0;
+		}
+
+	public:
+		/**
+		 * stop `run()` with STOP_BREAKPOINT at the accesses (EWATCH) of the processor to the range.
+		 * reads and writes stop after their instruction, WATCH_EXEC before the instruction that starts in the range.
+		 * only the pages of the watches are checked: the memory should be a `CMemoryBus` of this processor alone.
+		 */
+		virtual bool watch(uint32_t addr, uint32_t size, uint8_t kind);
+
+		/* remove the watch with the same arguments. */
+		virtual bool unwatch(uint32_t addr, uint32_t size, uint8_t kind);
+
+		/* get the access that stopped the processor with STOP_BREAKPOINT. */
+		inline const watch_t& getHit() const { return m_Hit; }
+
+		/* test whether the access hits a watch. */
+		inline bool isWatched(uint32_t addr, uint32_t size, uint8_t kind) const {
+			return !m_Watches.empty() && findWatch(addr, size, kind);
+		}
+
+	protected:
+		/* stop after the instruction if the access hits a watch. */
+		inline bool checkWatch(uint32_t addr, uint32_t size, uint8_t kind) {
+			if (isWatched(addr, size, kind)) {
+				m_Hit = watch_t { addr, size, kind };
+				stop(STOP_BREAKPOINT);
+				return true;
+			}
+
+			return false;
+		}
+
+	private:
+		/* find the watch that the access hits. */
+		bool findWatch(uint32_t addr, uint32_t size, uint8_t kind) const;
+
+		/* flag the pages of the range on the bus with the watches that touch them. */
+		void flagWatches(uint32_t addr, uint32_t size);
+
+	protected:
+		/* test whether any event is pending. */
+		inline bool hasEvents() const {
+			return m_Events.load(std::memory_order_relaxed) != 0;
+		}
+
+		/* get the events that stop a batch now, an interrupt request waits for IF. */
+		inline uint32_t getStops() const {
+			return (m_State.eflags & (1u << EFLAG_IT)) ? ~0u : ~(1u << STOP_IRQ);
+		}
+
+		/* test whether a pending event stops the batch, checked by the execution loops. */
+		inline bool hasStops() const {
+			uint32_t events = m_Events.load(std::memory_order_relaxed);
+			return events && (events & getStops()) != 0;
+		}
+
+		/* get the pending events, read by translated code. */
+		inline const std::atomic<uint32_t>* getEvents() const {
+			return &m_Events;
+		}
+
+		/* take the event that stops the batch, STOP_NONE if it can go on. */
+		ESTOP takeEvent();
+
+		/**
+		 * fire the alarms due now, or skip the idle cycles of the halted processor to the next one.
+		 * returns the cycle count that the next batch should stop at. (before `until`)
+		 */
+		uint64_t runTimers(uint64_t until);
+
+		/* absolute cycle count that the budget ends at. */
+		inline uint64_t cyclesUntil(uint64_t maxCycles) const {
+			uint64_t now = m_State.cycles;
+			return maxCycles > UINT64_MAX - now ? UINT64_MAX : now + maxCycles;
+		}
+
 	public:
 		/* io port in, byte. */
 		virtual uint8_t inb(uint16_t port);
@@ -54,12 +206,99 @@ namespace v86 {
 		/* io port out, byte. */
 		virtual void outb(uint16_t port, uint8_t value);
 
+		/* io port in, word. */
+		virtual uint16_t inw(uint16_t port);
+
+		/* io port out, word. */
+		virtual void outw(uint16_t port, uint16_t value);
+
+		/* io port in, `count` elements of `width` bytes. */
+		virtual void inBlock(uint16_t port, void* buf, uint32_t count, uint8_t width);
+
+		/* io port out, `count` elements of `width` bytes. */
+		virtual void outBlock(uint16_t port, const void* buf, uint32_t count, uint8_t width);
+
 		/* read bytes from the memory. */
 		virtual uint32_t read(uint32_t addr, void* buf, uint32_t size);
 
 		/* write bytes into the memory. */
 		virtual uint32_t write(uint32_t addr, const void* buf, uint32_t size);
 
+	public:
+		/* get the host pointer of the range, nullptr if it should be accessed through the device. */
+		inline uint8_t* direct(uint32_t addr, uint32_t size, uint8_t perm) const {
+			if (m_Bus) {
+				return m_Bus->direct(addr, size, perm);
+			}
+
+			return nullptr;
+		}
+
+		/**
+		 * the accessors below reach the memory through `load()` and `store()` of `TProc`:
+		 * a processor bound to its backends at compile time (e.g. `Ci8086T`) skips the virtual `read()` and `write()`.
+		 */
+
+		/* load bytes from the memory, as the processor: watches apply. */
+		inline uint32_t load(uint32_t addr, void* buf, uint32_t size) {
+			checkWatch(addr, size, WATCH_READ);
+			return read(addr, buf, size);
+		}
+
+		/* store bytes into the memory, as the processor: watches apply. */
+		inline uint32_t store(uint32_t addr, const void* buf, uint32_t size) {
+			checkWatch(addr, size, WATCH_WRITE);
+			return write(addr, buf, size);
+		}
+
+		/* load a byte from the memory. */
+		template<class TProc = IProc>
+		inline uint8_t load8(uint32_t addr) {
+			if (uint8_t* host = direct(addr, 1, PAGE_READ)) {
+				return *host;
+			}
+
+			uint8_t value = 0xff;
+			static_cast<TProc*>(this)->load(addr, &value, sizeof(value));
+			return value;
+		}
+
+		/* load a word from the memory. */
+		template<class TProc = IProc>
+		inline uint16_t load16(uint32_t addr) {
+			if (uint8_t* host = direct(addr, 2, PAGE_READ)) {
+				return host[0] | (uint16_t(host[1]) << 8);
+			}
+
+			uint8_t bytes[2] = { 0xff, 0xff };
+			static_cast<TProc*>(this)->load(addr, bytes, sizeof(bytes));
+			return bytes[0] | (uint16_t(bytes[1]) << 8);
+		}
+
+		/* store a byte into the memory. */
+		template<class TProc = IProc>
+		inline void store8(uint32_t addr, uint8_t value) {
+			if (uint8_t* host = direct(addr, 1, PAGE_WRITE)) {
+				*host = value;
+				return;
+			}
+
+			static_cast<TProc*>(this)->store(addr, &value, sizeof(value));
+		}
+
+		/* store a word into the memory. */
+		template<class TProc = IProc>
+		inline void store16(uint32_t addr, uint16_t value) {
+			if (uint8_t* host = direct(addr, 2, PAGE_WRITE)) {
+				host[0] = uint8_t(value);
+				host[1] = uint8_t(value >> 8);
+				return;
+			}
+
+			uint8_t bytes[2] = { uint8_t(value), uint8_t(value >> 8) };
+			static_cast<TProc*>(this)->store(addr, bytes, sizeof(bytes));
+		}
+
 	public:
 		/* fetch a code byte. */
 		virtual uint8_t fetch() = 0;
@@ -0,0 +1,141 @@
+#include "profile.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+namespace v86 {
+	namespace {
+		const char* const GROUP1_NAMES[8] = {
+			"ADD", "OR", "ADC", "SBB", "AND", "SUB", "XOR", "CMP"
+		};
+
+		const char* const MODE_NAMES[4] = {
+			"mem", "mem+disp8", "mem+disp16", "reg"
+		};
+
+		const char* const PREFIX_NAMES[PROFILE_PREFIX_MAX] = {
+			"ES", "CS", "SS", "DS", "REP", "REPNE"
+		};
+
+		typedef std::vector<std::pair<std::string, uint64_t>> rows_t;
+
+		/* non-zero counters, largest first. */
+		rows_t sorted(const uint64_t* counts, uint32_t size, const char* const* names) {
+			rows_t rows;
+			char name[9]; // --> up to 8 hex digits of the index.
+
+			for (uint32_t i = 0; i < size; ++i) {
+				if (!counts[i]) {
+					continue;
+				}
+
+				if (!names) {
+					snprintf(name, sizeof(name), "%02x", i);
+				}
+
+				rows.push_back(std::make_pair(std::string(names ? names[i] : name), counts[i]));
+			}
+
+			std::stable_sort(rows.begin(), rows.end(), [](const rows_t::value_type& a, const rows_t::value_type& b) {
+				return a.second > b.second;
+			});
+
+			return rows;
+		}
+
+		void text(std::string& out, const char* title, const rows_t& rows, uint64_t total) {
+			char line[96];
+
+			out += title;
+			out += ":\n";
+
+			for (const rows_t::value_type& row : rows) {
+				snprintf(line, sizeof(line), "  %-12s %16llu %7.3f%%\n", row.first.c_str(),
+					(unsigned long long)row.second, total ? row.second * 100.0 / total : 0.0);
+
+				out += line;
+			}
+		}
+
+		void json(std::string& out, const char* title, const rows_t& rows, bool last) {
+			char line[96];
+
+			out += "  \"";
+			out += title;
+			out += "\": [";
+
+			for (size_t i = 0; i < rows.size(); ++i) {
+				snprintf(line, sizeof(line), "%s\n    {\"name\": \"%s\", \"count\": %llu}", i ? "," : "",
+					rows[i].first.c_str(), (unsigned long long)rows[i].second);
+
+				out += line;
+			}
+
+			out += rows.empty() ? "]" : "\n  ]";
+			out += last ? "\n" : ",\n";
+		}
+	}
+
+	uint64_t CProfile::getTotal() const {
+		uint64_t total = 0;
+
+		for (uint32_t i = 0; i < 256; ++i) {
+			total += m_Counts.opcodes[i];
+		}
+
+		return total;
+	}
+
+	void CProfile::reset() {
+		memset(&m_Counts, 0, sizeof(m_Counts));
+	}
+
+	void CProfile::merge(const CProfile& other) {
+		const profile_t& from = other.m_Counts;
+
+		for (uint32_t i = 0; i < 256; ++i) {
+			m_Counts.opcodes[i] += from.opcodes[i];
+		}
+
+		for (uint32_t i = 0; i < 8; ++i) {
+			m_Counts.group1[i] += from.group1[i];
+		}
+
+		for (uint32_t i = 0; i < 4; ++i) {
+			m_Counts.modes[i] += from.modes[i];
+		}
+
+		for (uint32_t i = 0; i < PROFILE_PREFIX_MAX; ++i) {
+			m_Counts.prefixes[i] += from.prefixes[i];
+		}
+	}
+
+	std::string CProfile::dump(bool asJson) const {
+		uint64_t total = getTotal();
+		rows_t opcodes = sorted(m_Counts.opcodes, 256, nullptr);
+		rows_t group1 = sorted(m_Counts.group1, 8, GROUP1_NAMES);
+		rows_t modes = sorted(m_Counts.modes, 4, MODE_NAMES);
+		rows_t prefixes = sorted(m_Counts.prefixes, PROFILE_PREFIX_MAX, PREFIX_NAMES);
+		std::string out;
+
+		if (asJson) {
+			out = "{\n  \"total\": " + std::to_string(total) + ",\n";
+			json(out, "opcodes", opcodes, false);
+			json(out, "group1", group1, false);
+			json(out, "modes", modes, false);
+			json(out, "prefixes", prefixes, true);
+			out += "}\n";
+			return out;
+		}
+
+		// --> percentages of the instructions, prefixes can be more than one per instruction.
+		out = "total: " + std::to_string(total) + "\n";
+		text(out, "opcodes", opcodes, total);
+		text(out, "group1", group1, total);
+		text(out, "modes", modes, total);
+		text(out, "prefixes", prefixes, total);
+		return out;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#ifndef __V86_CPU_PROFILE_H__
+#define __V86_CPU_PROFILE_H__
+#include <string>
+
+// --> after the standard headers, the register macros collide with them.
+#include "../types.h"
+
+namespace v86 {
+	/* prefixes, counted once per prefix byte. */
+	enum EPROFILE_PREFIX {
+		PROFILE_ES = 0, // --> segment overrides, in ESEGS order.
+		PROFILE_CS,
+		PROFILE_SS,
+		PROFILE_DS,
+		PROFILE_REP, // --> F3, REP/REPE.
+		PROFILE_REPNE, // --> F2.
+		PROFILE_PREFIX_MAX,
+	};
+
+	/* execution counters of a processor, each table on its own cache lines. */
+	struct alignas(64) profile_t {
+		alignas(64) uint64_t opcodes[256];
+		alignas(64) uint64_t group1[8]; // --> 80 ~ 83, by ModRM's reg field.
+		alignas(64) uint64_t modes[4]; // --> by ModRM's mode field.
+		alignas(64) uint64_t prefixes[PROFILE_PREFIX_MAX];
+	};
+
+	/**
+	 * opcode histogram, filled by a processor built with __V86_PROFILE__.
+	 * written only by the thread that runs the processor, merge when it is not running.
+	 */
+	class CProfile {
+	private:
+		profile_t m_Counts;
+
+	public:
+		CProfile() { reset(); }
+
+	public:
+		inline const profile_t* getCounts() const { return &m_Counts; }
+
+		inline void opcode(uint8_t opcode) { m_Counts.opcodes[opcode]++; }
+		inline void group1(uint8_t reg) { m_Counts.group1[reg & 7]++; }
+		inline void mode(uint8_t mode) { m_Counts.modes[mode & 3]++; }
+		inline void prefix(EPROFILE_PREFIX prefix) { m_Counts.prefixes[prefix]++; }
+
+		/* get the number of counted instructions. */
+		uint64_t getTotal() const;
+
+	public:
+		/* clear all counters. */
+		void reset();
+
+		/* add the counters of other profile. (e.g. of each VM) */
+		void merge(const CProfile& other);
+
+		/* histogram sorted by count, as text or JSON. */
+		std::string dump(bool json = false) const;
+	};
+}
+
+#endif // __V86_CPU_PROFILE_H__
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef __V86_CPU_SOA_H__
+#define __V86_CPU_SOA_H__
+#include "state.h"
+
+namespace v86 {
+	/* segment registers of the 8086, in ESEGS order. */
+	constexpr uint32_t SOA_SEGS = SEG_DS + 1;
+
+	/**
+	 * 16-bit state of `N` processors, structure of arrays: each register is a vector over the lanes.
+	 * holds what the real-mode subset touches, the rest stays in the `state_t` of each lane.
+	 */
+	template<uint32_t N>
+	struct alignas(32) soa_state_t {
+		uint16_t regs[8][N]; // --> EREGS, AX ~ DI.
+		uint16_t segs[SOA_SEGS][N];
+		uint16_t pc[N]; // --> IP.
+		uint16_t fl[N]; // --> FLAGS, always evaluated, no lazy record.
+		uint64_t cycles[N];
+		uint64_t instructions[N];
+	};
+
+	/* copy the lane in from its processor state. */
+	template<uint32_t N>
+	inline void soa_load(soa_state_t<N>* soa, uint32_t lane, state_t* state) {
+		eflag_sync(state);
+
+		for (uint32_t i = 0; i < 8; ++i) {
+			soa->regs[i][lane] = state->regs[i].word[REG_WORD];
+		}
+
+		for (uint32_t i = 0; i < SOA_SEGS; ++i) {
+			soa->segs[i][lane] = state->segs[i].word[REG_WORD];
+		}
+
+		soa->pc[lane] = state->ip;
+		soa->fl[lane] = state->flags;
+		soa->cycles[lane] = state->cycles;
+		soa->instructions[lane] = state->instructions;
+	}
+
+	/* copy the lane back out to its processor state. */
+	template<uint32_t N>
+	inline void soa_store(const soa_state_t<N>* soa, uint32_t lane, state_t* state) {
+		for (uint32_t i = 0; i < 8; ++i) {
+			state->regs[i].word[REG_WORD] = soa->regs[i][lane];
+		}
+
+		for (uint32_t i = 0; i < SOA_SEGS; ++i) {
+			state->segs[i].word[REG_WORD] = soa->segs[i][lane];
+		}
+
+		state->ip = soa->pc[lane];
+		state->flags = soa->fl[lane];
+		state->lazy.op = LAZY_NONE;
+		state->cycles = soa->cycles[lane];
+		state->instructions = soa->instructions[lane];
+	}
+}
+
+#endif // __V86_CPU_SOA_H__
\ No newline at end of file
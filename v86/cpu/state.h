@@ -35,6 +35,28 @@ namespace v86 {
 		reg_t op[2];
 	};
 
+	/* lazy flag operation kinds. */
+	enum ELAZY {
+		LAZY_NONE = 0,	// --> eflags is up to date.
+		LAZY_ADD,		// --> ADD, ADC.
+		LAZY_SUB,		// --> SUB, SBB, CMP.
+		LAZY_LOGIC,		// --> OR, AND, XOR, TEST: CF = OF = AF = 0.
+		LAZY_INC,		// --> INC: CF preserved.
+		LAZY_DEC,		// --> DEC: CF preserved.
+		LAZY_RES,		// --> ZF, SF, PF only: others are kept in eflags.
+	};
+
+	/* lazy flag state. */
+	struct lazy_t {
+		uint8_t op; // --> ELAZY.
+		uint8_t size; // --> operand size in bytes.
+
+		/* operands and the result, not masked to the operand size. */
+		uint32_t dst;
+		uint32_t src;
+		uint32_t res;
+	};
+
 	/* processor state. */
 	struct state_t {
 		reg_t regs[REG_MAX];
@@ -42,20 +64,23 @@ namespace v86 {
 
 		fetch_t fetch;
 		prefix_t prefix; // --> prefix info.
+		lazy_t lazy; // --> last flag producing operation.
+		uint64_t cycles; // --> elapsed clock cycles.
+		uint64_t instructions; // --> retired instructions.
 	};
 
 	/* initial value of eflags. */
 #define EFLAGS_INIT_VALUE	1
 #ifndef __V86_BIG_ENDIAN__
-#define REG_WORD		1
-#define REG_WORD_HI		0
-#define REG_BYTE_LO		3
-#define REG_BYTE_HI		2
-#else
 #define REG_WORD		0
 #define REG_WORD_HI		1
 #define REG_BYTE_LO		0
 #define REG_BYTE_HI		1
+#else
+#define REG_WORD		1
+#define REG_WORD_HI		0
+#define REG_BYTE_LO		3
+#define REG_BYTE_HI		2
 #endif
 
 #define eax regs[REG_EAX].dword
@@ -90,27 +115,137 @@ namespace v86 {
 #define dh regs[REG_EAX].byte[REG_BYTE_HI]
 #define dl regs[REG_EAX].byte[REG_BYTE_LO]
 
-#define ss regs[SEG_SS].dword
-#define cs regs[SEG_CS].dword
-#define ds regs[SEG_DS].dword
-#define es regs[SEG_ES].dword
-#define fs regs[SEG_FS].dword
-#define gs regs[SEG_GS].dword
+#define ss segs[SEG_SS].dword
+#define cs segs[SEG_CS].dword
+#define ds segs[SEG_DS].dword
+#define es segs[SEG_ES].dword
+#define fs segs[SEG_FS].dword
+#define gs segs[SEG_GS].dword
 
 	// --> to remember previous EIP, CS.
 #define p_eip regs[REG_P_EIP].dword
 #define p_ip regs[REG_P_EIP].word[REG_WORD]
-#define p_cs regs[SEG_P_CS].dword
+#define p_cs segs[SEG_P_CS].dword
 
 	// --> to trace starting EIP, CS.
 #define t_eip regs[REG_T_EIP].dword
 #define t_ip regs[REG_T_EIP].word[REG_WORD]
-#define t_cs regs[SEG_T_CS].dword
+#define t_cs segs[SEG_T_CS].dword
+
+	/* flags that can be computed lazily from `lazy_t`. */
+	constexpr bool eflag_lazy_owned(EFLAGS flag) {
+		return flag == EFLAG_CF || flag == EFLAG_PF || flag == EFLAG_AF
+			|| flag == EFLAG_ZF || flag == EFLAG_SF || flag == EFLAG_OF;
+	}
+
+	/* parity flag of the low 8 bits: 1 if even. */
+	inline uint8_t eflag_parity(uint32_t value) {
+		value &= 0xff;
+		value ^= value >> 4;
+		return (0x9669 >> (value & 0x0f)) & 1;
+	}
+
+	/* evaluate a flag from the last flag producing operation. */
+	template<EFLAGS flag>
+	inline uint8_t eflag_eval(const state_t* state) {
+		const lazy_t& lz = state->lazy;
+		const uint32_t bits = lz.size * 8u;
+		const uint32_t sign = 1u << (bits - 1);
+
+		switch (flag) {
+		case EFLAG_ZF: return (lz.res & (0xffffffffu >> (32 - bits))) ? 0 : 1;
+		case EFLAG_SF: return (lz.res & sign) ? 1 : 0;
+		case EFLAG_PF: return eflag_parity(lz.res);
+		default: break;
+		}
+
+		switch (lz.op) {
+		case LAZY_ADD:
+		case LAZY_INC:
+			if (flag == EFLAG_OF) {
+				return ((lz.res ^ lz.dst) & (lz.res ^ lz.src) & sign) ? 1 : 0;
+			}
+			break;
+
+		case LAZY_SUB:
+		case LAZY_DEC:
+			if (flag == EFLAG_OF) {
+				return ((lz.dst ^ lz.src) & (lz.dst ^ lz.res) & sign) ? 1 : 0;
+			}
+			break;
+
+		case LAZY_LOGIC:
+			return 0; // --> CF, OF, AF.
+
+		default: // --> LAZY_RES.
+			return (state->eflags >> flag) & 1;
+		}
+
+		if (flag == EFLAG_AF) {
+			return ((lz.dst ^ lz.src ^ lz.res) & 0x10) ? 1 : 0;
+		}
+
+		/* INC, DEC keep the carry flag. */
+		if (lz.op == LAZY_INC || lz.op == LAZY_DEC) {
+			return state->eflags & 1;
+		}
+
+		// --> ADD, SUB: carry (or borrow) out of the operand size.
+		return (lz.res >> bits) & 1;
+	}
+
+	/* write the lazily evaluated flags back to eflags. */
+	inline void eflag_sync(state_t* state) {
+		if (state->lazy.op == LAZY_NONE) {
+			return;
+		}
+
+		uint32_t value
+			= (uint32_t(eflag_eval<EFLAG_CF>(state)) << EFLAG_CF)
+			| (uint32_t(eflag_eval<EFLAG_PF>(state)) << EFLAG_PF)
+			| (uint32_t(eflag_eval<EFLAG_AF>(state)) << EFLAG_AF)
+			| (uint32_t(eflag_eval<EFLAG_ZF>(state)) << EFLAG_ZF)
+			| (uint32_t(eflag_eval<EFLAG_SF>(state)) << EFLAG_SF)
+			| (uint32_t(eflag_eval<EFLAG_OF>(state)) << EFLAG_OF);
+
+		constexpr uint32_t m
+			= mask<EFLAG_CF>() | mask<EFLAG_PF>() | mask<EFLAG_AF>()
+			| mask<EFLAG_ZF>() | mask<EFLAG_SF>() | mask<EFLAG_OF>();
+
+		state->eflags = (state->eflags & ~m) | value;
+		state->lazy.op = LAZY_NONE;
+	}
+
+	/* record the flag producing operation instead of computing flags. */
+	inline void eflag_lazy(state_t* state, ELAZY op, uint8_t size, uint32_t dst, uint32_t src, uint32_t res) {
+		if (op == LAZY_INC || op == LAZY_DEC) {
+			/* INC, DEC keep the carry flag of the previous operation. */
+			uint32_t cf = state->lazy.op != LAZY_NONE
+				? eflag_eval<EFLAG_CF>(state) : (state->eflags & 1);
+
+			state->eflags = (state->eflags & ~1u) | cf;
+		}
+
+		else if (op == LAZY_RES) {
+			/* CF, OF, AF come from eflags, so they should be written back first. */
+			eflag_sync(state);
+		}
+
+		state->lazy.op = op;
+		state->lazy.size = size;
+		state->lazy.dst = dst;
+		state->lazy.src = src;
+		state->lazy.res = res;
+	}
 
 	template<EFLAGS flag> /* getter */
 	inline uint8_t eflag(state_t* state) {
-		constexpr uint32_t m = mask<flag & 0x7f, (flag & 0x80) ? 2 : 1>();
-		return state->eflags & m;
+		if (eflag_lazy_owned(flag) && state->lazy.op != LAZY_NONE) {
+			return eflag_eval<flag>(state);
+		}
+
+		constexpr uint32_t t = mask<0, (flag & 0x80) ? 2 : 1>();
+		return (state->eflags >> (flag & 0x7f)) & t;
 	}
 
 	template<EFLAGS flag> /* setter */
@@ -118,6 +253,10 @@ namespace v86 {
 		constexpr uint32_t t = mask<0, (flag & 0x80) ? 2 : 1>();
 		constexpr uint32_t m = t << (flag & 0x7f);
 
+		if (eflag_lazy_owned(flag)) {
+			eflag_sync(state);
+		}
+
 		state->eflags &= ~m;
 		state->eflags |= (value & t) << (flag & 0x7f);
 	}
@@ -0,0 +1,22 @@
+#include "trace.h"
+#include <string.h>
+
+namespace v86 {
+	CTrace::CTrace(uint32_t capacity, uint32_t record)
+		: m_Flags(record), m_Head(0), m_Tail(0), m_Waits(0), m_Read(0)
+	{
+		uint32_t size = 64;
+
+		while (size < capacity && size < (1u << 30)) {
+			size <<= 1;
+		}
+
+		m_Slots = new trace_t[size];
+		m_Mask = size - 1;
+		memset(m_Slots, 0, sizeof(trace_t) * size);
+	}
+
+	CTrace::~CTrace() {
+		delete[] m_Slots;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#ifndef __V86_CPU_TRACE_H__
+#define __V86_CPU_TRACE_H__
+#include <atomic>
+#include <thread>
+
+// --> after the standard headers, the register macros collide with them.
+#include "state.h"
+
+namespace v86 {
+	/* what a trace records besides CS:IP and the raw bytes. */
+	enum ETRACE {
+		TRACE_BYTES = 0,
+		TRACE_REGS = 1, // --> registers after each instruction.
+	};
+
+	/* registers of a trace record. */
+	enum ETRACE_REG {
+		TRACE_AX = 0, // --> EREGS order, AX ~ DI.
+		TRACE_ES = 8, // --> ESEGS order, ES ~ DS.
+		TRACE_CS,
+		TRACE_SS,
+		TRACE_DS,
+		TRACE_FLAGS,
+		TRACE_REG_MAX,
+	};
+
+	/* executed instruction. */
+	struct alignas(64) trace_t {
+		uint16_t seg; // --> CS.
+		uint16_t off; // --> IP of the first prefix.
+		uint8_t length; // --> instruction length, `bytes` holds up to 16 of them.
+		uint8_t bytes[16];
+		uint16_t regs[TRACE_REG_MAX]; // --> TRACE_REGS only.
+		lazy_t lazy; // --> pending flags of TRACE_FLAGS, evaluated by the writer.
+	};
+
+	/**
+	 * single producer, single consumer ring of trace records, one for each processor.
+	 * the processor fills it while it runs, a `CTraceWriter` drains it from its thread.
+	 * the producer waits while the ring is full, so no record is ever dropped.
+	 */
+	class CTrace : public IRefCounted {
+	private:
+		trace_t* m_Slots;
+		uint32_t m_Mask;
+		uint32_t m_Flags;
+
+		/* producer side. */
+		alignas(64) std::atomic<uint32_t> m_Head;
+		uint32_t m_Tail; // --> last seen `m_Read`.
+		uint64_t m_Waits;
+
+		/* consumer side. */
+		alignas(64) std::atomic<uint32_t> m_Read;
+
+	public:
+		/* `capacity` is rounded up to a power of two. */
+		CTrace(uint32_t capacity = 65536, uint32_t record = TRACE_REGS);
+		virtual ~CTrace();
+
+	public:
+		inline uint32_t getFlags() const { return m_Flags; }
+		inline uint32_t getCapacity() const { return m_Mask + 1; }
+
+		/* get how many times the producer found the ring full. */
+		inline uint64_t getWaits() const { return m_Waits; }
+
+		/* get the records waiting to be drained. */
+		inline uint32_t getPending() const {
+			return m_Head.load(std::memory_order_acquire) - m_Read.load(std::memory_order_relaxed);
+		}
+
+	public:
+		/* producer: get the next free slot, waiting for the consumer if the ring is full. */
+		inline trace_t* begin() {
+			uint32_t head = m_Head.load(std::memory_order_relaxed);
+
+			if (head - m_Tail > m_Mask) {
+				m_Tail = m_Read.load(std::memory_order_acquire);
+
+				while (head - m_Tail > m_Mask) {
+					m_Waits++;
+					std::this_thread::yield();
+					m_Tail = m_Read.load(std::memory_order_acquire);
+				}
+			}
+
+			return &m_Slots[head & m_Mask];
+		}
+
+		/* producer: publish the slot of `begin()`. */
+		inline void commit() {
+			m_Head.store(m_Head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		/* consumer: get the pending records that are contiguous in the ring, returns the count. */
+		inline uint32_t peek(const trace_t** first) const {
+			uint32_t read = m_Read.load(std::memory_order_relaxed);
+			uint32_t count = m_Head.load(std::memory_order_acquire) - read;
+			uint32_t end = m_Mask + 1 - (read & m_Mask);
+
+			*first = &m_Slots[read & m_Mask];
+			return count < end ? count : end;
+		}
+
+		/* consumer: give the first `count` records of `peek()` back to the producer. */
+		inline void release(uint32_t count) {
+			m_Read.store(m_Read.load(std::memory_order_relaxed) + count, std::memory_order_release);
+		}
+	};
+}
+
+#endif // __V86_CPU_TRACE_H__
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "bus.h"
+#include <string.h>
+
+namespace v86 {
+	CMemoryBus::CMemoryBus() : m_Generation(0) {
+		memset(m_Pages, 0, sizeof(m_Pages));
+	}
+
+	CMemoryBus::~CMemoryBus() {
+		unmap(0, PAGES << PAGE_BITS);
+
+		for (CImage* image : m_Images) {
+			image->drop();
+		}
+	}
+
+	bool CMemoryBus::map(uint32_t addr, uint32_t size, uint8_t* host, uint8_t perm) {
+		if (!host) {
+			return false;
+		}
+
+		if (perm & PAGE_COW) {
+			perm = (perm | PAGE_READ) & ~PAGE_WRITE;
+		}
+
+		return setPages(addr, size, host, nullptr, perm & (PAGE_RW | PAGE_COW));
+	}
+
+	bool CMemoryBus::map(uint32_t addr, CImage* image, uint32_t size) {
+		if (!image || (size = size ? size : image->getSize()) > image->getSize()) {
+			return false;
+		}
+
+		// --> the host pages are only touched on demand.
+		if (!setPages(addr, size, image->getHost(), nullptr, image->isWritable() ? PAGE_RW : PAGE_READ)) {
+			return false;
+		}
+
+		for (CImage* each : m_Images) {
+			if (each == image) {
+				return true;
+			}
+		}
+
+		image->grab();
+		m_Images.push_back(image);
+		return true;
+	}
+
+	bool CMemoryBus::map(uint32_t addr, uint32_t size, IMemory* device) {
+		if (!device || device == this) {
+			return false;
+		}
+
+		return setPages(addr, size, nullptr, device, PAGE_NONE);
+	}
+
+	bool CMemoryBus::unmap(uint32_t addr, uint32_t size) {
+		return setPages(addr, size, nullptr, nullptr, PAGE_NONE);
+	}
+
+	bool CMemoryBus::setPages(uint32_t addr, uint32_t size, uint8_t* host, IMemory* device, uint8_t perm) {
+		if ((addr & (PAGE_SIZE - 1)) != 0 || !size) {
+			return false;
+		}
+
+		uint32_t first = addr >> PAGE_BITS;
+		uint32_t count = (size + PAGE_SIZE - 1) >> PAGE_BITS;
+
+		if (first >= PAGES || count > PAGES - first) {
+			return false;
+		}
+
+		m_Generation++;
+		for (uint32_t i = 0; i < count; ++i) {
+			page_t& page = m_Pages[first + i];
+
+			if (device) {
+				device->grab();
+			}
+
+			if (page.device) {
+				page.device->drop();
+			}
+
+			page.host = host ? host + (i << PAGE_BITS) : nullptr;
+			page.device = device;
+			page.access = perm;
+			page.perm = perm & ~(page.watch & WATCH_RW);
+		}
+
+		return true;
+	}
+
+	bool CMemoryBus::setWatch(uint32_t addr, uint32_t size, uint8_t watch) {
+		if (!size || size > (1u << ADDR_BITS)) {
+			return false;
+		}
+
+		uint32_t first = (addr >> PAGE_BITS) & (PAGES - 1);
+		uint32_t count = (((addr & (PAGE_SIZE - 1)) + size - 1) >> PAGE_BITS) + 1;
+
+		if (count > PAGES) {
+			count = PAGES;
+		}
+
+		// --> host pointers taken before are stale. (e.g. the prefetch window)
+		m_Generation++;
+		for (uint32_t i = 0; i < count; ++i) {
+			page_t& page = m_Pages[(first + i) & (PAGES - 1)];
+
+			page.watch = watch & (WATCH_RW | WATCH_EXEC);
+			page.perm = page.access & ~(page.watch & WATCH_RW);
+		}
+
+		return true;
+	}
+
+	uint32_t CMemoryBus::read(uint32_t addr, void* buf, uint32_t size) {
+		uint8_t* out = (uint8_t*)buf;
+		uint32_t done = 0;
+
+		while (done < size) {
+			const page_t* page = getPage(addr);
+			uint32_t offset = addr & (PAGE_SIZE - 1);
+			uint32_t len = PAGE_SIZE - offset;
+
+			if (len > size - done) {
+				len = size - done;
+			}
+
+			if (page->access & PAGE_READ) {
+				memcpy(out + done, page->host + offset, len);
+			}
+
+			else if (page->device) {
+				page->device->read(addr, out + done, len);
+			}
+
+			else {
+				// --> open bus.
+				memset(out + done, 0xff, len);
+			}
+
+			addr = (addr + len) & ((1 << ADDR_BITS) - 1);
+			done += len;
+		}
+
+		return done;
+	}
+
+	uint32_t CMemoryBus::write(uint32_t addr, const void* buf, uint32_t size) {
+		const uint8_t* in = (const uint8_t*)buf;
+		uint32_t done = 0;
+
+		while (done < size) {
+			const page_t* page = getPage(addr);
+			uint32_t offset = addr & (PAGE_SIZE - 1);
+			uint32_t len = PAGE_SIZE - offset;
+
+			if (len > size - done) {
+				len = size - done;
+			}
+
+			if (page->access & PAGE_WRITE) {
+				memcpy(page->host + offset, in + done, len);
+			}
+
+			else if (page->device) {
+				page->device->write(addr, in + done, len);
+			}
+
+			else if ((page->access & PAGE_COW) && onWriteFault(addr)) {
+				continue; // --> retry on the private page.
+			}
+
+			addr = (addr + len) & ((1 << ADDR_BITS) - 1);
+			done += len;
+		}
+
+		return done;
+	}
+
+	bool CMemoryBus::onWriteFault(uint32_t) {
+		return false;
+	}
+}
\ No newline at end of file
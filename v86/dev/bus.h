@@ -0,0 +1,128 @@
+#ifndef __V86_DEV_BUS_H__
+#define __V86_DEV_BUS_H__
+#include "memory.h"
+#include "image.h"
+#include <vector>
+
+namespace v86 {
+	enum EPAGE {
+		PAGE_NONE = 0,
+		PAGE_READ = 1,
+		PAGE_WRITE = 2,
+		PAGE_RW = PAGE_READ | PAGE_WRITE,
+		PAGE_COW = 4, // --> shared, the first write calls `onWriteFault()`.
+	};
+
+	/* accesses that a watch stops at. */
+	enum EWATCH {
+		WATCH_NONE = 0,
+		WATCH_READ = PAGE_READ, // --> data reads.
+		WATCH_WRITE = PAGE_WRITE, // --> data writes.
+		WATCH_RW = WATCH_READ | WATCH_WRITE,
+		WATCH_EXEC = 4, // --> instruction starts. (breakpoints)
+	};
+
+	/* page table entry. */
+	struct page_t {
+		uint8_t* host; // --> host pointer to the first byte of the page.
+		IMemory* device; // --> handler, if the page is not backed by host memory.
+		uint8_t perm; // --> EPAGE, direct accesses to host memory: `access` without the watched ones.
+		uint8_t access; // --> EPAGE of the mapping.
+		uint8_t watch; // --> EWATCH, accesses to the page that are checked.
+	};
+
+	/* memory bus that dispatches accesses by 4 KiB pages over the 24-bit space. */
+	class CMemoryBus : public IMemory {
+	public:
+		static constexpr uint32_t ADDR_BITS = 24;
+		static constexpr uint32_t PAGE_BITS = 12;
+		static constexpr uint32_t PAGE_SIZE = 1 << PAGE_BITS;
+		static constexpr uint32_t PAGES = 1 << (ADDR_BITS - PAGE_BITS);
+
+	private:
+		page_t m_Pages[PAGES];
+		uint32_t m_Generation; // --> bumped whenever the table changes.
+		std::vector<CImage*> m_Images; // --> kept until the bus is destroyed.
+
+	public:
+		CMemoryBus();
+		virtual ~CMemoryBus();
+
+	public:
+		/* get the generation of the page table, host pointers taken before a change are stale. */
+		inline uint32_t getGeneration() const { return m_Generation; }
+
+		/* get the page that holds the address. */
+		inline const page_t* getPage(uint32_t addr) const {
+			return &m_Pages[(addr >> PAGE_BITS) & (PAGES - 1)];
+		}
+
+		/* get the host pointer of the range, nullptr if it crosses the page or needs the handler. */
+		inline uint8_t* direct(uint32_t addr, uint32_t size, uint8_t perm) const {
+			const page_t* page = getPage(addr);
+			uint32_t offset = addr & (PAGE_SIZE - 1);
+
+			if ((page->perm & perm) && offset + size <= PAGE_SIZE) {
+				return page->host + offset;
+			}
+
+			return nullptr;
+		}
+
+		/* get the host pointer of the code, nullptr if it needs the handler or the page has breakpoints. */
+		inline const uint8_t* code(uint32_t addr) const {
+			const page_t* page = getPage(addr);
+
+			if ((page->access & PAGE_READ) && !(page->watch & WATCH_EXEC)) {
+				return page->host + (addr & (PAGE_SIZE - 1));
+			}
+
+			return nullptr;
+		}
+
+	public:
+		/**
+		 * map host memory to the page aligned range.
+		 * `host` points the byte at `addr` and must cover the size rounded up to pages.
+		 * reads from pages without PAGE_READ return 0xff, writes without PAGE_WRITE are dropped.
+		 * PAGE_COW pages are read directly, writes go to `onWriteFault()` first.
+		 */
+		bool map(uint32_t addr, uint32_t size, uint8_t* host, uint8_t perm);
+
+		/**
+		 * map the image to the page aligned address, guest pages are the image pages.
+		 * ROM images are mapped read only. `size` zero for the whole image.
+		 */
+		bool map(uint32_t addr, CImage* image, uint32_t size = 0);
+
+		/* route the page aligned range to the device. (the device sees linear addresses) */
+		bool map(uint32_t addr, uint32_t size, IMemory* device);
+
+		/* unmap the page aligned range. */
+		bool unmap(uint32_t addr, uint32_t size);
+
+		/**
+		 * set the watched accesses (EWATCH) of the pages that the range touches, replacing their previous ones.
+		 * watched reads and writes leave `direct()` for `read()` and `write()`, pages with WATCH_EXEC are not `code()`.
+		 * the watches are kept when the pages are mapped again.
+		 */
+		bool setWatch(uint32_t addr, uint32_t size, uint8_t watch);
+
+	private:
+		/* replace the entries of the range. */
+		bool setPages(uint32_t addr, uint32_t size, uint8_t* host, IMemory* device, uint8_t perm);
+
+	protected:
+		/* called on a write to the PAGE_COW page, returns true if the page has been remapped writable. */
+		virtual bool onWriteFault(uint32_t addr);
+
+	public:
+		/* read memory to the buffer. (final: a bound `Ci8086T` calls it directly, subclasses hook `onWriteFault()`) */
+		virtual uint32_t read(uint32_t addr, void* buf, uint32_t size) override final;
+
+		/* write memory from the buffer. */
+		virtual uint32_t write(uint32_t addr, const void* buf, uint32_t size) override final;
+	};
+}
+
+#endif // __V86_DEV_BUS_H__
@@ -0,0 +1,37 @@
+#include "cow.h"
+#include <string.h>
+
+namespace v86 {
+	CCowMemory::CCowMemory(IRefCounted* backing) : m_Backing(backing) {
+		if (m_Backing) {
+			m_Backing->grab();
+		}
+	}
+
+	CCowMemory::~CCowMemory() {
+		unmap(0, PAGES << PAGE_BITS);
+
+		for (uint8_t* copy : m_Copies) {
+			delete[] copy;
+		}
+
+		if (m_Backing) {
+			m_Backing->drop();
+		}
+	}
+
+	bool CCowMemory::share(uint32_t addr, uint32_t size, uint8_t* host, bool rom) {
+		return map(addr, size, host, rom ? PAGE_READ : PAGE_COW);
+	}
+
+	bool CCowMemory::onWriteFault(uint32_t addr) {
+		const page_t* page = getPage(addr);
+		uint8_t* copy = new uint8_t[PAGE_SIZE];
+
+		memcpy(copy, page->host, PAGE_SIZE);
+		m_Copies.push_back(copy);
+
+		// --> bumps the generation, stale host pointers are dropped by the processor.
+		return map(addr & ~(PAGE_SIZE - 1), PAGE_SIZE, copy, PAGE_RW);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef __V86_DEV_COW_H__
+#define __V86_DEV_COW_H__
+#include "bus.h"
+#include <vector>
+
+namespace v86 {
+	/* memory bus over shared pages, RAM pages are copied on the first write. */
+	class CCowMemory : public CMemoryBus {
+	private:
+		IRefCounted* m_Backing; // --> keeps the shared pages alive.
+		std::vector<uint8_t*> m_Copies;
+
+	public:
+		CCowMemory(IRefCounted* backing = nullptr);
+		virtual ~CCowMemory();
+
+	public:
+		/* get the number of pages copied so far. */
+		inline uint32_t getCopies() const { return uint32_t(m_Copies.size()); }
+
+		/* share the page aligned range, ROM is never copied and drops writes. */
+		bool share(uint32_t addr, uint32_t size, uint8_t* host, bool rom);
+
+	protected:
+		virtual bool onWriteFault(uint32_t addr) override;
+	};
+}
+
+#endif // __V86_DEV_COW_H__
\ No newline at end of file
@@ -7,6 +7,7 @@ namespace v86 {
 		EDEV_UNKNOWN = 0,
 		EDEV_MEMORY,
 		EDEV_IOPORT,
+		EDEV_DISK,
 	};
 
 	/* device interface. */
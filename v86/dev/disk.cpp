@@ -0,0 +1,38 @@
+#include "disk.h"
+#include <string.h>
+
+namespace v86 {
+	CDiskImage::CDiskImage(CImage* image) : IDevice(TYPE), m_Image(image) {
+		m_Image->grab();
+	}
+
+	CDiskImage::~CDiskImage() {
+		m_Image->drop();
+	}
+
+	uint32_t CDiskImage::read(uint32_t lba, void* buf, uint32_t count) {
+		if (lba >= getSectors()) {
+			return 0;
+		}
+
+		if (count > getSectors() - lba) {
+			count = getSectors() - lba;
+		}
+
+		memcpy(buf, direct(lba, count), count * SECTOR_SIZE);
+		return count;
+	}
+
+	uint32_t CDiskImage::write(uint32_t lba, const void* buf, uint32_t count) {
+		if (!isWritable() || lba >= getSectors()) {
+			return 0;
+		}
+
+		if (count > getSectors() - lba) {
+			count = getSectors() - lba;
+		}
+
+		memcpy(direct(lba, count), buf, count * SECTOR_SIZE);
+		return count;
+	}
+}
\ No newline at end of file
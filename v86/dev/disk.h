@@ -0,0 +1,45 @@
+#ifndef __V86_DEV_DISK_H__
+#define __V86_DEV_DISK_H__
+#include "device.h"
+#include "image.h"
+
+namespace v86 {
+	/* block device over a mapped image, 512 byte sectors. */
+	class CDiskImage : public IDevice {
+	public:
+		static constexpr EDEV TYPE = EDEV_DISK;
+		static constexpr uint32_t SECTOR_SIZE = 512;
+
+	private:
+		CImage* m_Image;
+
+	public:
+		CDiskImage(CImage* image);
+		virtual ~CDiskImage();
+
+	public:
+		inline CImage* getImage() const { return m_Image; }
+		inline bool isWritable() const { return m_Image->isWritable(); }
+
+		/* get the number of whole sectors. */
+		inline uint32_t getSectors() const { return m_Image->getSize() / SECTOR_SIZE; }
+
+		/* get the host pointer of the sectors without copying, nullptr if out of range. */
+		inline uint8_t* direct(uint32_t lba, uint32_t count) const {
+			if (lba > getSectors() || count > getSectors() - lba) {
+				return nullptr;
+			}
+
+			return m_Image->getHost() + lba * SECTOR_SIZE;
+		}
+
+	public:
+		/* read sectors to the buffer, returns the sectors read. */
+		uint32_t read(uint32_t lba, void* buf, uint32_t count);
+
+		/* write sectors from the buffer, returns the sectors written. */
+		uint32_t write(uint32_t lba, const void* buf, uint32_t count);
+	};
+}
+
+#endif // __V86_DEV_DISK_H__
\ No newline at end of file
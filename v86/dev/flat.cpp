@@ -0,0 +1,30 @@
+#include "flat.h"
+#include <string.h>
+
+namespace v86 {
+	CFlatMemory::CFlatMemory(uint32_t size) {
+		// --> whole pages, so the last one can be mapped directly.
+		m_Size = (size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+		m_Host = new uint8_t[m_Size];
+
+		memset(m_Host, 0, m_Size);
+		map(0, m_Size, m_Host, PAGE_RW);
+	}
+
+	CFlatMemory::~CFlatMemory() {
+		unmap(0, m_Size);
+		delete[] m_Host;
+	}
+
+	bool CFlatMemory::setMmio(uint32_t addr, uint32_t size, IMemory* device) {
+		if (addr >= m_Size || size > m_Size - addr) {
+			return false;
+		}
+
+		if (device) {
+			return map(addr, size, device);
+		}
+
+		return map(addr, size, m_Host + addr, PAGE_RW);
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef __V86_DEV_FLAT_H__
+#define __V86_DEV_FLAT_H__
+#include "bus.h"
+
+namespace v86 {
+	/* contiguous host buffer, 1 MiB plus the HMA by default. */
+	class CFlatMemory : public CMemoryBus {
+	public:
+		static constexpr uint32_t SIZE = 0x110000;
+
+	private:
+		uint8_t* m_Host;
+		uint32_t m_Size;
+
+	public:
+		CFlatMemory(uint32_t size = SIZE);
+		virtual ~CFlatMemory();
+
+	public:
+		/* get the host buffer. */
+		inline uint8_t* getHost() const { return m_Host; }
+
+		/* get the size of the host buffer. */
+		inline uint32_t getSize() const { return m_Size; }
+
+		/* route the page aligned range to the device, nullptr to restore RAM. */
+		bool setMmio(uint32_t addr, uint32_t size, IMemory* device);
+	};
+}
+
+#endif // __V86_DEV_FLAT_H__
@@ -0,0 +1,178 @@
+#include "image.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace v86 {
+#ifdef _WIN32
+	CImage::CImage() : m_Host(nullptr), m_Size(0), m_Mode(IMAGE_ROM),
+		m_File(INVALID_HANDLE_VALUE), m_Mapping(nullptr) { }
+
+	CImage::~CImage() {
+		// --> extended private images are a copy of the file, not a view.
+		if (m_Host && m_Mapping) {
+			UnmapViewOfFile(m_Host);
+		}
+
+		else if (m_Host) {
+			VirtualFree(m_Host, 0, MEM_RELEASE);
+		}
+
+		if (m_Mapping) {
+			CloseHandle(m_Mapping);
+		}
+
+		if (m_File != INVALID_HANDLE_VALUE) {
+			CloseHandle(m_File);
+		}
+	}
+
+	CImage* CImage::open(const char* path, EIMAGE mode, uint32_t size) {
+		CImage* image = new CImage();
+		bool shared = mode == IMAGE_SHARED;
+		LARGE_INTEGER length;
+
+		image->m_Mode = mode;
+		image->m_File = CreateFileA(path, shared ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+			FILE_SHARE_READ, nullptr, shared ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (image->m_File == INVALID_HANDLE_VALUE || !GetFileSizeEx(image->m_File, &length)
+			|| length.QuadPart > UINT32_MAX)
+		{
+			image->drop();
+			return nullptr;
+		}
+
+		// --> the mapping of a shared image extends the file.
+		image->m_Size = uint32_t(length.QuadPart);
+		if (shared && size > image->m_Size) {
+			image->m_Size = size;
+		}
+
+		// --> a view can not be larger than the file: private images past its end are read into zeroed memory.
+		else if (mode == IMAGE_PRIVATE && size > image->m_Size) {
+			uint32_t done = 0;
+
+			image->m_Host = (uint8_t*)VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+			if (!image->m_Host) {
+				image->drop();
+				return nullptr;
+			}
+
+			while (done < image->m_Size) {
+				DWORD read = 0;
+
+				if (!ReadFile(image->m_File, image->m_Host + done, image->m_Size - done, &read, nullptr) || !read) {
+					image->drop();
+					return nullptr;
+				}
+
+				done += read;
+			}
+
+			image->m_Size = size;
+			return image;
+		}
+
+		DWORD protect = mode == IMAGE_ROM ? PAGE_READONLY
+			: (shared ? PAGE_READWRITE : PAGE_WRITECOPY);
+
+		DWORD access = mode == IMAGE_ROM ? FILE_MAP_READ
+			: (shared ? FILE_MAP_WRITE : FILE_MAP_COPY);
+
+		if (!image->m_Size
+			|| !(image->m_Mapping = CreateFileMappingA(image->m_File, nullptr, protect,
+				0, shared ? image->m_Size : 0, nullptr))
+			|| !(image->m_Host = (uint8_t*)MapViewOfFile(image->m_Mapping, access, 0, 0, image->m_Size)))
+		{
+			image->drop();
+			return nullptr;
+		}
+
+		return image;
+	}
+
+	bool CImage::sync() {
+		return m_Mode != IMAGE_SHARED || FlushViewOfFile(m_Host, m_Size) != FALSE;
+	}
+#else
+	CImage::CImage() : m_Host(nullptr), m_Size(0), m_Mode(IMAGE_ROM), m_File(-1) { }
+
+	CImage::~CImage() {
+		if (m_Host) {
+			munmap(m_Host, m_Size);
+		}
+
+		if (m_File >= 0) {
+			close(m_File);
+		}
+	}
+
+	CImage* CImage::open(const char* path, EIMAGE mode, uint32_t size) {
+		CImage* image = new CImage();
+		bool shared = mode == IMAGE_SHARED;
+		struct stat info;
+
+		image->m_Mode = mode;
+		image->m_File = ::open(path, shared ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+
+		if (image->m_File < 0 || fstat(image->m_File, &info) != 0 || uint64_t(info.st_size) > UINT32_MAX) {
+			image->drop();
+			return nullptr;
+		}
+
+		uint32_t length = uint32_t(info.st_size);
+		int prot = mode == IMAGE_ROM ? PROT_READ : PROT_READ | PROT_WRITE;
+
+		image->m_Size = length;
+		if (mode != IMAGE_ROM && size > length) {
+			if (shared) {
+				if (ftruncate(image->m_File, size) != 0) {
+					image->drop();
+					return nullptr;
+				}
+
+				length = size;
+			}
+
+			image->m_Size = size;
+		}
+
+		void* host = MAP_FAILED;
+		if (length < image->m_Size) {
+			// --> pages past the end of a private image are anonymous zero pages.
+			host = mmap(nullptr, image->m_Size, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+			if (host != MAP_FAILED && length
+				&& mmap(host, length, prot, MAP_PRIVATE | MAP_FIXED, image->m_File, 0) == MAP_FAILED)
+			{
+				munmap(host, image->m_Size);
+				host = MAP_FAILED;
+			}
+		}
+
+		else if (length) {
+			host = mmap(nullptr, length, prot, shared ? MAP_SHARED : MAP_PRIVATE, image->m_File, 0);
+		}
+
+		if (host == MAP_FAILED) {
+			image->drop();
+			return nullptr;
+		}
+
+		image->m_Host = (uint8_t*)host;
+		return image;
+	}
+
+	bool CImage::sync() {
+		return m_Mode != IMAGE_SHARED || msync(m_Host, m_Size, MS_SYNC) == 0;
+	}
+#endif
+}
\ No newline at end of file
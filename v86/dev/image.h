@@ -0,0 +1,50 @@
+#ifndef __V86_DEV_IMAGE_H__
+#define __V86_DEV_IMAGE_H__
+#include "../types.h"
+
+namespace v86 {
+	enum EIMAGE {
+		IMAGE_ROM = 0, // --> read only, private.
+		IMAGE_PRIVATE, // --> writable, changes are discarded. (copy-on-write)
+		IMAGE_SHARED, // --> writable, changes are written back to the file.
+	};
+
+	/* file mapped into the host address space, pages are loaded when touched. */
+	class CImage : public IRefCounted {
+	private:
+		uint8_t* m_Host;
+		uint32_t m_Size;
+		EIMAGE m_Mode;
+
+#ifdef _WIN32
+		void* m_File;
+		void* m_Mapping;
+#else
+		int m_File;
+#endif
+
+	private:
+		CImage();
+
+	public:
+		virtual ~CImage();
+
+	public:
+		/**
+		 * map the file, nullptr on failure.
+		 * a writable image smaller than `size` is extended, zero for the size of the file.
+		 */
+		static CImage* open(const char* path, EIMAGE mode, uint32_t size = 0);
+
+	public:
+		inline uint8_t* getHost() const { return m_Host; }
+		inline uint32_t getSize() const { return m_Size; }
+		inline EIMAGE getMode() const { return m_Mode; }
+		inline bool isWritable() const { return m_Mode != IMAGE_ROM; }
+
+		/* write the dirty pages of the shared image back. */
+		bool sync();
+	};
+}
+
+#endif // __V86_DEV_IMAGE_H__
@@ -5,7 +5,7 @@
 namespace v86 {
 	class IMemory : public IDevice {
 	public:
-		static constexpr EDEV TYPE = EDEV_IOPORT;
+		static constexpr EDEV TYPE = EDEV_MEMORY;
 
 	public:
 		IMemory() : IDevice(TYPE) { }
@@ -17,6 +17,70 @@ namespace v86 {
 
 		/* read a byte from port. */
 		virtual bool read(uint16_t port, uint8_t* byte) = 0;
+
+	public:
+		/* write a word to port, the high byte goes to `port + 1` unless overridden. */
+		virtual bool write16(uint16_t port, uint16_t word) {
+			bool lo = write(port, uint8_t(word));
+			bool hi = write(uint16_t(port + 1), uint8_t(word >> 8));
+			return lo && hi;
+		}
+
+		/* read a word from port, the high byte comes from `port + 1` unless overridden. */
+		virtual bool read16(uint16_t port, uint16_t* word) {
+			uint8_t lo, hi;
+
+			if (read(port, &lo) == false) {
+				lo = 0xff;
+			}
+
+			if (read(uint16_t(port + 1), &hi) == false) {
+				hi = 0xff;
+			}
+
+			*word = lo | (uint16_t(hi) << 8);
+			return true;
+		}
+
+		/* read `count` elements of `width` (1, 2) bytes from the port. (e.g. REP INS) */
+		virtual uint32_t readBlock(uint16_t port, void* buf, uint32_t count, uint8_t width) {
+			uint8_t* out = (uint8_t*)buf;
+
+			for (uint32_t i = 0; i < count; ++i) {
+				if (width > 1) {
+					uint16_t word;
+					if (read16(port, &word) == false) {
+						word = 0xffff;
+					}
+
+					out[i * 2] = uint8_t(word);
+					out[i * 2 + 1] = uint8_t(word >> 8);
+				}
+
+				else if (read(port, &out[i]) == false) {
+					out[i] = 0xff;
+				}
+			}
+
+			return count;
+		}
+
+		/* write `count` elements of `width` (1, 2) bytes to the port. (e.g. REP OUTS) */
+		virtual uint32_t writeBlock(uint16_t port, const void* buf, uint32_t count, uint8_t width) {
+			const uint8_t* in = (const uint8_t*)buf;
+
+			for (uint32_t i = 0; i < count; ++i) {
+				if (width > 1) {
+					write16(port, in[i * 2] | (uint16_t(in[i * 2 + 1]) << 8));
+				}
+
+				else {
+					write(port, in[i]);
+				}
+			}
+
+			return count;
+		}
 	};
 }
 
@@ -0,0 +1,34 @@
+#include "portbus.h"
+#include <string.h>
+
+namespace v86 {
+	CPortBus::CPortBus() {
+		memset(m_Ports, 0, sizeof(m_Ports));
+	}
+
+	CPortBus::~CPortBus() {
+		unmap(0, PORTS);
+	}
+
+	bool CPortBus::map(uint16_t port, uint32_t count, IPort* device) {
+		if (device == this || count > PORTS - port) {
+			return false;
+		}
+
+		for (uint32_t i = port; i < port + count; ++i) {
+			if (m_Ports[i] == device) {
+				continue;
+			}
+
+			if (m_Ports[i]) {
+				m_Ports[i]->drop();
+			}
+
+			if ((m_Ports[i] = device) != nullptr) {
+				device->grab();
+			}
+		}
+
+		return true;
+	}
+}
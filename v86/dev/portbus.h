@@ -0,0 +1,98 @@
+#ifndef __V86_DEV_PORTBUS_H__
+#define __V86_DEV_PORTBUS_H__
+#include "port.h"
+
+namespace v86 {
+	/* port bus that dispatches each of the 65,536 ports to its device, final: a bound `Ci8086T` inlines it. */
+	class CPortBus : public IPort {
+	public:
+		static constexpr uint32_t PORTS = 0x10000;
+
+	private:
+		IPort* m_Ports[PORTS];
+
+	public:
+		CPortBus();
+		virtual ~CPortBus();
+
+	public:
+		/* get the device that owns the port. */
+		inline IPort* getDevice(uint16_t port) const {
+			return m_Ports[port];
+		}
+
+		/* route the ports to the device, nullptr to unmap them. */
+		bool map(uint16_t port, uint32_t count, IPort* device);
+
+		/* unmap the ports. */
+		inline bool unmap(uint16_t port, uint32_t count) {
+			return map(port, count, nullptr);
+		}
+
+	public:
+		/* write a byte to port. */
+		virtual bool write(uint16_t port, uint8_t byte) override final {
+			if (IPort* device = m_Ports[port]) {
+				return device->write(port, byte);
+			}
+
+			return false;
+		}
+
+		/* read a byte from port. */
+		virtual bool read(uint16_t port, uint8_t* byte) override final {
+			if (IPort* device = m_Ports[port]) {
+				return device->read(port, byte);
+			}
+
+			*byte = 0xff;
+			return false;
+		}
+
+		/* write a word to port, split if `port + 1` belongs to another device. */
+		virtual bool write16(uint16_t port, uint16_t word) override final {
+			IPort* device = m_Ports[port];
+
+			if (device && device == m_Ports[uint16_t(port + 1)]) {
+				return device->write16(port, word);
+			}
+
+			return IPort::write16(port, word);
+		}
+
+		/* read a word from port, split if `port + 1` belongs to another device. */
+		virtual bool read16(uint16_t port, uint16_t* word) override final {
+			IPort* device = m_Ports[port];
+
+			if (device && device == m_Ports[uint16_t(port + 1)]) {
+				return device->read16(port, word);
+			}
+
+			return IPort::read16(port, word);
+		}
+
+		/* read `count` elements from the port's device. */
+		virtual uint32_t readBlock(uint16_t port, void* buf, uint32_t count, uint8_t width) override final {
+			IPort* device = m_Ports[port];
+
+			if (device && (width < 2 || device == m_Ports[uint16_t(port + 1)])) {
+				return device->readBlock(port, buf, count, width);
+			}
+
+			return IPort::readBlock(port, buf, count, width);
+		}
+
+		/* write `count` elements to the port's device. */
+		virtual uint32_t writeBlock(uint16_t port, const void* buf, uint32_t count, uint8_t width) override final {
+			IPort* device = m_Ports[port];
+
+			if (device && (width < 2 || device == m_Ports[uint16_t(port + 1)])) {
+				return device->writeBlock(port, buf, count, width);
+			}
+
+			return IPort::writeBlock(port, buf, count, width);
+		}
+	};
+}
+
+#endif // __V86_DEV_PORTBUS_H__
@@ -0,0 +1,252 @@
+#include "timer.h"
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace v86 {
+	namespace {
+		/* index of the lowest set bit, the bits must not be zero. */
+		inline uint32_t lowest(uint64_t bits) {
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward64(&index, bits);
+			return uint32_t(index);
+#else
+			return uint32_t(__builtin_ctzll(bits));
+#endif
+		}
+
+		inline uint64_t rotl(uint64_t bits, uint32_t n) {
+			n &= 63;
+			return n ? (bits << n) | (bits >> (64 - n)) : bits;
+		}
+	}
+
+	CTimerWheel::CTimerWheel() : m_Overflow(nullptr), m_Now(0), m_Next(UINT64_MAX), m_Dirty(false) {
+		memset(m_Slots, 0, sizeof(m_Slots));
+		memset(m_Used, 0, sizeof(m_Used));
+	}
+
+	CTimerWheel::~CTimerWheel() {
+		// --> alarms are owned by the devices, just disarm them.
+		for (uint32_t level = 0; level < LEVELS; ++level) {
+			for (uint32_t slot = 0; slot < SLOTS; ++slot) {
+				while (m_Slots[level][slot]) {
+					cancel(m_Slots[level][slot]);
+				}
+			}
+		}
+
+		while (m_Overflow) {
+			cancel(m_Overflow);
+		}
+	}
+
+	void CTimerWheel::init(alarm_t* alarm, void (*callback)(alarm_t*, uint64_t), void* user) {
+		memset(alarm, 0, sizeof(alarm_t));
+		alarm->callback = callback;
+		alarm->user = user;
+	}
+
+	void CTimerWheel::schedule(alarm_t* alarm, uint64_t deadline) {
+		if (alarm->armed) {
+			cancel(alarm);
+		}
+
+		alarm->deadline = deadline;
+		alarm->armed = true;
+		insert(alarm);
+
+		if (!m_Dirty && deadline < m_Next) {
+			m_Next = deadline;
+		}
+	}
+
+	void CTimerWheel::cancel(alarm_t* alarm) {
+		if (!alarm->armed) {
+			return;
+		}
+
+		unlink(alarm);
+		alarm->armed = false;
+
+		if (alarm->deadline <= m_Next) {
+			m_Dirty = true;
+		}
+	}
+
+	void CTimerWheel::insert(alarm_t* alarm) {
+		uint64_t deadline = alarm->deadline > m_Now ? alarm->deadline : m_Now;
+		alarm_t** head = &m_Overflow;
+
+		// --> the lowest level whose 64 slots reach the deadline, no slot holds two laps.
+		for (uint32_t level = 0; level < LEVELS; ++level) {
+			uint32_t shift = level * SLOT_BITS;
+
+			if ((deadline >> shift) - (m_Now >> shift) < SLOTS) {
+				uint32_t slot = uint32_t(deadline >> shift) & (SLOTS - 1);
+
+				head = &m_Slots[level][slot];
+				m_Used[level] |= uint64_t(1) << slot;
+				break;
+			}
+		}
+
+		alarm->next = *head;
+		alarm->link = head;
+
+		if (*head) {
+			(*head)->link = &alarm->next;
+		}
+
+		*head = alarm;
+	}
+
+	void CTimerWheel::unlink(alarm_t* alarm) {
+		*alarm->link = alarm->next;
+
+		if (alarm->next) {
+			alarm->next->link = alarm->link;
+		}
+
+		// --> clear the bit of the emptied slot.
+		for (uint32_t level = 0; level < LEVELS; ++level) {
+			alarm_t** slots = m_Slots[level];
+
+			if (alarm->link >= slots && alarm->link < slots + SLOTS) {
+				if (!*alarm->link) {
+					m_Used[level] &= ~(uint64_t(1) << (alarm->link - slots));
+				}
+
+				break;
+			}
+		}
+
+		alarm->next = nullptr;
+		alarm->link = nullptr;
+	}
+
+	void CTimerWheel::update() {
+		m_Next = UINT64_MAX;
+
+		for (uint32_t level = 0; level < LEVELS; ++level) {
+			if (!m_Used[level]) {
+				continue;
+			}
+
+			// --> slots are in time order from the current one.
+			uint32_t shift = level * SLOT_BITS;
+			uint32_t start = uint32_t(m_Now >> shift) & (SLOTS - 1);
+			uint32_t slot = (start + lowest(rotl(m_Used[level], SLOTS - start))) & (SLOTS - 1);
+
+			for (alarm_t* alarm = m_Slots[level][slot]; alarm; alarm = alarm->next) {
+				m_Next = alarm->deadline < m_Next ? alarm->deadline : m_Next;
+			}
+		}
+
+		for (alarm_t* alarm = m_Overflow; alarm; alarm = alarm->next) {
+			m_Next = alarm->deadline < m_Next ? alarm->deadline : m_Next;
+		}
+
+		m_Dirty = false;
+	}
+
+	uint32_t CTimerWheel::advance(uint64_t now) {
+		uint64_t last = LEVELS * SLOT_BITS;
+
+		if (now < m_Now) {
+			return 0;
+		}
+
+		if (getNext() > now) {
+			// --> nothing is due, the slots stay valid for the later time.
+			bool wrapped = (now >> last) != (m_Now >> last);
+			m_Now = now;
+
+			if (wrapped && m_Overflow) {
+				alarm_t* pending = m_Overflow;
+				m_Overflow = nullptr;
+
+				while (pending) {
+					alarm_t* alarm = pending;
+					pending = alarm->next;
+					insert(alarm);
+				}
+			}
+
+			return 0;
+		}
+
+		alarm_t* due = nullptr;
+		alarm_t* pending = nullptr;
+
+		/* move the alarms of the slot, due alarms stay armed until they fire. */
+		auto collect = [&](alarm_t*& head) {
+			while (alarm_t* alarm = head) {
+				head = alarm->next;
+
+				if (alarm->deadline <= now) {
+					alarm->next = due;
+					alarm->link = &due;
+
+					if (due) {
+						due->link = &alarm->next;
+					}
+
+					due = alarm;
+				}
+
+				else {
+					alarm->next = pending;
+					alarm->link = nullptr;
+					pending = alarm;
+				}
+			}
+		};
+
+		for (uint32_t level = 0; level < LEVELS; ++level) {
+			uint32_t shift = level * SLOT_BITS;
+			uint64_t span = (now >> shift) - (m_Now >> shift) + 1;
+			uint64_t mask = span >= SLOTS ? ~uint64_t(0) : (uint64_t(1) << span) - 1;
+			uint64_t bits = m_Used[level] & rotl(mask, uint32_t(m_Now >> shift));
+
+			m_Used[level] &= ~bits;
+			while (bits) {
+				uint32_t slot = lowest(bits);
+				bits &= bits - 1;
+				collect(m_Slots[level][slot]);
+			}
+		}
+
+		collect(m_Overflow);
+		m_Now = now;
+		m_Dirty = true;
+
+		// --> the rest goes to the levels of the new time.
+		while (pending) {
+			alarm_t* alarm = pending;
+			pending = alarm->next;
+			insert(alarm);
+		}
+
+		// --> in deadline order, callbacks may schedule or cancel alarms.
+		uint32_t fired = 0;
+		while (due) {
+			alarm_t* alarm = due;
+
+			for (alarm_t* each = due->next; each; each = each->next) {
+				alarm = each->deadline < alarm->deadline ? each : alarm;
+			}
+
+			unlink(alarm);
+			alarm->armed = false;
+
+			fired++;
+			alarm->callback(alarm, now);
+		}
+
+		return fired;
+	}
+}
\ No newline at end of file
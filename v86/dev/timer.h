@@ -0,0 +1,72 @@
+#ifndef __V86_DEV_TIMER_H__
+#define __V86_DEV_TIMER_H__
+#include "../types.h"
+
+namespace v86 {
+	class CTimerWheel;
+
+	/* device alarm at an absolute guest cycle count, owned by the device. */
+	struct alarm_t {
+		void (*callback)(alarm_t* alarm, uint64_t now);
+		void* user;
+
+		uint64_t deadline;
+		alarm_t* next; // --> in the slot.
+		alarm_t** link; // --> pointer that points this.
+		bool armed;
+	};
+
+	/**
+	 * hierarchical timing wheel keyed by guest cycles.
+	 * level L has 64 slots of 64^L cycles, farther alarms wait on the overflow list.
+	 * work is proportional to alarms, not to the elapsed cycles.
+	 */
+	class CTimerWheel {
+	public:
+		static constexpr uint32_t LEVELS = 4;
+		static constexpr uint32_t SLOT_BITS = 6;
+		static constexpr uint32_t SLOTS = 1 << SLOT_BITS;
+
+	private:
+		alarm_t* m_Slots[LEVELS][SLOTS];
+		uint64_t m_Used[LEVELS]; // --> a bit per non-empty slot.
+		alarm_t* m_Overflow;
+
+		uint64_t m_Now; // --> cycles of the last advance.
+		uint64_t m_Next; // --> earliest deadline, valid unless dirty.
+		bool m_Dirty;
+
+	public:
+		CTimerWheel();
+		~CTimerWheel();
+
+	public:
+		/* set up the alarm, not armed. */
+		static void init(alarm_t* alarm, void (*callback)(alarm_t*, uint64_t), void* user);
+
+		/* arm the alarm at the deadline, re-arms it if already armed. (past deadlines fire at the next advance) */
+		void schedule(alarm_t* alarm, uint64_t deadline);
+
+		/* disarm the alarm. */
+		void cancel(alarm_t* alarm);
+
+		/* get the earliest deadline, UINT64_MAX if nothing is armed. */
+		inline uint64_t getNext() {
+			if (m_Dirty) {
+				update();
+			}
+
+			return m_Next;
+		}
+
+		/* fire the alarms due at `now` in deadline order, returns the number fired. */
+		uint32_t advance(uint64_t now);
+
+	private:
+		void insert(alarm_t* alarm);
+		void unlink(alarm_t* alarm);
+		void update();
+	};
+}
+
+#endif // __V86_DEV_TIMER_H__
\ No newline at end of file
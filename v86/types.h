@@ -1,6 +1,7 @@
 #ifndef __V86_TYPES_H__
 #define __V86_TYPES_H__
 #include <stdint.h>
+#include <atomic>
 
 namespace v86 {
 	using uint8_t = ::uint8_t;
@@ -15,10 +16,10 @@ namespace v86 {
 
 	using nullptr_t = decltype(nullptr);
 
-	/* reference counted interface. */
+	/* reference counted interface. (shared instances can be grabbed and dropped from any thread) */
 	class IRefCounted {
 	private:
-		int32_t m_Refs;
+		std::atomic<int32_t> m_Refs;
 
 	public:
 		IRefCounted() : m_Refs(1) { }
@@ -27,9 +28,7 @@ namespace v86 {
 	public:
 		inline void grab() { m_Refs++; }
 		virtual bool drop() {
-			m_Refs--;
-
-			if (m_Refs == 0) {
+			if (m_Refs.fetch_sub(1) == 1) {
 				delete this;
 				return true;
 			}
@@ -0,0 +1,687 @@
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define __V86_LOCKSTEP_AVX2__
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define __V86_LOCKSTEP_SSE2__
+#endif
+
+// --> after the standard headers, the register macros collide with them.
+#include "lockstep.h"
+
+namespace v86 {
+	/* 16 lanes of 16 bits: one AVX2 register, two SSE2 registers, or plain words elsewhere. */
+	struct vec_t {
+#if defined(__V86_LOCKSTEP_AVX2__)
+		__m256i v;
+#elif defined(__V86_LOCKSTEP_SSE2__)
+		__m128i lo, hi;
+#else
+		uint16_t v[16];
+#endif
+	};
+
+	static_assert(CLockstep::LANES == 16, "the kernels are written for 16 lanes.");
+
+#if defined(__V86_LOCKSTEP_AVX2__)
+#define VEC_BINARY(name, avx, sse) \
+	static inline vec_t name(vec_t a, vec_t b) { vec_t r; r.v = avx(a.v, b.v); return r; }
+#define VEC_SHIFT(name, avx, sse) \
+	template<int n> static inline vec_t name(vec_t a) { vec_t r; r.v = avx(a.v, n); return r; }
+
+	static inline vec_t vload(const uint16_t* p) { vec_t r; r.v = _mm256_load_si256((const __m256i*)p); return r; }
+	static inline void vstore(uint16_t* p, vec_t a) { _mm256_store_si256((__m256i*)p, a.v); }
+	static inline vec_t vset(uint16_t x) { vec_t r; r.v = _mm256_set1_epi16(int16_t(x)); return r; }
+#elif defined(__V86_LOCKSTEP_SSE2__)
+#define VEC_BINARY(name, avx, sse) \
+	static inline vec_t name(vec_t a, vec_t b) { vec_t r; r.lo = sse(a.lo, b.lo); r.hi = sse(a.hi, b.hi); return r; }
+#define VEC_SHIFT(name, avx, sse) \
+	template<int n> static inline vec_t name(vec_t a) { vec_t r; r.lo = sse(a.lo, n); r.hi = sse(a.hi, n); return r; }
+
+	static inline vec_t vload(const uint16_t* p) {
+		vec_t r;
+		r.lo = _mm_load_si128((const __m128i*)p);
+		r.hi = _mm_load_si128((const __m128i*)(p + 8));
+		return r;
+	}
+
+	static inline void vstore(uint16_t* p, vec_t a) {
+		_mm_store_si128((__m128i*)p, a.lo);
+		_mm_store_si128((__m128i*)(p + 8), a.hi);
+	}
+
+	static inline vec_t vset(uint16_t x) { vec_t r; r.lo = r.hi = _mm_set1_epi16(int16_t(x)); return r; }
+#else
+#define VEC_BINARY(name, expr) \
+	static inline vec_t name(vec_t a, vec_t b) { \
+		vec_t r; \
+		for (uint32_t i = 0; i < 16; ++i) { uint16_t x = a.v[i], y = b.v[i]; r.v[i] = uint16_t(expr); } \
+		return r; \
+	}
+
+	static inline vec_t vload(const uint16_t* p) { vec_t r; memcpy(r.v, p, sizeof(r.v)); return r; }
+	static inline void vstore(uint16_t* p, vec_t a) { memcpy(p, a.v, sizeof(a.v)); }
+	static inline vec_t vset(uint16_t x) { vec_t r; for (uint32_t i = 0; i < 16; ++i) { r.v[i] = x; } return r; }
+
+	template<int n> static inline vec_t vsrl(vec_t a) { for (uint32_t i = 0; i < 16; ++i) { a.v[i] >>= n; } return a; }
+	template<int n> static inline vec_t vsll(vec_t a) { for (uint32_t i = 0; i < 16; ++i) { a.v[i] <<= n; } return a; }
+#endif
+
+#if defined(__V86_LOCKSTEP_AVX2__) || defined(__V86_LOCKSTEP_SSE2__)
+	VEC_BINARY(vadd, _mm256_add_epi16, _mm_add_epi16)
+	VEC_BINARY(vsub, _mm256_sub_epi16, _mm_sub_epi16)
+	VEC_BINARY(vand, _mm256_and_si256, _mm_and_si128)
+	VEC_BINARY(vor, _mm256_or_si256, _mm_or_si128)
+	VEC_BINARY(vxor, _mm256_xor_si256, _mm_xor_si128)
+	VEC_BINARY(vandnot, _mm256_andnot_si256, _mm_andnot_si128) // --> ~a & b.
+	VEC_BINARY(vcmpeq, _mm256_cmpeq_epi16, _mm_cmpeq_epi16) // --> 0xffff if equal.
+	VEC_SHIFT(vsrl, _mm256_srli_epi16, _mm_srli_epi16)
+	VEC_SHIFT(vsll, _mm256_slli_epi16, _mm_slli_epi16)
+#else
+	VEC_BINARY(vadd, x + y)
+	VEC_BINARY(vsub, x - y)
+	VEC_BINARY(vand, x & y)
+	VEC_BINARY(vor, x | y)
+	VEC_BINARY(vxor, x ^ y)
+	VEC_BINARY(vandnot, ~x & y)
+	VEC_BINARY(vcmpeq, x == y ? 0xffff : 0)
+#endif
+
+#undef VEC_BINARY
+#undef VEC_SHIFT
+
+	/* `m ? a : b`, lane by lane. */
+	static inline vec_t vsel(vec_t m, vec_t a, vec_t b) {
+		return vor(vand(m, a), vandnot(m, b));
+	}
+
+	/* expand the lane bits into 0xffff or 0 per lane. */
+	static inline vec_t vmask(uint32_t lanes) {
+		alignas(32) static const uint16_t BITS[16] = {
+			0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080,
+			0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000, 0x8000,
+		};
+
+		vec_t bits = vload(BITS);
+		return vcmpeq(vand(vset(uint16_t(lanes)), bits), bits);
+	}
+
+	/* status flags of the 8086, as in eflags. */
+	constexpr uint16_t VF_CF = 1 << EFLAG_CF;
+	constexpr uint16_t VF_AF = 1 << EFLAG_AF;
+	constexpr uint16_t VF_STATUS = 0x8d5; // --> CF, PF, AF, ZF, SF, OF.
+
+	/* ZF, SF and PF of the result. */
+	static inline vec_t vflagsZsp(vec_t res) {
+		vec_t zf = vand(vcmpeq(res, vset(0)), vset(1 << EFLAG_ZF));
+		vec_t sf = vand(vsrl<15 - EFLAG_SF>(res), vset(1 << EFLAG_SF));
+
+		// --> even parity of the low byte.
+		vec_t p = vand(res, vset(0xff));
+		p = vxor(p, vsrl<4>(p));
+		p = vxor(p, vsrl<2>(p));
+		p = vxor(p, vsrl<1>(p));
+		vec_t pf = vsll<EFLAG_PF>(vandnot(p, vset(1)));
+
+		return vor(vor(zf, sf), pf);
+	}
+
+	/* status flags of `res = dst + src (+ carry)` or `res = dst - src (- borrow)`. */
+	template<bool sub>
+	static inline vec_t vflagsArith(vec_t dst, vec_t src, vec_t res) {
+		vec_t cf, of;
+
+		if (sub) {
+			// --> borrow out of bit 15.
+			cf = vor(vandnot(dst, src), vandnot(vxor(dst, src), res));
+			of = vand(vxor(dst, src), vxor(dst, res));
+		}
+
+		else {
+			// --> carry out of bit 15.
+			cf = vor(vand(dst, src), vandnot(res, vxor(dst, src)));
+			of = vand(vxor(dst, res), vxor(src, res));
+		}
+
+		vec_t af = vand(vxor(vxor(dst, src), res), vset(VF_AF));
+
+		return vor(vor(vsrl<15>(cf), vsll<EFLAG_OF>(vsrl<15>(of))),
+			vor(af, vflagsZsp(res)));
+	}
+
+	/* compute `dst (op) src` for EALU 0 ~ 7, and its status flags into `fl`. */
+	static inline vec_t valu(uint8_t op, vec_t dst, vec_t src, vec_t* fl) {
+		vec_t res, status;
+		vec_t cf = vand(*fl, vset(VF_CF));
+
+		switch (op) {
+		case ALU_ADD: res = vadd(dst, src); status = vflagsArith<false>(dst, src, res); break;
+		case ALU_ADC: res = vadd(vadd(dst, src), cf); status = vflagsArith<false>(dst, src, res); break;
+		case ALU_SBB: res = vsub(vsub(dst, src), cf); status = vflagsArith<true>(dst, src, res); break;
+		case ALU_SUB: case ALU_CMP: res = vsub(dst, src); status = vflagsArith<true>(dst, src, res); break;
+		case ALU_OR: res = vor(dst, src); status = vflagsZsp(res); break;
+		case ALU_AND: res = vand(dst, src); status = vflagsZsp(res); break;
+		default: res = vxor(dst, src); status = vflagsZsp(res); break; // --> ALU_XOR.
+		}
+
+		*fl = vor(vandnot(vset(VF_STATUS), *fl), status);
+		return res;
+	}
+
+	/* condition of Jcc (low nibble of 70 ~ 7F), 0xffff where taken. */
+	static inline vec_t vcond(uint8_t cc, vec_t fl) {
+		vec_t one = vset(1);
+		vec_t cf = vand(fl, one);
+		vec_t pf = vand(vsrl<EFLAG_PF>(fl), one);
+		vec_t zf = vand(vsrl<EFLAG_ZF>(fl), one);
+		vec_t sf = vand(vsrl<EFLAG_SF>(fl), one);
+		vec_t of = vand(vsrl<EFLAG_OF>(fl), one);
+		vec_t c;
+
+		switch ((cc >> 1) & 0x07) {
+		case 0: c = of; break;
+		case 1: c = cf; break;
+		case 2: c = zf; break;
+		case 3: c = vor(cf, zf); break;
+		case 4: c = sf; break;
+		case 5: c = pf; break;
+		case 6: c = vxor(sf, of); break;
+		default: c = vor(vxor(sf, of), zf); break;
+		}
+
+		if (cc & 1) {
+			c = vxor(c, one);
+		}
+
+		return vcmpeq(c, one);
+	}
+
+	/* lowest lane of the mask. */
+	static inline uint32_t lowest(uint32_t lanes) {
+		uint32_t lane = 0;
+
+		while (!(lanes & (1u << lane))) {
+			lane++;
+		}
+
+		return lane;
+	}
+
+	static inline uint32_t popcount(uint32_t lanes) {
+		uint32_t n = 0;
+
+		for (; lanes; lanes &= lanes - 1) {
+			n++;
+		}
+
+		return n;
+	}
+
+	CLockstep::CLockstep()
+		: m_Count(0), m_Vector(0)
+	{
+		memset(&m_State, 0, sizeof(m_State));
+		memset(m_Cpus, 0, sizeof(m_Cpus));
+		memset(m_Keys, 0, sizeof(m_Keys));
+		memset(m_Left, 0, sizeof(m_Left));
+		memset(m_Operands, 0, sizeof(m_Operands));
+		memset(m_Addrs, 0, sizeof(m_Addrs));
+		memset(&m_Stat, 0, sizeof(m_Stat));
+
+		for (uint32_t i = 0; i < LANES; ++i) {
+			m_Stops[i] = STOP_NONE;
+		}
+	}
+
+	CLockstep::~CLockstep() {
+		for (uint32_t i = 0; i < m_Count; ++i) {
+			delete m_Cpus[i];
+		}
+	}
+
+	int32_t CLockstep::add(Ci8086* cpu) {
+		if (!cpu || m_Count >= LANES) {
+			return -1;
+		}
+
+		m_Cpus[m_Count] = cpu;
+		m_Stops[m_Count] = STOP_NONE;
+		return int32_t(m_Count++);
+	}
+
+	uint64_t CLockstep::key(uint32_t lane) const {
+		uint32_t seg, off;
+
+		if (m_Vector & (1u << lane)) {
+			seg = m_State.segs[SEG_CS][lane];
+			off = m_State.pc[lane];
+		}
+
+		else {
+			state_t* state = m_Cpus[lane]->getState();
+			seg = state->cs & 0xffff;
+			off = state->ip;
+		}
+
+		return (uint64_t((seg << 4) + off) << 16) | seg;
+	}
+
+	void CLockstep::enter(uint32_t lane) {
+		if (!(m_Vector & (1u << lane))) {
+			soa_load(&m_State, lane, m_Cpus[lane]->getState());
+			m_Vector |= 1u << lane;
+		}
+	}
+
+	void CLockstep::leave(uint32_t lane) {
+		if (m_Vector & (1u << lane)) {
+			soa_store(&m_State, lane, m_Cpus[lane]->getState());
+			m_Vector &= ~(1u << lane);
+		}
+	}
+
+	void CLockstep::step(uint32_t lane) {
+		Ci8086* cpu = m_Cpus[lane];
+		state_t* state = cpu->getState();
+
+		if (m_Vector & (1u << lane)) {
+			leave(lane);
+			m_Stat.peels++;
+		}
+
+		uint64_t retired = state->instructions;
+		ESTOP reason = cpu->run(1, UINT64_MAX);
+		retired = state->instructions - retired;
+
+		m_Left[lane] -= retired < m_Left[lane] ? retired : m_Left[lane];
+		m_Stat.scalar += retired;
+		m_Keys[lane] = key(lane);
+
+		if (reason != STOP_BUDGET) {
+			m_Stops[lane] = reason;
+		}
+	}
+
+	uint32_t CLockstep::run(uint64_t maxInstructions) {
+		for (uint32_t i = 0; i < m_Count; ++i) {
+			m_Left[i] = maxInstructions;
+			m_Stops[i] = STOP_NONE;
+			m_Keys[i] = key(i);
+		}
+
+		while (true) {
+			uint64_t best = UINT64_MAX;
+			uint32_t lanes = 0;
+
+			// --> the lanes at the lowest CS:IP go first, the others catch up to them.
+			for (uint32_t i = 0; i < m_Count; ++i) {
+				if (m_Stops[i] != STOP_NONE) {
+					continue;
+				}
+
+				if (!m_Left[i]) {
+					m_Stops[i] = STOP_BUDGET;
+					continue;
+				}
+
+				if (m_Keys[i] < best) {
+					best = m_Keys[i];
+					lanes = 1u << i;
+				}
+
+				else if (m_Keys[i] == best) {
+					lanes |= 1u << i;
+				}
+			}
+
+			if (!lanes) {
+				break;
+			}
+
+			if (lanes & (lanes - 1)) {
+				uint32_t linear = uint32_t(best >> 16);
+				uint16_t off = m_Cpus[lowest(lanes)]->getState()->ip;
+				uint32_t size = CMemoryBus::PAGE_SIZE - (linear & (CMemoryBus::PAGE_SIZE - 1));
+
+				if (m_Vector & (1u << lowest(lanes))) {
+					off = m_State.pc[lowest(lanes)];
+				}
+
+				// --> the longest of the subset is 7 bytes, not across the page or the end of the segment.
+				size = size < 8 ? size : 8;
+				size = off + size <= 0x10000 ? size : 0x10000 - off;
+
+				// --> code fetches, not data reads: pages with breakpoints have no host pointer.
+				const CMemoryBus* bus = m_Cpus[lowest(lanes)]->getBus();
+				const uint8_t* code = bus ? bus->code(linear) : nullptr;
+				vinsn_t insn;
+
+				if (code && decode(code, size, &insn)) {
+					uint32_t group = 0;
+
+					for (uint32_t i = 0; i < m_Count; ++i) {
+						if ((lanes & (1u << i)) && ready(i, insn, code)) {
+							group |= 1u << i;
+						}
+					}
+
+					if ((group & (group - 1)) && execute(insn, group)) {
+						lanes &= ~group;
+					}
+				}
+			}
+
+			for (uint32_t i = 0; lanes; ++i, lanes >>= 1) {
+				if (lanes & 1) {
+					step(i);
+				}
+			}
+		}
+
+		uint32_t stopped = 0;
+
+		for (uint32_t i = 0; i < m_Count; ++i) {
+			leave(i);
+
+			if (m_Stops[i] != STOP_BUDGET) {
+				stopped++;
+			}
+		}
+
+		return stopped;
+	}
+
+	bool CLockstep::decode(const uint8_t* code, uint32_t size, vinsn_t* insn) const {
+		uint32_t pos = 0;
+		uint8_t opcode;
+
+		insn->sov = SEG_MAX;
+		insn->modrm = 0;
+		insn->disp = 0;
+		insn->imm = 0;
+
+		while (true) {
+			if (pos >= size) {
+				return false;
+			}
+
+			opcode = code[pos++];
+
+			if ((opcode & 0xe7) != 0x26) {
+				break;
+			}
+
+			insn->sov = (opcode - 0x26) >> 3;
+		}
+
+		bool modrm = false;
+		uint8_t imm = 0;
+
+		if (opcode < 0x40) {
+			switch (opcode & 0x07) {
+			case 0x01: case 0x03: modrm = true; break;
+			case 0x05: imm = 2; break;
+			default: return false;
+			}
+		}
+
+		else if (opcode < 0x60) {
+			// --> INC, DEC, PUSH, POP.
+		}
+
+		else if (opcode >= 0x70 && opcode < 0x80) {
+			imm = 1;
+		}
+
+		else {
+			switch (opcode) {
+			case 0x81: modrm = true; imm = 2; break;
+			case 0x83: modrm = true; imm = 1; break;
+			case 0x85: case 0x89: case 0x8b: modrm = true; break;
+			default: return false;
+			}
+		}
+
+		insn->opcode = opcode;
+
+		if (modrm) {
+			if (pos >= size) {
+				return false;
+			}
+
+			const modrm_t& m = MODRM16[insn->modrm = code[pos++]];
+
+			if (pos + m.disp > size) {
+				return false;
+			}
+
+			if (m.disp == 1) {
+				insn->disp = uint16_t(int8_t(code[pos]));
+			}
+
+			else if (m.disp == 2) {
+				insn->disp = uint16_t(code[pos] | (code[pos + 1] << 8));
+			}
+
+			pos += m.disp;
+		}
+
+		if (pos + imm > size) {
+			return false;
+		}
+
+		if (imm == 1) {
+			insn->imm = uint16_t(int8_t(code[pos]));
+		}
+
+		else if (imm == 2) {
+			insn->imm = uint16_t(code[pos] | (code[pos + 1] << 8));
+		}
+
+		insn->length = uint8_t(pos + imm);
+		return true;
+	}
+
+	bool CLockstep::ready(uint32_t lane, const vinsn_t& insn, const uint8_t* code) {
+		Ci8086* cpu = m_Cpus[lane];
+		uint32_t linear = uint32_t(m_Keys[lane] >> 16);
+
+		if (cpu->hasStops() || !cpu->isDefault(insn.opcode)) {
+			return false;
+		}
+
+		if (cpu->getTimers()->getNext() != UINT64_MAX) {
+			return false;
+		}
+
+		// --> the lanes may run different code at the same address, and have their own breakpoints.
+		const CMemoryBus* bus = cpu->getBus();
+		const uint8_t* own = bus ? bus->code(linear) : nullptr;
+		if (!own || (own != code && memcmp(own, code, insn.length))) {
+			return false;
+		}
+
+		enter(lane);
+
+		/* the memory operand, or the stack. */
+		uint32_t addr;
+
+		if (insn.opcode >= 0x50 && insn.opcode < 0x60) {
+			uint16_t top = m_State.regs[REG_ESP][lane];
+			addr = (uint32_t(m_State.segs[SEG_SS][lane]) << 4)
+				+ uint16_t(insn.opcode < 0x58 ? top - 2 : top);
+		}
+
+		else if (MODRM16[insn.modrm].memory && (insn.opcode < 0x40 || insn.opcode > 0x80)) {
+			const modrm_t& m = MODRM16[insn.modrm];
+			uint16_t off = uint16_t((m_State.regs[m.base][lane] & m.bmask)
+				+ (m_State.regs[m.index][lane] & m.imask) + insn.disp);
+			uint8_t seg = insn.sov != SEG_MAX ? insn.sov : m.seg;
+
+			addr = (uint32_t(m_State.segs[seg][lane]) << 4) + off;
+		}
+
+		else {
+			return true;
+		}
+
+		// --> stores go through the processor, loads only from plain memory.
+		const uint8_t* host = cpu->direct(addr, 2, PAGE_READ);
+		if (!host) {
+			return false;
+		}
+
+		m_Addrs[lane] = addr;
+		m_Operands[lane] = uint16_t(host[0] | (host[1] << 8));
+		return true;
+	}
+
+	bool CLockstep::execute(const vinsn_t& insn, uint32_t lanes) {
+		alignas(32) uint16_t out[LANES];
+		const modrm_t& m = MODRM16[insn.modrm];
+		uint8_t opcode = insn.opcode;
+
+		vec_t mask = vmask(lanes);
+		vec_t fl = vload(m_State.fl);
+		vec_t pc = vadd(vload(m_State.pc), vset(insn.length));
+
+		/* ModRM operand. */
+		auto rm = [&]() { return m.memory ? vload(m_Operands) : vload(m_State.regs[m.rm]); };
+		bool store = false; // --> `out` goes to the memory operand.
+
+		auto setReg = [&](uint8_t reg, vec_t value) {
+			vstore(m_State.regs[reg], vsel(mask, value, vload(m_State.regs[reg])));
+		};
+
+		auto setRm = [&](vec_t value) {
+			if (m.memory) {
+				vstore(out, value);
+				store = true;
+			}
+
+			else {
+				setReg(m.rm, value);
+			}
+		};
+
+		if (opcode < 0x40) {
+			uint8_t op = (opcode >> 3) & 0x07;
+
+			switch (opcode & 0x07) {
+			case 0x01: { /* Ev Gv */
+				vec_t res = valu(op, rm(), vload(m_State.regs[m.reg]), &fl);
+				if (op != ALU_CMP) {
+					setRm(res);
+				}
+				break;
+			}
+
+			case 0x03: { /* Gv Ev */
+				vec_t res = valu(op, vload(m_State.regs[m.reg]), rm(), &fl);
+				if (op != ALU_CMP) {
+					setReg(m.reg, res);
+				}
+				break;
+			}
+
+			default: { /* eAX Iv */
+				vec_t res = valu(op, vload(m_State.regs[REG_EAX]), vset(insn.imm), &fl);
+				if (op != ALU_CMP) {
+					setReg(REG_EAX, res);
+				}
+				break;
+			}
+			}
+		}
+
+		else if (opcode < 0x50) {
+			/* INC, DEC: CF is kept. */
+			vec_t dst = vload(m_State.regs[opcode & 0x07]);
+			vec_t one = vset(1);
+			vec_t res, status;
+
+			if (opcode < 0x48) {
+				res = vadd(dst, one);
+				status = vflagsArith<false>(dst, one, res);
+			}
+
+			else {
+				res = vsub(dst, one);
+				status = vflagsArith<true>(dst, one, res);
+			}
+
+			fl = vor(vandnot(vset(VF_STATUS & ~VF_CF), fl), vandnot(vset(VF_CF), status));
+			setReg(opcode & 0x07, res);
+		}
+
+		else if (opcode < 0x58) {
+			/* PUSH: 8086 pushes the decremented SP. */
+			vec_t top = vsub(vload(m_State.regs[REG_ESP]), vset(2));
+			setReg(REG_ESP, top);
+			vstore(out, vload(m_State.regs[opcode & 0x07]));
+			store = true;
+		}
+
+		else if (opcode < 0x60) {
+			/* POP: SP first, then the register, so POP SP takes the popped value. */
+			setReg(REG_ESP, vadd(vload(m_State.regs[REG_ESP]), vset(2)));
+			setReg(opcode & 0x07, vload(m_Operands));
+		}
+
+		else if (opcode < 0x80) {
+			/* Jcc. */
+			vec_t taken = vcond(opcode & 0x0f, fl);
+			pc = vadd(pc, vand(taken, vset(insn.imm)));
+		}
+
+		else {
+			switch (opcode) {
+			case 0x81: case 0x83: { /* GRP1 Ev Iv, Ev Ib */
+				vec_t res = valu(m.reg, rm(), vset(insn.imm), &fl);
+				if (m.reg != ALU_CMP) {
+					setRm(res);
+				}
+				break;
+			}
+
+			case 0x85: { /* TEST Gv Ev */
+				vec_t res = vand(vload(m_State.regs[m.reg]), rm());
+				fl = vor(vandnot(vset(VF_STATUS), fl), vflagsZsp(res));
+				break;
+			}
+
+			case 0x89: /* MOV Ev Gv */
+				setRm(vload(m_State.regs[m.reg]));
+				break;
+
+			default: /* 8B MOV Gv Ev */
+				setReg(m.reg, rm());
+				break;
+			}
+		}
+
+		vstore(m_State.fl, vsel(mask, fl, vload(m_State.fl)));
+		vstore(m_State.pc, vsel(mask, pc, vload(m_State.pc)));
+
+		for (uint32_t i = 0; i < m_Count; ++i) {
+			if (!(lanes & (1u << i))) {
+				continue;
+			}
+
+			if (store) {
+				m_Cpus[i]->store16(m_Addrs[i], out[i]);
+			}
+
+			m_State.cycles[i] += Ci8086::CYCLES[opcode];
+			m_State.instructions[i]++;
+			m_Left[i]--;
+			m_Keys[i] = key(i);
+		}
+
+		m_Stat.steps++;
+		m_Stat.vector += popcount(lanes);
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#ifndef __V86_VM_LOCKSTEP_H__
+#define __V86_VM_LOCKSTEP_H__
+
+// --> after the standard headers, the register macros collide with them.
+#include "../cpu/i8086.h"
+#include "../cpu/soa.h"
+
+namespace v86 {
+	/* counters of the lockstep executor. */
+	struct lockstat_t {
+		uint64_t steps; // --> vector steps.
+		uint64_t vector; // --> instructions retired by the vector steps, over all lanes.
+		uint64_t scalar; // --> instructions retired by the lanes alone.
+		uint64_t peels; // --> lanes that left a vector step to run alone.
+	};
+
+	/**
+	 * runs many processors of the same program in lockstep.
+	 * the lanes at the lowest CS:IP run its instruction together: the 16-bit ALU, MOV, TEST,
+	 * INC/DEC, PUSH/POP and Jcc subset is executed for all of them by vector kernels, flags included.
+	 * a lane that diverges (other branch, other code bytes, unsupported opcode, I/O, events, MMIO)
+	 * peels off to its `Ci8086`, and rejoins the vector steps when it reaches the same CS:IP again.
+	 * vector steps do not run timers: lanes with alarms armed always run alone.
+	 * code pages with breakpoints (WATCH_EXEC) run alone too, data watches stop the lane after its vector step.
+	 */
+	class CLockstep {
+	public:
+		static constexpr uint32_t LANES = 16;
+
+	private:
+		typedef soa_state_t<LANES> soa_t;
+
+		/* decoded instruction of a vector step. */
+		struct vinsn_t {
+			uint8_t opcode;
+			uint8_t length;
+			uint8_t sov; // --> overriding segment, SEG_MAX if not overridden.
+			uint8_t modrm;
+			uint16_t disp;
+			uint16_t imm; // --> sign extended.
+		};
+
+	private:
+		soa_t m_State;
+		Ci8086* m_Cpus[LANES];
+		uint32_t m_Count;
+
+		uint32_t m_Vector; // --> lanes whose state is in `m_State`, by bit.
+		ESTOP m_Stops[LANES]; // --> STOP_NONE while running.
+		uint64_t m_Keys[LANES]; // --> linear CS:IP, then CS.
+		uint64_t m_Left[LANES];
+
+		/* memory operand of the lanes. */
+		alignas(32) uint16_t m_Operands[LANES];
+		uint32_t m_Addrs[LANES];
+
+		lockstat_t m_Stat;
+
+	public:
+		CLockstep();
+		virtual ~CLockstep();
+
+	public:
+		inline uint32_t getCount() const { return m_Count; }
+		inline const lockstat_t* getStat() const { return &m_Stat; }
+
+		/* get the processor of the lane, its state is up to date between runs. */
+		inline Ci8086* getProc(uint32_t lane) const { return lane < m_Count ? m_Cpus[lane] : nullptr; }
+
+		/* get why the lane stopped in the last run, STOP_BUDGET if it has run out of instructions. */
+		inline ESTOP getStop(uint32_t lane) const { return lane < m_Count ? m_Stops[lane] : STOP_NONE; }
+
+	public:
+		/* add a processor as the next lane, the executor deletes it. returns the lane, -1 if full. */
+		int32_t add(Ci8086* cpu);
+
+		/**
+		 * run every lane up to `maxInstructions`, until each has run out or stopped.
+		 * returns the number of lanes stopped by something else than the budget.
+		 */
+		uint32_t run(uint64_t maxInstructions);
+
+	private:
+		/* linear CS:IP of the lane, ordered. */
+		uint64_t key(uint32_t lane) const;
+
+		/* move the lane into the vector state, or back out to its processor. */
+		void enter(uint32_t lane);
+		void leave(uint32_t lane);
+
+		/* run single instruction of the lane alone. */
+		void step(uint32_t lane);
+
+		/* decode the instruction at the host pointer, false if it is not in the vector subset. */
+		bool decode(const uint8_t* code, uint32_t size, vinsn_t* insn) const;
+
+		/* test whether the lane can take part in a vector step of the instruction. */
+		bool ready(uint32_t lane, const vinsn_t& insn, const uint8_t* code);
+
+		/* execute the instruction for the lanes of the mask, returns false to run them alone. */
+		bool execute(const vinsn_t& insn, uint32_t lanes);
+	};
+}
+
+#endif // __V86_VM_LOCKSTEP_H__
\ No newline at end of file
@@ -0,0 +1,555 @@
+#include "replay.h"
+
+namespace v86 {
+	namespace {
+		const uint8_t MAGIC[4] = { 'V', '8', '6', 'R' };
+		constexpr uint8_t VERSION = 1;
+
+		inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+			while (value >= 0x80) {
+				out.push_back(uint8_t(value | 0x80));
+				value >>= 7;
+			}
+
+			out.push_back(uint8_t(value));
+		}
+
+		inline bool getVarint(const std::vector<uint8_t>& in, size_t* pos, uint64_t* value) {
+			*value = 0;
+
+			for (uint32_t shift = 0; shift < 64 && *pos < in.size(); shift += 7) {
+				uint8_t b = in[(*pos)++];
+				*value |= uint64_t(b & 0x7f) << shift;
+
+				if (!(b & 0x80)) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		inline void putLE(uint8_t* out, uint64_t value, uint32_t size) {
+			for (uint32_t i = 0; i < size; ++i) {
+				out[i] = uint8_t(value >> (i * 8));
+			}
+		}
+
+		inline uint64_t getLE(const uint8_t* in, uint32_t size) {
+			uint64_t value = 0;
+
+			for (uint32_t i = 0; i < size; ++i) {
+				value |= uint64_t(in[i]) << (i * 8);
+			}
+
+			return value;
+		}
+	}
+
+	CReplay::CReplay(IProc* proc, EREPLAY mode, FILE* file)
+		: m_Proc(proc), m_Port(nullptr), m_Mode(mode), m_File(file), m_Diverged(false),
+		  m_PortPos(0), m_EventPos(0), m_Instructions(0), m_Cycles(0), m_Horizon(0), m_More(true)
+	{
+		m_Next.kind = 0;
+	}
+
+	CReplay::~CReplay() {
+		if (m_File) {
+			if (m_Mode == REPLAY_RECORD) {
+				flush();
+			}
+
+			fclose(m_File);
+		}
+
+		if (m_Port) {
+			m_Port->drop();
+		}
+	}
+
+	CReplay* CReplay::record(IProc* proc, const char* path) {
+		FILE* file = proc ? fopen(path, "wb") : nullptr;
+		uint8_t header[5];
+
+		if (!file) {
+			return nullptr;
+		}
+
+		memcpy(header, MAGIC, 4);
+		header[4] = VERSION;
+		fwrite(header, 1, sizeof(header), file);
+
+		CReplay* replay = new CReplay(proc, REPLAY_RECORD, file);
+		USE_STATE(proc, state);
+
+		if ((replay->m_Port = proc->getPort()) != nullptr) {
+			replay->m_Port->grab();
+		}
+
+		replay->m_Instructions = state->instructions;
+		replay->m_Cycles = state->cycles;
+
+		// --> bound to its port type. (see `Ci8086T`)
+		if (!proc->setPort(replay)) {
+			replay->drop();
+			return nullptr;
+		}
+
+		return replay;
+	}
+
+	CReplay* CReplay::replay(IProc* proc, const char* path) {
+		FILE* file = proc ? fopen(path, "rb") : nullptr;
+		uint8_t header[5];
+
+		if (!file) {
+			return nullptr;
+		}
+
+		if (fread(header, 1, sizeof(header), file) != sizeof(header)
+			|| memcmp(header, MAGIC, 4) || header[4] != VERSION)
+		{
+			fclose(file);
+			return nullptr;
+		}
+
+		CReplay* replay = new CReplay(proc, REPLAY_PLAY, file);
+		USE_STATE(proc, state);
+
+		replay->m_Instructions = state->instructions;
+		replay->m_Cycles = state->cycles;
+
+		if (replay->load()) {
+			replay->next();
+		}
+
+		if (!proc->setPort(replay)) {
+			replay->drop();
+			return nullptr;
+		}
+
+		return replay;
+	}
+
+	bool CReplay::isFinished() {
+		if (m_Mode != REPLAY_PLAY) {
+			return false;
+		}
+
+		fill();
+		return !m_Next.kind && !m_More;
+	}
+
+	void CReplay::flush() {
+		uint8_t header[16];
+
+		if (!m_File || m_Mode != REPLAY_RECORD || (m_Ports.empty() && m_Events.empty())) {
+			return;
+		}
+
+		// --> the events of the next batches are at this count or later.
+		putLE(header, m_Proc->getState()->instructions, 8);
+		putLE(header + 8, m_Ports.size(), 4);
+		putLE(header + 12, m_Events.size(), 4);
+
+		fwrite(header, 1, sizeof(header), m_File);
+		fwrite(m_Ports.data(), 1, m_Ports.size(), m_File);
+		fwrite(m_Events.data(), 1, m_Events.size(), m_File);
+
+		m_Ports.clear();
+		m_Events.clear();
+	}
+
+	void CReplay::close() {
+		if (!m_File) {
+			return;
+		}
+
+		if (m_Mode == REPLAY_RECORD) {
+			flush();
+		}
+
+		fclose(m_File);
+		m_File = nullptr;
+
+		// --> keeps this alive until it returns: the processor drops it.
+		grab();
+		m_Proc->setPort(m_Port);
+
+		if (m_Port) {
+			m_Port->drop();
+			m_Port = nullptr;
+		}
+
+		drop();
+	}
+
+	ESTOP CReplay::run(uint64_t maxInstructions, uint64_t maxCycles) {
+		USE_STATE(m_Proc, state);
+
+		if (!m_File) {
+			return m_Proc->run(maxInstructions, maxCycles);
+		}
+
+		if (m_Mode == REPLAY_RECORD) {
+			ESTOP reason = m_Proc->run(maxInstructions, maxCycles);
+
+			if (reason == STOP_IRQ) {
+				putEvent(EREC_IRQ);
+				putVarint(m_Events, state->cycles - m_Cycles);
+				m_Cycles = state->cycles;
+			}
+
+			// --> between runs only: the instruction count is exact here.
+			if (m_Ports.size() >= BATCH || m_Events.size() >= BATCH) {
+				flush();
+			}
+
+			return reason;
+		}
+
+		uint64_t start = state->instructions;
+		uint64_t until = maxCycles > UINT64_MAX - state->cycles
+			? UINT64_MAX : state->cycles + maxCycles;
+
+		while (true) {
+			uint64_t now = state->instructions;
+
+			fill();
+			applyDue();
+
+			if (m_Next.kind == EREC_IRQ && m_Next.instructions == now) {
+				// --> idle cycles of the halted processor, as they were recorded.
+				if (m_Next.cycles > state->cycles) {
+					state->cycles = m_Next.cycles;
+				}
+
+				m_Proc->setIrq(true);
+				ESTOP reason = m_Proc->run(0, UINT64_MAX);
+				m_Proc->setIrq(false);
+
+				if (reason != STOP_IRQ) {
+					diverge();
+				}
+
+				next();
+				return STOP_IRQ;
+			}
+
+			uint64_t left = maxInstructions - (now - start);
+			uint64_t stop = m_Next.kind ? m_Next.instructions : (m_More ? m_Horizon : UINT64_MAX);
+
+			if (!left) {
+				return STOP_BUDGET;
+			}
+
+			if (stop <= now) {
+				// --> e.g. the vector of the last interrupt has not been taken.
+				diverge();
+				stop = UINT64_MAX;
+			}
+
+			uint64_t budget = left < stop - now ? left : stop - now;
+			uint64_t cycles = until == UINT64_MAX ? UINT64_MAX
+				: (state->cycles < until ? until - state->cycles : 0);
+
+			ESTOP reason = m_Proc->run(budget, cycles);
+
+			// --> stopped at an event: go on with the rest of the budget.
+			if (reason != STOP_BUDGET || budget == left || state->cycles >= until) {
+				return reason;
+			}
+		}
+	}
+
+	void CReplay::dma(uint32_t addr, const void* buf, uint32_t size) {
+		if (m_Mode == REPLAY_PLAY && m_File) {
+			return;
+		}
+
+		m_Proc->write(addr, buf, size);
+
+		if (m_File) {
+			putEvent(EREC_DMA);
+			putVarint(m_Events, addr);
+			putVarint(m_Events, size);
+			m_Events.insert(m_Events.end(), (const uint8_t*)buf, (const uint8_t*)buf + size);
+		}
+	}
+
+	uint8_t CReplay::acknowledge(uint8_t vector) {
+		if (!m_File) {
+			return vector;
+		}
+
+		if (m_Mode == REPLAY_RECORD) {
+			putEvent(EREC_ACK);
+			m_Events.push_back(vector);
+			return vector;
+		}
+
+		fill();
+		applyDue();
+
+		if (m_Next.kind != EREC_ACK || m_Next.instructions != m_Proc->getState()->instructions) {
+			diverge();
+			return vector;
+		}
+
+		vector = m_Next.vector;
+		next();
+		return vector;
+	}
+
+	bool CReplay::write(uint16_t port, uint8_t byte) {
+		return m_Mode == REPLAY_PLAY || !m_Port || m_Port->write(port, byte);
+	}
+
+	bool CReplay::read(uint16_t port, uint8_t* byte) {
+		if (m_Mode == REPLAY_PLAY) {
+			takePort(PREC_IN8, port, byte, 1);
+			return true;
+		}
+
+		if (!m_Port || !m_Port->read(port, byte)) {
+			*byte = 0xff;
+		}
+
+		putPort(PREC_IN8, port, byte, 1);
+		return true;
+	}
+
+	bool CReplay::write16(uint16_t port, uint16_t word) {
+		return m_Mode == REPLAY_PLAY || !m_Port || m_Port->write16(port, word);
+	}
+
+	bool CReplay::read16(uint16_t port, uint16_t* word) {
+		uint8_t bytes[2];
+
+		if (m_Mode == REPLAY_PLAY) {
+			takePort(PREC_IN16, port, bytes, 2);
+			*word = uint16_t(getLE(bytes, 2));
+			return true;
+		}
+
+		if (!m_Port || !m_Port->read16(port, word)) {
+			*word = 0xffff;
+		}
+
+		putLE(bytes, *word, 2);
+		putPort(PREC_IN16, port, bytes, 2);
+		return true;
+	}
+
+	uint32_t CReplay::readBlock(uint16_t port, void* buf, uint32_t count, uint8_t width) {
+		if (m_Mode == REPLAY_PLAY) {
+			takePort(PREC_BLOCK, port, (uint8_t*)buf, count * width);
+			return count;
+		}
+
+		if (m_Port) {
+			m_Port->readBlock(port, buf, count, width);
+		}
+
+		else {
+			memset(buf, 0xff, count * width);
+		}
+
+		putPort(PREC_BLOCK, port, (const uint8_t*)buf, count * width);
+		return count;
+	}
+
+	uint32_t CReplay::writeBlock(uint16_t port, const void* buf, uint32_t count, uint8_t width) {
+		if (m_Mode == REPLAY_PLAY || !m_Port) {
+			return count;
+		}
+
+		return m_Port->writeBlock(port, buf, count, width);
+	}
+
+	void CReplay::putPort(uint8_t kind, uint16_t port, const uint8_t* bytes, uint32_t size) {
+		if (!m_File) {
+			return;
+		}
+
+		m_Ports.push_back(kind);
+		m_Ports.push_back(uint8_t(port));
+		m_Ports.push_back(uint8_t(port >> 8));
+
+		if (kind == PREC_BLOCK) {
+			putVarint(m_Ports, size);
+		}
+
+		m_Ports.insert(m_Ports.end(), bytes, bytes + size);
+	}
+
+	bool CReplay::takePort(uint8_t kind, uint16_t port, uint8_t* bytes, uint32_t size) {
+		uint64_t length = size;
+
+		if (!m_File || m_PortPos + 3 > m_Ports.size()
+			|| m_Ports[m_PortPos] != kind || getLE(&m_Ports[m_PortPos + 1], 2) != port)
+		{
+			diverge();
+			memset(bytes, 0xff, size);
+			return false;
+		}
+
+		size_t pos = m_PortPos + 3;
+
+		if (kind == PREC_BLOCK && !getVarint(m_Ports, &pos, &length)) {
+			length = UINT64_MAX;
+		}
+
+		if (length != size || pos + size > m_Ports.size()) {
+			diverge();
+			memset(bytes, 0xff, size);
+			return false;
+		}
+
+		memcpy(bytes, &m_Ports[pos], size);
+		m_PortPos = pos + size;
+		return true;
+	}
+
+	void CReplay::putEvent(uint8_t kind) {
+		uint64_t now = m_Proc->getState()->instructions;
+
+		m_Events.push_back(kind);
+		putVarint(m_Events, now - m_Instructions);
+		m_Instructions = now;
+	}
+
+	bool CReplay::load() {
+		uint8_t header[16];
+
+		if (!m_File || !m_More) {
+			return false;
+		}
+
+		if (fread(header, 1, sizeof(header), m_File) != sizeof(header)) {
+			m_More = false;
+			return false;
+		}
+
+		size_t ports = size_t(getLE(header + 8, 4));
+		size_t events = size_t(getLE(header + 12, 4));
+
+		// --> drop what has been read, keep the rest.
+		m_Ports.erase(m_Ports.begin(), m_Ports.begin() + m_PortPos);
+		m_Events.erase(m_Events.begin(), m_Events.begin() + m_EventPos);
+		m_PortPos = m_EventPos = 0;
+
+		size_t portBase = m_Ports.size();
+		size_t eventBase = m_Events.size();
+
+		m_Ports.resize(portBase + ports);
+		m_Events.resize(eventBase + events);
+
+		if (fread(m_Ports.data() + portBase, 1, ports, m_File) != ports
+			|| fread(m_Events.data() + eventBase, 1, events, m_File) != events)
+		{
+			m_More = false;
+			diverge();
+			return false;
+		}
+
+		m_Horizon = getLE(header, 8);
+		return true;
+	}
+
+	void CReplay::fill() {
+		uint64_t now = m_Proc->getState()->instructions;
+
+		// --> the events up to now are in the batches loaded so far.
+		while (!m_Next.kind && m_More && m_Horizon <= now && load()) {
+			next();
+		}
+	}
+
+	void CReplay::next() {
+		uint64_t delta, value;
+
+		m_Next.kind = 0;
+
+		if (m_EventPos >= m_Events.size()) {
+			return;
+		}
+
+		uint8_t kind = m_Events[m_EventPos++];
+
+		if (!getVarint(m_Events, &m_EventPos, &delta)) {
+			diverge();
+			return;
+		}
+
+		m_Instructions += delta;
+		m_Next.instructions = m_Instructions;
+
+		switch (kind) {
+		case EREC_IRQ:
+			if (!getVarint(m_Events, &m_EventPos, &value)) {
+				diverge();
+				return;
+			}
+
+			m_Cycles += value;
+			m_Next.cycles = m_Cycles;
+			break;
+
+		case EREC_DMA: {
+			uint64_t addr, size;
+
+			if (!getVarint(m_Events, &m_EventPos, &addr) || !getVarint(m_Events, &m_EventPos, &size)
+				|| m_EventPos + size > m_Events.size())
+			{
+				diverge();
+				return;
+			}
+
+			m_Next.addr = uint32_t(addr);
+			m_Next.data.assign(m_Events.begin() + m_EventPos, m_Events.begin() + m_EventPos + size);
+			m_EventPos += size_t(size);
+			break;
+		}
+
+		case EREC_ACK:
+			if (m_EventPos >= m_Events.size()) {
+				diverge();
+				return;
+			}
+
+			m_Next.vector = m_Events[m_EventPos++];
+			break;
+
+		default:
+			diverge();
+			return;
+		}
+
+		m_Next.kind = kind;
+	}
+
+	void CReplay::applyDue() {
+		uint64_t now = m_Proc->getState()->instructions;
+
+		while (true) {
+			if (m_Next.kind && m_Next.instructions < now) {
+				diverge();
+				next();
+				continue;
+			}
+
+			if (m_Next.kind != EREC_DMA || m_Next.instructions != now) {
+				break;
+			}
+
+			m_Proc->write(m_Next.addr, m_Next.data.data(), uint32_t(m_Next.data.size()));
+			next();
+			fill();
+		}
+	}
+
+	void CReplay::diverge() {
+		m_Diverged = true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+#ifndef __V86_VM_REPLAY_H__
+#define __V86_VM_REPLAY_H__
+#include <stdio.h>
+#include <vector>
+
+// --> after the standard headers, the register macros collide with them.
+#include "../cpu/proc.h"
+
+namespace v86 {
+	enum EREPLAY {
+		REPLAY_RECORD = 0,	// --> devices run, their inputs are logged.
+		REPLAY_PLAY,		// --> inputs come from the log, devices are not touched.
+	};
+
+	/**
+	 * deterministic record and replay of the inputs of a processor.
+	 * installs itself as the port of the processor: port reads are logged or fed from the log.
+	 * the host runs the processor through `run()`, delivers DMA through `dma()`,
+	 * and takes the vector of each interrupt through `acknowledge()`, in both modes.
+	 *
+	 * log: "V86R", version, then batches of
+	 *   { instruction count (uint64 LE), port bytes, event bytes (uint32 LE), ports, events }.
+	 * the events of later batches are at the instruction count of the batch or later.
+	 * port reads are in execution order, events (IRQ, DMA, ACK) are keyed by the instruction count.
+	 */
+	class CReplay : public IPort {
+	private:
+		static constexpr size_t BATCH = 1 << 16; // --> bytes of a stream that flush a batch.
+
+		/* port records. */
+		enum EPORTREC {
+			PREC_IN8 = 1,
+			PREC_IN16,
+			PREC_BLOCK,
+		};
+
+		/* event records. */
+		enum EEVENTREC {
+			EREC_IRQ = 1,	// --> run() returned STOP_IRQ.
+			EREC_DMA,		// --> bytes written into the memory.
+			EREC_ACK,		// --> vector of the interrupt.
+		};
+
+		/* decoded event. */
+		struct event_t {
+			uint8_t kind; // --> EEVENTREC, zero if none.
+			uint64_t instructions;
+			uint64_t cycles; // --> IRQ.
+			uint32_t addr; // --> DMA.
+			uint8_t vector; // --> ACK.
+			std::vector<uint8_t> data; // --> DMA.
+		};
+
+	private:
+		IProc* m_Proc;
+		IPort* m_Port; // --> devices, REPLAY_RECORD only.
+		EREPLAY m_Mode;
+		FILE* m_File;
+		bool m_Diverged;
+
+		/* streams: written in batches, or read a batch at a time. */
+		std::vector<uint8_t> m_Ports;
+		std::vector<uint8_t> m_Events;
+		size_t m_PortPos;
+		size_t m_EventPos;
+
+		/* last event, the counts are delta encoded from it. */
+		uint64_t m_Instructions;
+		uint64_t m_Cycles;
+
+		/* events of the batches not loaded yet are at this instruction count or later. */
+		uint64_t m_Horizon;
+		bool m_More; // --> batches left in the log.
+
+		/* next event to replay. */
+		event_t m_Next;
+
+	private:
+		CReplay(IProc* proc, EREPLAY mode, FILE* file);
+
+	public:
+		virtual ~CReplay();
+
+	public:
+		/* log the inputs of the processor into the file, in front of its current port. (nullptr if the processor does not take it, see `Ci8086T`) */
+		static CReplay* record(IProc* proc, const char* path);
+
+		/* feed the processor from the log, instead of its devices. (the processor state should be as recorded) */
+		static CReplay* replay(IProc* proc, const char* path);
+
+	public:
+		inline EREPLAY getMode() const { return m_Mode; }
+
+		/* test whether the replay has read something else than it expected. */
+		inline bool isDiverged() const { return m_Diverged; }
+
+		/* test whether every event of the log has been replayed. */
+		bool isFinished();
+
+		/* write the batch being recorded. */
+		void flush();
+
+		/* flush and close the log, the processor keeps the devices (recording) or no port (replaying). */
+		void close();
+
+	public:
+		/* `IProc::run()`, with the IRQ delivery points logged or replayed. */
+		ESTOP run(uint64_t maxInstructions, uint64_t maxCycles);
+
+		/* write bytes into the memory from a device. (ignored while replaying: the log writes them) */
+		void dma(uint32_t addr, const void* buf, uint32_t size);
+
+		/* log the vector of the interrupt that `run()` stopped for, or get it from the log. */
+		uint8_t acknowledge(uint8_t vector);
+
+	public:
+		/* write a byte to port, dropped while replaying. */
+		virtual bool write(uint16_t port, uint8_t byte) override;
+
+		/* read a byte from port. */
+		virtual bool read(uint16_t port, uint8_t* byte) override;
+
+		/* write a word to port, dropped while replaying. */
+		virtual bool write16(uint16_t port, uint16_t word) override;
+
+		/* read a word from port. */
+		virtual bool read16(uint16_t port, uint16_t* word) override;
+
+		/* read `count` elements from the port. */
+		virtual uint32_t readBlock(uint16_t port, void* buf, uint32_t count, uint8_t width) override;
+
+		/* write `count` elements to the port, dropped while replaying. */
+		virtual uint32_t writeBlock(uint16_t port, const void* buf, uint32_t count, uint8_t width) override;
+
+	private:
+		/* append a port read. */
+		void putPort(uint8_t kind, uint16_t port, const uint8_t* bytes, uint32_t size);
+
+		/* take the next port read, false if it is not what the processor reads now. */
+		bool takePort(uint8_t kind, uint16_t port, uint8_t* bytes, uint32_t size);
+
+		/* append an event at the current instruction count. */
+		void putEvent(uint8_t kind);
+
+		/* read the next batch into the streams, false at the end of the log. */
+		bool load();
+
+		/* load batches until the next event is known, or is not due yet. */
+		void fill();
+
+		/* decode the next event into `m_Next`. */
+		void next();
+
+		/* apply the DMA events due at the current instruction count. */
+		void applyDue();
+
+		/* mark the replay as diverged. */
+		void diverge();
+	};
+}
+
+#endif // __V86_VM_REPLAY_H__
\ No newline at end of file
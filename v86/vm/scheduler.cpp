@@ -0,0 +1,236 @@
+#include "scheduler.h"
+
+namespace v86 {
+	CVmScheduler::CVmScheduler(uint32_t threads, uint64_t slice)
+		: m_Slice(slice ? slice : SLICE), m_Queued(0), m_Sleeping(0), m_Next(0), m_Running(false)
+	{
+		if (!threads && !(threads = std::thread::hardware_concurrency())) {
+			threads = 1;
+		}
+
+		m_Workers.reserve(threads);
+		for (uint32_t i = 0; i < threads; ++i) {
+			m_Workers.push_back(new worker_t());
+		}
+	}
+
+	CVmScheduler::~CVmScheduler() {
+		stop();
+
+		for (worker_t* worker : m_Workers) {
+			delete worker;
+		}
+
+		for (vm_t* vm : m_Vms) {
+			delete vm->proc;
+			delete vm;
+		}
+	}
+
+	uint32_t CVmScheduler::getCount() const {
+		std::lock_guard<std::mutex> guard(m_Lock);
+		return uint32_t(m_Vms.size());
+	}
+
+	CVmScheduler::vm_t* CVmScheduler::find(uint32_t id) const {
+		std::lock_guard<std::mutex> guard(m_Lock);
+		return id < m_Vms.size() ? m_Vms[id] : nullptr;
+	}
+
+	IProc* CVmScheduler::getProc(uint32_t id) const {
+		vm_t* vm = find(id);
+		return vm ? vm->proc : nullptr;
+	}
+
+	const vmstat_t* CVmScheduler::getStat(uint32_t id) const {
+		vm_t* vm = find(id);
+		return vm ? &vm->stat : nullptr;
+	}
+
+	bool CVmScheduler::isParked(uint32_t id) const {
+		vm_t* vm = find(id);
+		return vm && vm->state.load() == VMS_PARKED;
+	}
+
+	uint32_t CVmScheduler::add(IProc* proc) {
+		vm_t* vm = new vm_t();
+
+		vm->proc = proc;
+		vm->state = VMS_READY;
+		vm->wake = false;
+		vm->stat.instructions = 0;
+		vm->stat.cycles = 0;
+		vm->stat.slices = 0;
+		vm->stat.parks = 0;
+
+		{
+			std::lock_guard<std::mutex> guard(m_Lock);
+			vm->id = uint32_t(m_Vms.size());
+			m_Vms.push_back(vm);
+		}
+
+		push(vm, m_Next.fetch_add(1));
+		return vm->id;
+	}
+
+	void CVmScheduler::wake(uint32_t id) {
+		vm_t* vm = find(id);
+
+		if (vm) {
+			// --> seen by the worker if the VM parks right after this.
+			vm->wake.store(true);
+			resume(vm);
+		}
+	}
+
+	void CVmScheduler::start() {
+		if (m_Running.exchange(true)) {
+			return;
+		}
+
+		for (uint32_t i = 0; i < m_Workers.size(); ++i) {
+			m_Workers[i]->thread = std::thread(&CVmScheduler::work, this, i);
+		}
+	}
+
+	void CVmScheduler::stop() {
+		if (!m_Running.exchange(false)) {
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(m_Lock);
+			m_Idle.notify_all();
+		}
+
+		// --> running slices are not interrupted.
+		for (worker_t* worker : m_Workers) {
+			worker->thread.join();
+		}
+	}
+
+	bool CVmScheduler::onStop(uint32_t, IProc*, ESTOP reason) {
+		return reason == STOP_BUDGET;
+	}
+
+	void CVmScheduler::push(vm_t* vm, uint32_t worker) {
+		worker_t* target = m_Workers[worker % m_Workers.size()];
+
+		{
+			std::lock_guard<std::mutex> guard(target->lock);
+			target->queue.push_back(vm);
+		}
+
+		m_Queued.fetch_add(1);
+		if (m_Sleeping.load()) {
+			std::lock_guard<std::mutex> guard(m_Lock);
+			m_Idle.notify_one();
+		}
+	}
+
+	CVmScheduler::vm_t* CVmScheduler::pop(uint32_t worker) {
+		uint32_t n = uint32_t(m_Workers.size());
+
+		// --> own queue from the front, the others' from the back.
+		for (uint32_t i = 0; i < n; ++i) {
+			worker_t* target = m_Workers[(worker + i) % n];
+			std::lock_guard<std::mutex> guard(target->lock);
+
+			if (!target->queue.empty()) {
+				vm_t* vm;
+
+				if (!i) {
+					vm = target->queue.front();
+					target->queue.pop_front();
+				}
+
+				else {
+					vm = target->queue.back();
+					target->queue.pop_back();
+				}
+
+				m_Queued.fetch_sub(1);
+				return vm;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void CVmScheduler::park(vm_t* vm) {
+		vm->stat.parks.fetch_add(1, std::memory_order_relaxed);
+		vm->state.store(VMS_PARKED);
+
+		if (vm->wake.load()) {
+			resume(vm);
+		}
+	}
+
+	void CVmScheduler::resume(vm_t* vm) {
+		uint8_t parked = VMS_PARKED;
+
+		if (vm->state.compare_exchange_strong(parked, VMS_READY)) {
+			vm->wake.store(false);
+			push(vm, m_Next.fetch_add(1));
+		}
+	}
+
+	void CVmScheduler::idle() {
+		std::unique_lock<std::mutex> guard(m_Lock);
+
+		m_Sleeping.fetch_add(1);
+		m_Idle.wait(guard, [this]() {
+			return m_Queued.load() || !m_Running.load();
+		});
+
+		m_Sleeping.fetch_sub(1);
+	}
+
+	void CVmScheduler::work(uint32_t worker) {
+		worker_t* self = m_Workers[worker];
+		vm_t* vm = nullptr;
+
+		while (m_Running.load(std::memory_order_relaxed)) {
+			if (!vm && !(vm = pop(worker))) {
+				idle();
+				continue;
+			}
+
+			USE_STATE(vm->proc, state);
+			uint64_t instructions = state->instructions;
+			uint64_t cycles = state->cycles;
+
+			vm->state.store(VMS_RUNNING, std::memory_order_relaxed);
+			ESTOP reason = vm->proc->run(m_Slice, UINT64_MAX);
+
+			// --> the VM is on this worker only, no contention on the counters.
+			vm->stat.instructions.fetch_add(state->instructions - instructions, std::memory_order_relaxed);
+			vm->stat.cycles.fetch_add(state->cycles - cycles, std::memory_order_relaxed);
+			vm->stat.slices.fetch_add(1, std::memory_order_relaxed);
+
+			if (!onStop(vm->id, vm->proc, reason)) {
+				park(vm);
+				vm = nullptr;
+				continue;
+			}
+
+			// --> keep the VM unless others are waiting on this worker.
+			bool waiting;
+			{
+				std::lock_guard<std::mutex> guard(self->lock);
+				waiting = !self->queue.empty();
+			}
+
+			if (waiting) {
+				vm->state.store(VMS_READY, std::memory_order_relaxed);
+				push(vm, worker);
+				vm = nullptr;
+			}
+		}
+
+		if (vm) {
+			vm->state.store(VMS_READY);
+			push(vm, worker);
+		}
+	}
+}
\ No newline at end of file
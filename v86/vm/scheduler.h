@@ -0,0 +1,122 @@
+#ifndef __V86_VM_SCHEDULER_H__
+#define __V86_VM_SCHEDULER_H__
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --> after the standard headers, the register macros collide with them.
+#include "../cpu/proc.h"
+
+namespace v86 {
+	/* throughput counters of a VM, written only by the worker that runs it. */
+	struct alignas(64) vmstat_t {
+		std::atomic<uint64_t> instructions;
+		std::atomic<uint64_t> cycles;
+		std::atomic<uint64_t> slices;
+		std::atomic<uint64_t> parks;
+	};
+
+	/* state of a VM in the scheduler. */
+	enum EVMSTATE {
+		VMS_READY = 0,	// --> queued on a worker.
+		VMS_RUNNING,
+		VMS_PARKED,		// --> out of the queues until `wake()`.
+	};
+
+	/**
+	 * runs many processors in time slices on a work-stealing pool.
+	 * each worker owns a queue, idle workers steal from the others.
+	 * a worker keeps running its VM while nothing else waits on its queue,
+	 * so the slice loop touches no state shared with the other workers.
+	 */
+	class CVmScheduler {
+	public:
+		static constexpr uint64_t SLICE = 100000; // --> instructions per slice.
+
+	private:
+		struct alignas(64) vm_t {
+			IProc* proc;
+			uint32_t id;
+			std::atomic<uint8_t> state;
+			std::atomic<bool> wake; // --> woken while running.
+			vmstat_t stat;
+		};
+
+		struct alignas(64) worker_t {
+			std::mutex lock;
+			std::deque<vm_t*> queue;
+			std::thread thread;
+		};
+
+	private:
+		std::vector<vm_t*> m_Vms;
+		std::vector<worker_t*> m_Workers;
+		uint64_t m_Slice;
+
+		mutable std::mutex m_Lock; // --> VM list and idle workers.
+		std::condition_variable m_Idle;
+		std::atomic<uint32_t> m_Queued;
+		std::atomic<uint32_t> m_Sleeping;
+		std::atomic<uint32_t> m_Next;
+		std::atomic<bool> m_Running;
+
+	public:
+		/* zero threads for the core count. */
+		CVmScheduler(uint32_t threads = 0, uint64_t slice = SLICE);
+		virtual ~CVmScheduler();
+
+	public:
+		inline uint32_t getThreads() const { return uint32_t(m_Workers.size()); }
+		inline bool isRunning() const { return m_Running.load(); }
+
+		/* number of VMs. */
+		uint32_t getCount() const;
+
+		/* processor of the VM. */
+		IProc* getProc(uint32_t id) const;
+
+		/* throughput counters of the VM. */
+		const vmstat_t* getStat(uint32_t id) const;
+
+		/* test whether the VM is parked. */
+		bool isParked(uint32_t id) const;
+
+	public:
+		/* add a processor, the scheduler deletes it. returns its id. */
+		uint32_t add(IProc* proc);
+
+		/* make the parked VM runnable again, e.g. after `setIrq(true)`. */
+		void wake(uint32_t id);
+
+		/* start the workers. */
+		void start();
+
+		/* stop the workers after their current slices. */
+		void stop();
+
+	protected:
+		/**
+		 * called by the worker after a slice.
+		 * returns true to keep the VM runnable, false to park it.
+		 * by default, only exhausted budgets keep running.
+		 */
+		virtual bool onStop(uint32_t id, IProc* proc, ESTOP reason);
+
+	private:
+		vm_t* find(uint32_t id) const;
+
+		void push(vm_t* vm, uint32_t worker);
+		vm_t* pop(uint32_t worker);
+
+		void park(vm_t* vm);
+		void resume(vm_t* vm);
+		void idle();
+
+		void work(uint32_t worker);
+	};
+}
+
+#endif // __V86_VM_SCHEDULER_H__
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "template.h"
+#include "../dev/cow.h"
+#include <string.h>
+
+namespace v86 {
+	CVmTemplate::CVmTemplate() : m_Host(nullptr), m_Size(0) {
+		memset(&m_State, 0, sizeof(m_State));
+	}
+
+	CVmTemplate::~CVmTemplate() {
+		delete[] m_Host;
+	}
+
+	CVmTemplate* CVmTemplate::capture(IProc* proc) {
+		CMemoryBus* bus = proc->getBus();
+		constexpr uint32_t PAGE_SIZE = CMemoryBus::PAGE_SIZE;
+
+		if (!bus) {
+			return nullptr;
+		}
+
+		CVmTemplate* image = new CVmTemplate();
+		memcpy(&image->m_State, proc->getState(), sizeof(state_t));
+
+		// --> collect runs of host pages, RAM and ROM apart.
+		for (uint32_t i = 0; i < CMemoryBus::PAGES; ++i) {
+			const page_t* page = bus->getPage(i << CMemoryBus::PAGE_BITS);
+
+			if (!(page->access & PAGE_READ)) {
+				continue;
+			}
+
+			bool rom = !(page->access & (PAGE_WRITE | PAGE_COW));
+			if (!image->m_Ranges.empty()) {
+				range_t& last = image->m_Ranges.back();
+
+				if (last.rom == rom && last.addr + last.size == (i << CMemoryBus::PAGE_BITS)) {
+					last.size += PAGE_SIZE;
+					image->m_Size += PAGE_SIZE;
+					continue;
+				}
+			}
+
+			image->m_Ranges.push_back({ i << CMemoryBus::PAGE_BITS, PAGE_SIZE, nullptr, rom });
+			image->m_Size += PAGE_SIZE;
+		}
+
+		image->m_Host = new uint8_t[image->m_Size ? image->m_Size : 1];
+
+		uint8_t* host = image->m_Host;
+		for (range_t& range : image->m_Ranges) {
+			range.host = host;
+
+			for (uint32_t offset = 0; offset < range.size; offset += PAGE_SIZE) {
+				memcpy(host + offset, bus->getPage(range.addr + offset)->host, PAGE_SIZE);
+			}
+
+			host += range.size;
+		}
+
+		return image;
+	}
+
+	CCowMemory* CVmTemplate::share() {
+		CCowMemory* memory = new CCowMemory(this);
+
+		for (const range_t& range : m_Ranges) {
+			memory->share(range.addr, range.size, range.host, range.rom);
+		}
+
+		return memory;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef __V86_VM_TEMPLATE_H__
+#define __V86_VM_TEMPLATE_H__
+#include <cstring>
+#include <vector>
+
+// --> after the standard headers, the register macros collide with them.
+#include "../cpu/proc.h"
+#include "../dev/cow.h"
+
+namespace v86 {
+	/**
+	 * immutable snapshot of a booted VM, forked into new processors.
+	 * RAM pages are shared copy-on-write, ROM pages are shared forever.
+	 * handler pages (MMIO) are not captured, map the devices of each fork again.
+	 */
+	class CVmTemplate : public IRefCounted {
+	private:
+		/* run of captured pages. */
+		struct range_t {
+			uint32_t addr;
+			uint32_t size;
+			uint8_t* host; // --> into `m_Host`.
+			bool rom;
+		};
+
+	private:
+		state_t m_State;
+		uint8_t* m_Host;
+		uint32_t m_Size;
+		std::vector<range_t> m_Ranges;
+
+	private:
+		CVmTemplate();
+
+		/* create a copy-on-write memory over the captured pages. */
+		CCowMemory* share();
+
+	public:
+		virtual ~CVmTemplate();
+
+	public:
+		/* capture the stopped processor, nullptr if its memory is not a bus. */
+		static CVmTemplate* capture(IProc* proc);
+
+	public:
+		inline const state_t* getState() const { return &m_State; }
+
+		/* get the bytes of the captured pages. */
+		inline uint32_t getSize() const { return m_Size; }
+
+		/**
+		 * set the state and a copy-on-write memory to the fresh processor, false if it does not take the memory.
+		 * the memory is set through the setter of `TProc`: a bound processor (e.g. `Ci8086T<CMemoryBus, ...>`)
+		 * takes it through its typed setter, not through `IProc`. the processor is left untouched on failure.
+		 */
+		template<class TProc>
+		inline bool fork(TProc* proc) {
+			CCowMemory* memory = share();
+			bool ok = proc->setMemory(memory);
+
+			if (ok) {
+				memcpy(proc->getState(), &m_State, sizeof(state_t));
+			}
+
+			memory->drop();
+			return ok;
+		}
+	};
+}
+
+#endif // __V86_VM_TEMPLATE_H__
\ No newline at end of file
@@ -0,0 +1,399 @@
+#include "tracefile.h"
+#include <string.h>
+#include <chrono>
+
+namespace v86 {
+	namespace {
+		const uint8_t MAGIC[4] = { 'V', '8', '6', 'T' };
+		constexpr uint8_t VERSION = 1;
+
+		inline uint8_t* putVarint(uint8_t* out, uint32_t value) {
+			while (value >= 0x80) {
+				*out++ = uint8_t(value | 0x80);
+				value >>= 7;
+			}
+
+			*out++ = uint8_t(value);
+			return out;
+		}
+
+		/* 16-bit difference, small either way. */
+		inline uint32_t zigzag(uint16_t delta) {
+			int16_t value = int16_t(delta);
+			return uint32_t((value << 1) ^ (value >> 15)) & 0xffff;
+		}
+
+		inline uint16_t unzigzag(uint32_t value) {
+			return uint16_t((value >> 1) ^ (0u - (value & 1)));
+		}
+
+		/* FLAGS of the record, with its pending flags evaluated. */
+		inline uint16_t lazyFlags(const trace_t& rec) {
+			state_t state;
+			state.regs[REG_EFLAGS].dword = rec.regs[TRACE_FLAGS];
+			state.lazy = rec.lazy;
+
+			eflag_sync(&state);
+			return uint16_t(state.regs[REG_EFLAGS].dword);
+		}
+	}
+
+	void trace_codec_t::reset() {
+		seg = 0;
+		next = 0;
+		memset(regs, 0, sizeof(regs));
+		memset(dict, 0, sizeof(dict));
+	}
+
+	CTraceWriter::CTraceWriter()
+		: m_Running(true), m_Records(0), m_Bytes(0)
+	{
+		m_Thread = std::thread(&CTraceWriter::loop, this);
+	}
+
+	CTraceWriter::~CTraceWriter() {
+		stop();
+	}
+
+	bool CTraceWriter::add(CTrace* trace, const char* path, bool compress) {
+		if (!trace || !m_Running.load()) {
+			return false;
+		}
+
+		FILE* file = fopen(path, "wb");
+		if (!file) {
+			return false;
+		}
+
+		stream_t* stream = new stream_t();
+		stream->trace = trace;
+		stream->file = file;
+		stream->dict = compress;
+		stream->codec.reset();
+
+		memcpy(stream->out, MAGIC, 4);
+		stream->out[4] = VERSION;
+		stream->out[5] = uint8_t(trace->getFlags() | (compress ? TRACE_FILE_DICT : 0));
+		stream->used = 6;
+
+		trace->grab();
+
+		std::lock_guard<std::mutex> guard(m_Lock);
+		m_Streams.push_back(stream);
+		return true;
+	}
+
+	void CTraceWriter::stop() {
+		if (!m_Running.exchange(false)) {
+			return;
+		}
+
+		m_Thread.join();
+
+		// --> the processors have stopped: what is left in the rings is final.
+		for (stream_t* stream : m_Streams) {
+			while (drain(stream));
+
+			flush(stream);
+			fclose(stream->file);
+
+			stream->trace->drop();
+			delete stream;
+		}
+
+		m_Streams.clear();
+	}
+
+	void CTraceWriter::flush(stream_t* stream) {
+		fwrite(stream->out, 1, stream->used, stream->file);
+		m_Bytes += stream->used;
+		stream->used = 0;
+	}
+
+	void CTraceWriter::loop() {
+		while (m_Running.load()) {
+			uint32_t drained = 0;
+
+			{
+				std::lock_guard<std::mutex> guard(m_Lock);
+
+				for (stream_t* stream : m_Streams) {
+					drained += drain(stream);
+				}
+			}
+
+			// --> nothing to do: wait for the rings to fill up a little.
+			if (!drained) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+	}
+
+	uint32_t CTraceWriter::drain(stream_t* stream) {
+		const trace_t* recs;
+		uint32_t count = stream->trace->peek(&recs);
+
+		count = count < BATCH ? count : BATCH;
+
+		for (uint32_t i = 0; i < count; ++i) {
+			stream->used = encode(stream, recs[i], stream->out + stream->used) - stream->out;
+
+			if (stream->used >= FLUSH) {
+				flush(stream);
+			}
+		}
+
+		stream->trace->release(count);
+		m_Records += count;
+		return count;
+	}
+
+	uint8_t* CTraceWriter::encode(stream_t* stream, const trace_t& rec, uint8_t* out) {
+		trace_codec_t& codec = stream->codec;
+		uint32_t stored = rec.length < 16 ? rec.length : 16;
+		uint8_t head = 0;
+		uint16_t changed = 0;
+		uint16_t value[TRACE_REG_MAX];
+
+		if (rec.seg != codec.seg) {
+			head |= TREC_CS;
+		}
+
+		if (rec.off != codec.next) {
+			head |= TREC_JUMP;
+		}
+
+		if (stream->dict) {
+			trace_codec_t::entry_t* e = codec.entry(rec.seg, rec.off);
+			uint32_t key = (uint32_t(rec.seg) << 16) | rec.off;
+
+			if (!key || e->key != key || e->length != rec.length || memcmp(e->bytes, rec.bytes, stored)) {
+				head |= TREC_BYTES;
+
+				e->key = key;
+				e->length = rec.length;
+				memcpy(e->bytes, rec.bytes, stored);
+			}
+		}
+
+		else {
+			head |= TREC_BYTES;
+		}
+
+		if (stream->trace->getFlags() & TRACE_REGS) {
+			memcpy(value, rec.regs, sizeof(value));
+
+			if (rec.lazy.op != LAZY_NONE) {
+				value[TRACE_FLAGS] = lazyFlags(rec);
+			}
+
+			for (uint32_t i = 0; i < TRACE_REG_MAX; ++i) {
+				if (value[i] != codec.regs[i]) {
+					changed |= 1 << i;
+				}
+			}
+
+			if (changed) {
+				head |= TREC_REGS;
+			}
+		}
+
+		*out++ = head;
+
+		if (head & TREC_CS) {
+			out = putVarint(out, rec.seg);
+		}
+
+		if (head & TREC_JUMP) {
+			out = putVarint(out, zigzag(uint16_t(rec.off - codec.next)));
+		}
+
+		if (head & TREC_BYTES) {
+			*out++ = rec.length;
+			memcpy(out, rec.bytes, stored);
+			out += stored;
+		}
+
+		if (head & TREC_REGS) {
+			out = putVarint(out, changed);
+
+			for (uint32_t i = 0; i < TRACE_REG_MAX; ++i) {
+				if (changed & (1 << i)) {
+					out = putVarint(out, zigzag(uint16_t(value[i] - codec.regs[i])));
+					codec.regs[i] = value[i];
+				}
+			}
+		}
+
+		codec.seg = rec.seg;
+		codec.next = uint16_t(rec.off + rec.length);
+		return out;
+	}
+
+	CTraceReader::CTraceReader()
+		: m_File(nullptr), m_Flags(0), m_Count(0), m_Changed(0), m_Pos(0), m_Size(0),
+		m_Codec(new trace_codec_t())
+	{
+	}
+
+	CTraceReader::~CTraceReader() {
+		close();
+		delete m_Codec;
+	}
+
+	bool CTraceReader::open(const char* path) {
+		uint8_t header[6];
+
+		close();
+
+		if (!(m_File = fopen(path, "rb"))) {
+			return false;
+		}
+
+		if (fread(header, 1, sizeof(header), m_File) != sizeof(header)
+			|| memcmp(header, MAGIC, 4) || header[4] != VERSION)
+		{
+			close();
+			return false;
+		}
+
+		m_Flags = header[5];
+		m_Buffer.resize(CHUNK);
+		m_Codec->reset();
+		return true;
+	}
+
+	void CTraceReader::close() {
+		if (m_File) {
+			fclose(m_File);
+			m_File = nullptr;
+		}
+
+		m_Flags = 0;
+		m_Count = 0;
+		m_Changed = 0;
+		m_Pos = m_Size = 0;
+	}
+
+	bool CTraceReader::byte(uint8_t* value) {
+		if (m_Pos >= m_Size) {
+			if (!m_File || !(m_Size = fread(m_Buffer.data(), 1, CHUNK, m_File))) {
+				return false;
+			}
+
+			m_Pos = 0;
+		}
+
+		*value = m_Buffer[m_Pos++];
+		return true;
+	}
+
+	bool CTraceReader::varint(uint32_t* value) {
+		uint8_t b;
+		*value = 0;
+
+		for (uint32_t shift = 0; shift < 35; shift += 7) {
+			if (!byte(&b)) {
+				return false;
+			}
+
+			*value |= uint32_t(b & 0x7f) << shift;
+
+			if (!(b & 0x80)) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool CTraceReader::next(trace_t* rec) {
+		trace_codec_t& codec = *m_Codec;
+		uint8_t head;
+		uint32_t value;
+
+		if (!byte(&head)) {
+			return false;
+		}
+
+		rec->seg = codec.seg;
+		rec->off = codec.next;
+
+		if (head & TREC_CS) {
+			if (!varint(&value)) {
+				return false;
+			}
+
+			rec->seg = uint16_t(value);
+		}
+
+		if (head & TREC_JUMP) {
+			if (!varint(&value)) {
+				return false;
+			}
+
+			rec->off = uint16_t(codec.next + unzigzag(value));
+		}
+
+		trace_codec_t::entry_t* e = codec.entry(rec->seg, rec->off);
+
+		if (head & TREC_BYTES) {
+			if (!byte(&rec->length)) {
+				return false;
+			}
+
+			uint32_t stored = rec->length < 16 ? rec->length : 16;
+
+			for (uint32_t i = 0; i < stored; ++i) {
+				if (!byte(&rec->bytes[i])) {
+					return false;
+				}
+			}
+
+			if (m_Flags & TRACE_FILE_DICT) {
+				e->key = (uint32_t(rec->seg) << 16) | rec->off;
+				e->length = rec->length;
+				memcpy(e->bytes, rec->bytes, stored);
+			}
+		}
+
+		else {
+			if (!(m_Flags & TRACE_FILE_DICT)) {
+				return false;
+			}
+
+			rec->length = e->length;
+			memcpy(rec->bytes, e->bytes, sizeof(e->bytes));
+		}
+
+		m_Changed = 0;
+
+		if (head & TREC_REGS) {
+			if (!varint(&value)) {
+				return false;
+			}
+
+			m_Changed = uint16_t(value);
+
+			for (uint32_t i = 0; i < TRACE_REG_MAX; ++i) {
+				if (m_Changed & (1 << i)) {
+					uint32_t delta;
+
+					if (!varint(&delta)) {
+						return false;
+					}
+
+					codec.regs[i] = uint16_t(codec.regs[i] + unzigzag(delta));
+				}
+			}
+		}
+
+		memcpy(rec->regs, codec.regs, sizeof(codec.regs));
+		rec->lazy.op = LAZY_NONE;
+
+		codec.seg = rec->seg;
+		codec.next = uint16_t(rec->off + rec->length);
+		m_Count++;
+		return true;
+	}
+}
\ No newline at end of file
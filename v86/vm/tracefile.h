@@ -0,0 +1,157 @@
+#ifndef __V86_VM_TRACEFILE_H__
+#define __V86_VM_TRACEFILE_H__
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --> after the standard headers, the register macros collide with them.
+#include "../cpu/trace.h"
+
+namespace v86 {
+	/**
+	 * trace file: "V86T", version, flags (ETRACE, TRACE_FILE_DICT), then a record per instruction.
+	 * record: head byte (ETRACE_REC), then the fields that its bits select, in the bit order.
+	 *   TREC_CS: CS, varint.
+	 *   TREC_JUMP: IP minus the end of the previous instruction, zigzag varint. (sequential if clear)
+	 *   TREC_BYTES: length, then the bytes. (if clear, the bytes of the last record at this CS:IP)
+	 *   TREC_REGS: mask of the changed registers (ETRACE_REG bits), then each delta, zigzag varint.
+	 */
+	enum ETRACE_REC {
+		TREC_CS = 0x01,
+		TREC_JUMP = 0x02,
+		TREC_BYTES = 0x04,
+		TREC_REGS = 0x08,
+	};
+
+	/* set in the file flags if the code bytes are compressed by the dictionary. */
+	constexpr uint8_t TRACE_FILE_DICT = 0x80;
+
+	/* state shared by the encoder and the decoder, both update it the same way. */
+	struct trace_codec_t {
+		static constexpr uint32_t ENTRIES = 4096;
+
+		/* code bytes, direct mapped by linear CS:IP. */
+		struct entry_t {
+			uint32_t key; // --> CS << 16 | IP, zero if empty. (0000:0000 is never cached)
+			uint8_t length;
+			uint8_t bytes[16];
+		};
+
+		uint16_t seg; // --> CS of the last record.
+		uint16_t next; // --> IP that a sequential record starts at.
+		uint16_t regs[TRACE_REG_MAX];
+		entry_t dict[ENTRIES];
+
+		/* start a new stream. */
+		void reset();
+
+		/* entry of the address. */
+		inline entry_t* entry(uint16_t seg, uint16_t off) {
+			return &dict[((uint32_t(seg) << 4) + off) & (ENTRIES - 1)];
+		}
+	};
+
+	/**
+	 * drains the traces of many processors to their files on a background thread.
+	 * attach a trace before its processor runs, stop the writer after they stopped.
+	 */
+	class CTraceWriter {
+	private:
+		static constexpr uint32_t BATCH = 4096; // --> records per drain of a stream.
+		static constexpr size_t FLUSH = 1 << 16; // --> encoded bytes per write.
+		static constexpr size_t MAX_RECORD = 80; // --> longest encoded record.
+
+		struct stream_t {
+			CTrace* trace;
+			FILE* file;
+			bool dict;
+			size_t used;
+			uint8_t out[FLUSH + MAX_RECORD];
+			trace_codec_t codec;
+		};
+
+	private:
+		std::vector<stream_t*> m_Streams;
+		std::mutex m_Lock;
+		std::thread m_Thread;
+		std::atomic<bool> m_Running;
+		std::atomic<uint64_t> m_Records;
+		std::atomic<uint64_t> m_Bytes;
+
+	public:
+		CTraceWriter();
+		virtual ~CTraceWriter();
+
+	public:
+		/**
+		 * write the trace into the file, with the code bytes dictionary unless `compress` is false.
+		 * returns false if the file can not be created or the writer has stopped.
+		 */
+		bool add(CTrace* trace, const char* path, bool compress = true);
+
+		/* drain every trace, close the files and join the thread. */
+		void stop();
+
+		/* get the records and the encoded bytes written so far. */
+		inline uint64_t getRecords() const { return m_Records.load(); }
+		inline uint64_t getBytes() const { return m_Bytes.load(); }
+
+	private:
+		void loop();
+
+		/* write the encoded bytes of the stream. */
+		void flush(stream_t* stream);
+
+		/* encode the pending records of the stream, returns the count. */
+		uint32_t drain(stream_t* stream);
+
+		/* encode the record at `out`, returns its end. */
+		static uint8_t* encode(stream_t* stream, const trace_t& rec, uint8_t* out);
+	};
+
+	/* reads a trace file record by record, without loading it. */
+	class CTraceReader {
+	private:
+		static constexpr size_t CHUNK = 1 << 16;
+
+		FILE* m_File;
+		uint8_t m_Flags;
+		uint64_t m_Count;
+		uint16_t m_Changed;
+
+		std::vector<uint8_t> m_Buffer;
+		size_t m_Pos;
+		size_t m_Size;
+
+		trace_codec_t* m_Codec;
+
+	public:
+		CTraceReader();
+		virtual ~CTraceReader();
+
+	public:
+		/* open the file and read its header. */
+		bool open(const char* path);
+		void close();
+
+		/* get the ETRACE flags of the file. */
+		inline uint32_t getFlags() const { return m_Flags & ~TRACE_FILE_DICT; }
+
+		/* get the number of records read. */
+		inline uint64_t getCount() const { return m_Count; }
+
+		/* get the registers that the last record changed, by ETRACE_REG bits. */
+		inline uint16_t getChanged() const { return m_Changed; }
+
+		/* read the next record, its FLAGS evaluated. false at the end of the file or if it is broken. */
+		bool next(trace_t* rec);
+
+	private:
+		bool byte(uint8_t* value);
+		bool varint(uint32_t* value);
+	};
+}
+
+#endif // __V86_VM_TRACEFILE_H__
\ No newline at end of file